@@ -0,0 +1,336 @@
+#include "city_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "geo.h"
+#include "json.h"
+
+using namespace std;
+
+namespace city_generator {
+
+namespace {
+
+constexpr double kOriginLat = 55.5; // < широта нижнего ряда сетки
+constexpr double kOriginLng = 37.3; // < долгота левого столбца сетки
+constexpr double kLatStep = 0.0036; // < шаг сетки по широте (около 400 м)
+constexpr double kLngStep = 0.0063; // < шаг сетки по долготе (около 400 м на широте Москвы)
+
+/*
+ * Генератор случайных чисел с воспроизводимыми на любой платформе распределениями:
+ * std::mt19937_64 определен стандартом точно, а стандартные распределения - нет
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed)
+        : engine_(seed) {
+    }
+
+    // Возвращает случайное число из [0, count)
+    size_t Index(size_t count) {
+        return static_cast<size_t>(engine_() % count);
+    }
+
+    // Возвращает случайное число из [from, to)
+    double Uniform(double from, double to) {
+        return from + (to - from) * static_cast<double>(engine_() >> 11) * 0x1.0p-53;
+    }
+
+    // Возвращает true с вероятностью probability
+    bool Chance(double probability) {
+        return Uniform(0, 1) < probability;
+    }
+
+private:
+    mt19937_64 engine_;
+};
+
+string StopName(size_t index) {
+    return "Stop "s + to_string(index);
+}
+
+string BusName(size_t index) {
+    return "Bus "s + to_string(index);
+}
+
+// Маршрут автобуса по номерам остановок
+struct BusRoute {
+    vector<size_t> stops; // < остановки в порядке следования (у кольцевого последняя совпадает с первой)
+    bool is_roundtrip = false; // < флаг кольцевого маршрута
+};
+
+// Синтетический город: сетка остановок, маршруты и расстояния по дорогам
+struct City {
+    size_t side = 0; // < число остановок на стороне сетки
+    vector<geo::Coordinates> stops; // < координаты остановок по номеру
+    vector<vector<pair<size_t, int>>> distances; // < заданные расстояния от остановки до соседних
+    vector<BusRoute> buses; // < маршруты по номеру
+};
+
+City BuildCity(const CityOptions& options, Random& random) {
+    City city;
+    city.side = max<size_t>(2, static_cast<size_t>(ceil(sqrt(static_cast<double>(options.stop_count)))));
+    const size_t side = city.side;
+    for (size_t i = 0; i < side * side; ++i) {
+        city.stops.push_back({kOriginLat + kLatStep * static_cast<double>(i / side) + random.Uniform(-0.0005, 0.0005),
+                              kOriginLng + kLngStep * static_cast<double>(i % side) + random.Uniform(-0.0005, 0.0005)});
+    }
+    city.distances.resize(city.stops.size());
+
+    // Расстояние по дорогам немного больше расстояния по прямой; каждое направление задается не более одного раза
+    unordered_set<uint64_t> known_distances;
+    auto set_distance = [&](size_t from, size_t to) {
+        if (known_distances.insert(static_cast<uint64_t>(from) * city.stops.size() + to).second) {
+            const double distance = geo::ComputeDistance(city.stops[from], city.stops[to]) * random.Uniform(1.05, 1.4);
+            city.distances[from].emplace_back(to, max(1, static_cast<int>(distance)));
+        }
+    };
+
+    const int dr[] = {0, 1, 0, -1};
+    const int dc[] = {1, 0, -1, 0};
+    const size_t min_length = max<size_t>(1, options.min_route_length);
+    const size_t max_length = max(min_length, options.max_route_length);
+    for (size_t b = 0; b < options.bus_count; ++b) {
+        // Маршрут начинается в случайном узле и идет по улицам, чаще продолжая движение прямо, чем поворачивая
+        size_t cell = random.Index(city.stops.size());
+        size_t dir = random.Index(4);
+        const size_t length = min_length + random.Index(max_length - min_length + 1);
+        vector<size_t> path{cell};
+        while (path.size() <= length) {
+            if (random.Chance(0.2)) {
+                dir = (dir + (random.Chance(0.5) ? 1 : 3)) % 4;
+            }
+            const int row = static_cast<int>(cell / side) + dr[dir];
+            const int col = static_cast<int>(cell % side) + dc[dir];
+            if (row < 0 || col < 0 || row >= static_cast<int>(side) || col >= static_cast<int>(side)) {
+                dir = (dir + 2) % 4;
+                continue;
+            }
+            const size_t next = static_cast<size_t>(row) * side + static_cast<size_t>(col);
+            set_distance(cell, next);
+            if (random.Chance(options.distance_density)) {
+                set_distance(next, cell);
+            }
+            cell = next;
+            path.push_back(cell);
+        }
+
+        // Кольцевой маршрут возвращается в начало по тем же улицам, обратный ход некольцевого добавляет каталог
+        BusRoute bus;
+        bus.is_roundtrip = random.Chance(0.3);
+        if (bus.is_roundtrip) {
+            for (size_t i = path.size() - 1; i-- > 0;) {
+                path.push_back(path[i]);
+            }
+        }
+        bus.stops = move(path);
+        city.buses.push_back(move(bus));
+    }
+    return city;
+}
+
+void WriteBaseRequests(json::Writer& writer, const City& city) {
+    writer.Key("base_requests"sv).StartArray();
+    for (size_t i = 0; i < city.stops.size(); ++i) {
+        writer.StartDict()
+            .Key("type"sv).Value("Stop"sv)
+            .Key("name"sv).Value(StopName(i))
+            .Key("latitude"sv).Value(city.stops[i].lat)
+            .Key("longitude"sv).Value(city.stops[i].lng)
+            .Key("road_distances"sv).StartDict();
+        for (const auto& [to, distance] : city.distances[i]) {
+            writer.Key(StopName(to)).Value(distance);
+        }
+        writer.EndDict().EndDict();
+    }
+    for (size_t b = 0; b < city.buses.size(); ++b) {
+        writer.StartDict()
+            .Key("type"sv).Value("Bus"sv)
+            .Key("name"sv).Value(BusName(b))
+            .Key("stops"sv).StartArray();
+        for (size_t stop : city.buses[b].stops) {
+            writer.Value(StopName(stop));
+        }
+        writer.EndArray().Key("is_roundtrip"sv).Value(city.buses[b].is_roundtrip).EndDict();
+    }
+    writer.EndArray();
+}
+
+void WriteRenderSettings(json::Writer& writer) {
+    writer.Key("render_settings"sv).StartDict()
+        .Key("width"sv).Value(1200.0)
+        .Key("height"sv).Value(1200.0)
+        .Key("padding"sv).Value(50.0)
+        .Key("line_width"sv).Value(14.0)
+        .Key("stop_radius"sv).Value(5.0)
+        .Key("bus_label_font_size"sv).Value(20)
+        .Key("bus_label_offset"sv).StartArray().Value(7.0).Value(15.0).EndArray()
+        .Key("stop_label_font_size"sv).Value(20)
+        .Key("stop_label_offset"sv).StartArray().Value(7.0).Value(-3.0).EndArray()
+        .Key("underlayer_color"sv).StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray()
+        .Key("underlayer_width"sv).Value(3.0)
+        .Key("color_palette"sv).StartArray()
+            .Value("green"sv)
+            .StartArray().Value(255).Value(160).Value(0).EndArray()
+            .Value("red"sv)
+            .StartArray().Value(12).Value(34).Value(56).Value(0.5).EndArray()
+        .EndArray()
+        .EndDict();
+}
+
+void WriteRoutingSettings(json::Writer& writer) {
+    writer.Key("routing_settings"sv).StartDict()
+        .Key("bus_wait_time"sv).Value(6)
+        .Key("bus_velocity"sv).Value(40.0)
+        .EndDict();
+}
+
+void WriteStatRequests(json::Writer& writer, const City& city, const CityOptions& options, Random& random) {
+    const QueryMix& mix = options.query_mix;
+    const double weights[] = {
+        max(mix.bus, 0.0),
+        max(mix.stop, 0.0),
+        options.with_render ? max(mix.map, 0.0) : 0.0,
+        options.with_routing ? max(mix.route, 0.0) : 0.0,
+        max(mix.nearby_stops, 0.0),
+        max(mix.stops_in_box, 0.0),
+    };
+    double total_weight = 0;
+    for (double weight : weights) {
+        total_weight += weight;
+    }
+
+    const double max_lat = kOriginLat + kLatStep * static_cast<double>(city.side);
+    const double max_lng = kOriginLng + kLngStep * static_cast<double>(city.side);
+
+    writer.Key("stat_requests"sv).StartArray();
+    for (size_t id = 0; id < options.stat_request_count && total_weight > 0; ++id) {
+        double choice = random.Uniform(0, total_weight);
+        size_t type = 0;
+        while (type + 1 < size(weights) && (weights[type] == 0 || choice >= weights[type])) {
+            choice -= weights[type];
+            ++type;
+        }
+
+        writer.StartDict().Key("id"sv).Value(static_cast<int>(id));
+        switch (type) {
+        case 0:
+            // Небольшая доля запросов к несуществующим маршрутам и остановкам
+            writer.Key("type"sv).Value("Bus"sv).Key("name"sv).Value(random.Chance(0.05) ? "Unknown bus"s : BusName(random.Index(max<size_t>(city.buses.size(), 1))));
+            break;
+        case 1:
+            writer.Key("type"sv).Value("Stop"sv).Key("name"sv).Value(random.Chance(0.05) ? "Unknown stop"s : StopName(random.Index(city.stops.size())));
+            break;
+        case 2:
+            writer.Key("type"sv).Value("Map"sv);
+            break;
+        case 3:
+            writer.Key("type"sv).Value("Route"sv)
+                .Key("from"sv).Value(StopName(random.Index(city.stops.size())))
+                .Key("to"sv).Value(StopName(random.Index(city.stops.size())));
+            break;
+        case 4:
+            writer.Key("type"sv).Value("NearbyStops"sv)
+                .Key("latitude"sv).Value(random.Uniform(kOriginLat, max_lat))
+                .Key("longitude"sv).Value(random.Uniform(kOriginLng, max_lng))
+                .Key("radius"sv).Value(random.Uniform(200, 1500))
+                .Key("count"sv).Value(10);
+            break;
+        default: {
+            // Прямоугольник со стороной от 2 до 5 шагов сетки
+            const double lat = random.Uniform(kOriginLat, max_lat);
+            const double lng = random.Uniform(kOriginLng, max_lng);
+            writer.Key("type"sv).Value("StopsInBox"sv)
+                .Key("min_latitude"sv).Value(lat)
+                .Key("min_longitude"sv).Value(lng)
+                .Key("max_latitude"sv).Value(lat + kLatStep * random.Uniform(2, 5))
+                .Key("max_longitude"sv).Value(lng + kLngStep * random.Uniform(2, 5));
+            break;
+        }
+        }
+        writer.EndDict();
+    }
+    writer.EndArray();
+}
+
+// Разбирает доли типов запросов, перечисленные через запятую
+bool ParseMix(string_view text, QueryMix& mix) {
+    double* fields[] = {&mix.bus, &mix.stop, &mix.map, &mix.route, &mix.nearby_stops, &mix.stops_in_box};
+    istringstream input{string(text)};
+    for (double* field : fields) {
+        char separator = ',';
+        if (field != fields[0] && !(input >> separator)) {
+            return false;
+        }
+        if (separator != ',' || !(input >> *field)) {
+            return false;
+        }
+    }
+    return input.peek() == char_traits<char>::eof();
+}
+
+} // namespace
+
+const char* const kOptionsUsage = "[--stops N] [--buses N] [--route-length MIN MAX] [--distance-density P] [--requests N]\n"
+                                  "    [--mix BUS,STOP,MAP,ROUTE,NEARBY,BOX] [--no-routing] [--no-render] [--seed S]";
+
+// Разбирает параметр генератора из командной строки, начинающийся с argv[index]
+bool ParseOption(int& index, int argc, char* argv[], CityOptions& options) {
+    const string_view arg = argv[index];
+    const int values = argc - index - 1;
+    if (arg == "--stops"sv && values >= 1) {
+        options.stop_count = stoul(argv[++index]);
+    } else if (arg == "--buses"sv && values >= 1) {
+        options.bus_count = stoul(argv[++index]);
+    } else if (arg == "--route-length"sv && values >= 2) {
+        options.min_route_length = stoul(argv[++index]);
+        options.max_route_length = stoul(argv[++index]);
+    } else if (arg == "--distance-density"sv && values >= 1) {
+        options.distance_density = stod(argv[++index]);
+    } else if (arg == "--requests"sv && values >= 1) {
+        options.stat_request_count = stoul(argv[++index]);
+    } else if (arg == "--mix"sv && values >= 1 && ParseMix(argv[index + 1], options.query_mix)) {
+        ++index;
+    } else if (arg == "--no-routing"sv) {
+        options.with_routing = false;
+    } else if (arg == "--no-render"sv) {
+        options.with_render = false;
+    } else if (arg == "--seed"sv && values >= 1) {
+        options.seed = stoull(argv[++index]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Выводит входной JSON с синтетическим городом
+void WriteCity(ostream& output, const CityOptions& options) {
+    Random random(options.seed);
+    const City city = BuildCity(options, random);
+
+    // Координатам нужно больше значащих цифр, чем выводит поток по умолчанию
+    const auto precision = output.precision(10);
+    json::Writer writer(output);
+    writer.StartDict();
+    WriteBaseRequests(writer, city);
+    if (options.with_render) {
+        WriteRenderSettings(writer);
+    }
+    if (options.with_routing) {
+        WriteRoutingSettings(writer);
+    }
+    WriteStatRequests(writer, city, options, random);
+    writer.EndDict();
+    output.precision(precision);
+}
+
+} // namespace city_generator
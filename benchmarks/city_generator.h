@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+namespace city_generator {
+
+// Доли типов запросов статистики (нормируются на их сумму)
+struct QueryMix {
+    double bus = 0.4; // < запросы Bus
+    double stop = 0.4; // < запросы Stop
+    double map = 0.001; // < запросы Map
+    double route = 0.1; // < запросы Route (только при включенной маршрутизации)
+    double nearby_stops = 0.05; // < запросы NearbyStops
+    double stops_in_box = 0.05; // < запросы StopsInBox
+};
+
+// Параметры синтетического города
+struct CityOptions {
+    size_t stop_count = 10000; // < число остановок (округляется вверх до квадрата стороны сетки)
+    size_t bus_count = 1000; // < число маршрутов
+    size_t min_route_length = 10; // < наименьшее число перегонов маршрута в одну сторону
+    size_t max_route_length = 30; // < наибольшее число перегонов маршрута в одну сторону
+    double distance_density = 0.5; // < доля перегонов, для которых задано и обратное расстояние
+    size_t stat_request_count = 10000; // < число запросов статистики
+    QueryMix query_mix; // < доли типов запросов статистики
+    bool with_routing = true; // < флаг вывода раздела routing_settings
+    bool with_render = true; // < флаг вывода раздела render_settings
+    uint64_t seed = 42; // < зерно генератора случайных чисел
+};
+
+/*
+ * Выводит входной JSON с синтетическим городом: остановки в узлах сетки с шагом около 400 м,
+ * маршруты идут по улицам сетки, расстояния по дорогам немного больше расстояний по прямой.
+ * Результат зависит только от параметров (в том числе зерна): случайные числа не используют стандартные распределения,
+ * реализация которых отличается между стандартными библиотеками
+ */
+void WriteCity(std::ostream& output, const CityOptions& options);
+
+/* Разбирает параметр генератора из командной строки, начинающийся с argv[index]:
+   --stops N, --buses N, --route-length MIN MAX, --distance-density P, --requests N,
+   --mix BUS,STOP,MAP,ROUTE,NEARBY,BOX, --no-routing, --no-render, --seed S.
+   При успехе сдвигает index на последний разобранный аргумент, иначе возвращает false */
+bool ParseOption(int& index, int argc, char* argv[], CityOptions& options);
+
+// Строка с описанием параметров генератора для сообщений об использовании
+extern const char* const kOptionsUsage;
+
+} // namespace city_generator
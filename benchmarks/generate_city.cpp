@@ -0,0 +1,29 @@
+/*
+ * Генератор входного JSON с синтетическим городом заданного размера (см. city_generator.h).
+ *
+ * Запуск: generate_city [--stops N] [--buses N] [--route-length MIN MAX] [--distance-density P] [--requests N]
+ *                       [--mix BUS,STOP,MAP,ROUTE,NEARBY,BOX] [--no-routing] [--no-render] [--seed S] > city.json
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#include "city_generator.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    city_generator::CityOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (!city_generator::ParseOption(i, argc, argv, options)) {
+            cerr << "Usage: generate_city "sv << city_generator::kOptionsUsage << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
+    ios::sync_with_stdio(false);
+    city_generator::WriteCity(cout, options);
+    cout << '\n';
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/*
+ * Точность и скорость расчета расстояний между точками: скалярная geo::ComputeDistance,
+ * формула гаверсинусов и пакетные векторные варианты обеих формул.
+ * Эталон - формула гаверсинусов в long double.
+ *
+ * Сборка: g++ -std=c++20 -O2 [-mavx2] -I transport-catalogue benchmarks/geo_benchmark.cpp \
+ *         transport-catalogue/geo.cpp -o geo_benchmark
+ * Запуск: geo_benchmark [число точек] [число повторов] [seed]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "geo.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Эталонное расстояние по формуле гаверсинусов в расширенной точности
+double ComputeReferenceDistance(geo::Coordinates from, geo::Coordinates to) {
+    const long double dr = 3.141592653589793238462643383279502884L / 180;
+    const long double sin_lat_delta = sinl((static_cast<long double>(to.lat) - from.lat) * dr / 2);
+    const long double sin_lng_delta = sinl((static_cast<long double>(to.lng) - from.lng) * dr / 2);
+    const long double haversine = sin_lat_delta * sin_lat_delta + cosl(from.lat * dr) * cosl(to.lat * dr) * sin_lng_delta * sin_lng_delta;
+    return static_cast<double>(2 * 6371000.0L * asinl(min(1.0L, sqrtl(haversine))));
+}
+
+struct Dataset {
+    string name; // < название набора точек
+    geo::Coordinates from; // < точка, от которой считаются расстояния
+    vector<geo::Coordinates> points; // < точки, до которых считаются расстояния
+};
+
+// Точки вокруг from на расстоянии порядка scale градусов
+Dataset MakeDataset(string name, geo::Coordinates from, double scale, size_t count, mt19937& random) {
+    uniform_real_distribution<double> offset(-scale, scale);
+    Dataset dataset{move(name), from, {}};
+    for (size_t i = 0; i < count; ++i) {
+        dataset.points.push_back({clamp(from.lat + offset(random), -90.0, 90.0), remainder(from.lng + offset(random), 360.0)});
+    }
+    return dataset;
+}
+
+// Выводит максимальную абсолютную и относительную ошибку и время одного расчета для одного способа
+void Report(const string& method, const vector<double>& distances, const vector<double>& reference, double total_ms, size_t count) {
+    double abs_error = 0;
+    double rel_error = 0;
+    for (size_t i = 0; i < distances.size(); ++i) {
+        const double error = abs(distances[i] - reference[i]);
+        abs_error = max(abs_error, error);
+        if (reference[i] > 0) {
+            rel_error = max(rel_error, error / reference[i]);
+        }
+    }
+    cout << "  " << left << setw(22) << method << right
+         << scientific << setprecision(2) << "max abs error " << abs_error << " m, max rel error " << rel_error
+         << fixed << setprecision(2) << ", " << total_ms * 1e6 / count << " ns/distance\n";
+}
+
+// Замеряет время многократного выполнения расчета всех расстояний
+double Measure(size_t repeats, const function<void()>& run) {
+    const auto start = Clock::now();
+    for (size_t r = 0; r < repeats; ++r) {
+        run();
+    }
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t point_count = argc > 1 ? stoul(argv[1]) : 100000;
+    const size_t repeats = argc > 2 ? stoul(argv[2]) : 20;
+    mt19937 random(argc > 3 ? stoul(argv[3]) : 42);
+
+    const vector<Dataset> datasets = {
+        MakeDataset("street (~10 m)", {55.75, 37.62}, 0.0001, point_count, random),
+        MakeDataset("city (~10 km)", {55.75, 37.62}, 0.1, point_count, random),
+        MakeDataset("global", {0, 0}, 180, point_count, random),
+        MakeDataset("antimeridian", {-17.7, 179.9}, 1, point_count, random),
+    };
+
+    cout << "batch instruction set: " << geo::GetBatchInstructionSet() << '\n';
+    for (const Dataset& dataset : datasets) {
+        geo::CoordinatesBatch batch;
+        vector<double> reference;
+        for (const geo::Coordinates& point : dataset.points) {
+            batch.Add(point);
+            reference.push_back(ComputeReferenceDistance(dataset.from, point));
+        }
+        const size_t count = dataset.points.size() * repeats;
+        vector<double> distances(dataset.points.size());
+        cout << dataset.name << ":\n";
+
+        double ms = Measure(repeats, [&] {
+            for (size_t i = 0; i < dataset.points.size(); ++i) {
+                distances[i] = geo::ComputeDistance(dataset.from, dataset.points[i]);
+            }
+        });
+        Report("ComputeDistance", distances, reference, ms, count);
+
+        ms = Measure(repeats, [&] {
+            for (size_t i = 0; i < dataset.points.size(); ++i) {
+                distances[i] = geo::ComputeHaversineDistance(dataset.from, dataset.points[i]);
+            }
+        });
+        Report("haversine", distances, reference, ms, count);
+
+        ms = Measure(repeats, [&] { geo::ComputeDistances(dataset.from, batch, distances); });
+        Report("batch", distances, reference, ms, count);
+
+        ms = Measure(repeats, [&] { geo::ComputeHaversineDistances(dataset.from, batch, distances); });
+        Report("batch haversine", distances, reference, ms, count);
+    }
+    return 0;
+}
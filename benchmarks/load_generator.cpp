@@ -0,0 +1,195 @@
+/*
+ * Генератор нагрузки для серверного режима (transport_catalogue --socket PATH).
+ * Запросы берутся из раздела stat_requests JSON-файла и отправляются по кругу через несколько соединений.
+ * Каждое соединение держит не более pipeline_depth запросов без ответа; сервер отвечает в порядке запросов,
+ * поэтому задержка запроса - время от его отправки до прихода строки ответа с тем же номером.
+ *
+ * Сборка: g++ -std=c++20 -O2 -pthread -I transport-catalogue benchmarks/load_generator.cpp \
+ *         transport-catalogue/json.cpp -o load_generator
+ * Запуск: load_generator SOCKET REQUESTS_JSON [число соединений] [запросов на соединение] [глубина конвейера]
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <semaphore>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "json.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr ptrdiff_t kMaxPipelineDepth = 1 << 16;
+
+// Результаты одного соединения
+struct ConnectionStats {
+    vector<double> latencies_us; // < задержки ответов в микросекундах
+    size_t errors = 0; // < число ответов на некорректные запросы
+    bool is_broken = false; // < флаг преждевременного закрытия соединения
+};
+
+int Connect(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, min(path.size(), sizeof(address.sun_path) - 1));
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        cerr << "Cannot connect to "sv << path << '\n';
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+bool WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t size = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(size));
+    }
+    return true;
+}
+
+/*
+ * Отправляет request_count запросов через одно соединение: поток отправки ждет свободного места в конвейере,
+ * а поток приема считает строки ответов и освобождает место
+ */
+ConnectionStats RunConnection(const string& path, const vector<string>& requests, size_t offset, size_t request_count, ptrdiff_t depth) {
+    const int fd = Connect(path);
+    ConnectionStats stats;
+    stats.latencies_us.reserve(request_count);
+    vector<Clock::time_point> sent_at(request_count);
+    counting_semaphore<kMaxPipelineDepth> window(depth);
+
+    thread receiver([&] {
+        string buffer;
+        size_t received = 0;
+        char chunk[1 << 16];
+        while (received < request_count) {
+            const ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+            if (size < 0 && errno == EINTR) {
+                continue;
+            }
+            if (size <= 0) {
+                stats.is_broken = true;
+                break;
+            }
+            buffer.append(chunk, static_cast<size_t>(size));
+            size_t begin = 0;
+            for (size_t end; (end = buffer.find('\n', begin)) != string::npos; begin = end + 1) {
+                const auto now = Clock::now();
+                stats.latencies_us.push_back(chrono::duration<double, micro>(now - sent_at[received]).count());
+                stats.errors += string_view(buffer).substr(begin, end - begin).find("\"invalid request\""sv) != string_view::npos;
+                ++received;
+                window.release();
+            }
+            buffer.erase(0, begin);
+        }
+        // Отправителю больше некого ждать
+        window.release(depth);
+    });
+
+    for (size_t i = 0; i < request_count; ++i) {
+        window.acquire();
+        sent_at[i] = Clock::now();
+        if (!WriteAll(fd, requests[(offset + i) % requests.size()])) {
+            break;
+        }
+    }
+    receiver.join();
+    close(fd);
+    return stats;
+}
+
+double Percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const size_t index = min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())));
+    return sorted[index];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: load_generator SOCKET REQUESTS_JSON [connections] [requests_per_connection] [pipeline_depth]\n"sv;
+        return EXIT_FAILURE;
+    }
+    const string path = argv[1];
+    const size_t connection_count = argc > 3 ? stoul(argv[3]) : 4;
+    const size_t request_count = argc > 4 ? stoul(argv[4]) : 10000;
+    const ptrdiff_t depth = clamp<ptrdiff_t>(argc > 5 ? stol(argv[5]) : 16, 1, kMaxPipelineDepth);
+
+    ifstream input(argv[2]);
+    if (!input) {
+        cerr << "Cannot open "sv << argv[2] << '\n';
+        return EXIT_FAILURE;
+    }
+    const json::Document document = json::Load(input);
+    vector<string> requests;
+    for (const json::Node& request : document.GetRoot().AsMap().at("stat_requests"s).AsArray()) {
+        ostringstream line;
+        json::Print(json::Document(request), line);
+        // Запрос должен занимать одну строку
+        string text = line.str();
+        replace(text.begin(), text.end(), '\n', ' ');
+        requests.push_back(move(text) + '\n');
+    }
+    if (requests.empty()) {
+        cerr << "No stat_requests in "sv << argv[2] << '\n';
+        return EXIT_FAILURE;
+    }
+
+    vector<ConnectionStats> stats(connection_count);
+    vector<thread> connections;
+    const auto start = Clock::now();
+    for (size_t c = 0; c < connection_count; ++c) {
+        connections.emplace_back([&, c] {
+            stats[c] = RunConnection(path, requests, c * request_count, request_count, depth);
+        });
+    }
+    for (thread& connection : connections) {
+        connection.join();
+    }
+    const double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<double> latencies;
+    size_t errors = 0;
+    size_t broken = 0;
+    for (const ConnectionStats& connection : stats) {
+        latencies.insert(latencies.end(), connection.latencies_us.begin(), connection.latencies_us.end());
+        errors += connection.errors;
+        broken += connection.is_broken;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    cout << fixed << setprecision(1)
+         << "connections: " << connection_count << ", pipeline depth: " << depth
+         << ", responses: " << latencies.size() << " (invalid " << errors << ", broken connections " << broken << ")\n"
+         << "throughput: " << static_cast<double>(latencies.size()) / seconds << " requests/s\n"
+         << "latency, us: p50 " << Percentile(latencies, 0.5) << ", p90 " << Percentile(latencies, 0.9)
+         << ", p99 " << Percentile(latencies, 0.99) << ", p99.9 " << Percentile(latencies, 0.999)
+         << ", max " << (latencies.empty() ? 0.0 : latencies.back()) << '\n';
+    return broken == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,162 @@
+/*
+ * Сравнение времени ответа на запросы маршрутов: поиск Дейкстры по графу маршрутов
+ * и двунаправленный поиск по иерархии сжатия.
+ * Каталог - синтетический город: остановки в узлах сетки, маршруты идут по улицам сетки.
+ *
+ * Сборка: g++ -std=c++20 -O2 -pthread -I transport-catalogue benchmarks/routing_benchmark.cpp \
+ *         transport-catalogue/{transport_catalogue,transport_router,geo}.cpp -o routing_benchmark
+ * Запуск: routing_benchmark [число остановок] [число маршрутов] [число запросов] [seed]
+ * По умолчанию - город масштаба мегаполиса: 20000 остановок, 2000 маршрутов, 1000 запросов
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+double ElapsedMs(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+string StopName(size_t index) {
+    return "Stop "s + to_string(index);
+}
+
+/*
+ * Строит синтетический город: side x side остановок в узлах сетки с шагом около 400 м.
+ * Каждый маршрут начинается в случайном узле и идет по улицам, чаще продолжая движение прямо, чем поворачивая
+ */
+void BuildCity(transport_catalogue::TransportCatalogue& catalogue, size_t stop_count, size_t bus_count, mt19937& random) {
+    const size_t side = max<size_t>(2, static_cast<size_t>(ceil(sqrt(static_cast<double>(stop_count)))));
+    uniform_real_distribution<double> jitter(-0.0005, 0.0005);
+    for (size_t i = 0; i < side * side; ++i) {
+        catalogue.AddStop(StopName(i), {55.5 + 0.0036 * (i / side) + jitter(random), 37.3 + 0.0063 * (i % side) + jitter(random)});
+    }
+
+    // Расстояние по дорогам немного больше расстояния по прямой
+    uniform_real_distribution<double> detour(1.05, 1.4);
+    auto connect = [&](size_t from, size_t to) {
+        const double distance = catalogue.GetGeoDistance(static_cast<domain::StopId>(from), static_cast<domain::StopId>(to));
+        catalogue.SetStopDistances(StopName(from), StopName(to), static_cast<int>(distance * detour(random)));
+    };
+    for (size_t i = 0; i < side * side; ++i) {
+        if ((i + 1) % side != 0) {
+            connect(i, i + 1);
+        }
+        if (i + side < side * side) {
+            connect(i, i + side);
+        }
+    }
+
+    const int dr[] = {0, 1, 0, -1};
+    const int dc[] = {1, 0, -1, 0};
+    uniform_int_distribution<size_t> start(0, side * side - 1);
+    uniform_int_distribution<int> length(10, 30);
+    uniform_int_distribution<int> direction(0, 3);
+    uniform_real_distribution<double> chance(0, 1);
+    for (size_t b = 0; b < bus_count; ++b) {
+        size_t cell = start(random);
+        int dir = direction(random);
+        vector<string> stops{StopName(cell)};
+        for (int step = length(random); step > 0; --step) {
+            if (chance(random) < 0.2) {
+                dir = (dir + (chance(random) < 0.5 ? 1 : 3)) % 4;
+            }
+            const int row = static_cast<int>(cell / side) + dr[dir];
+            const int col = static_cast<int>(cell % side) + dc[dir];
+            if (row < 0 || col < 0 || row >= static_cast<int>(side) || col >= static_cast<int>(side)) {
+                dir = (dir + 2) % 4;
+                continue;
+            }
+            cell = static_cast<size_t>(row) * side + static_cast<size_t>(col);
+            stops.push_back(StopName(cell));
+        }
+
+        // Кольцевой маршрут возвращается в начало по тем же улицам, обратный ход некольцевого добавляет каталог
+        const bool is_roundtrip = chance(random) < 0.3;
+        if (is_roundtrip) {
+            for (size_t i = stops.size() - 1; i-- > 0;) {
+                stops.push_back(stops[i]);
+            }
+        }
+        catalogue.AddBus("Bus "s + to_string(b), stops, is_roundtrip);
+    }
+
+    catalogue.BuildDistanceTable();
+    catalogue.BuildStopBusTable();
+    catalogue.UpdateBusesInfo();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t stop_count = argc > 1 ? stoul(argv[1]) : 20000;
+    const size_t bus_count = argc > 2 ? stoul(argv[2]) : stop_count / 10;
+    const size_t query_count = argc > 3 ? stoul(argv[3]) : 1000;
+    mt19937 random(argc > 4 ? stoul(argv[4]) : 42);
+
+    transport_catalogue::TransportCatalogue catalogue;
+    BuildCity(catalogue, stop_count, bus_count, random);
+
+    transport_router::RoutingSettings settings;
+    settings.bus_wait_time = 6;
+    settings.bus_velocity = 40;
+
+    auto start = Clock::now();
+    transport_router::TransportRouter router(catalogue, settings);
+    const double graph_ms = ElapsedMs(start);
+
+    vector<pair<string, string>> queries;
+    uniform_int_distribution<size_t> stop(0, catalogue.GetStopCount() - 1);
+    for (size_t i = 0; i < query_count; ++i) {
+        queries.emplace_back(catalogue.GetStop(stop(random))->name, catalogue.GetStop(stop(random))->name);
+    }
+
+    vector<double> dijkstra_times;
+    start = Clock::now();
+    for (const auto& [from, to] : queries) {
+        const auto route = router.FindRoute(from, to);
+        dijkstra_times.push_back(route ? route->total_time : -1);
+    }
+    const double dijkstra_ms = ElapsedMs(start);
+
+    start = Clock::now();
+    router.BuildContractionHierarchy();
+    const double hierarchy_ms = ElapsedMs(start);
+
+    // Иерархия может выбрать другой путь с тем же временем, суммы которого отличаются в последних знаках
+    size_t mismatches = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto route = router.FindRoute(queries[i].first, queries[i].second);
+        const double time = route ? route->total_time : -1;
+        mismatches += abs(time - dijkstra_times[i]) > 1e-9 * max(1.0, abs(time));
+    }
+    const double hierarchy_query_ms = ElapsedMs(start);
+
+    const auto& arrays = router.GetContractionHierarchy()->hierarchy.GetArrays();
+    cout << fixed << setprecision(3)
+         << "stops: " << catalogue.GetStopCount() << ", buses: " << catalogue.GetBusCount()
+         << ", graph edges: " << router.GetGraphHeader().edge_count << '\n'
+         << "graph build: " << graph_ms << " ms\n"
+         << "hierarchy build: " << hierarchy_ms << " ms, edges: " << arrays.edges.size()
+         << " (up " << arrays.up_arcs.size() << ", down " << arrays.down_arcs.size() << ")\n"
+         << "dijkstra query: " << dijkstra_ms / queries.size() << " ms\n"
+         << "hierarchy query: " << hierarchy_query_ms / queries.size() << " ms\n"
+         << "mismatched total times: " << mismatches << '\n';
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
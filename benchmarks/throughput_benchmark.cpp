@@ -0,0 +1,372 @@
+/*
+ * Бенчмарк пропускной способности основных этапов обработки запросов на синтетическом городе
+ * (см. city_generator.h) или на заданном входном JSON:
+ *   json::Load, json::arena::Load   - разбор входного JSON в дерево;
+ *   ParseRequest                    - потоковый разбор входа с добавлением остановок и маршрутов в каталог;
+ *   ApplyBaseRequests               - построение таблицы расстояний, статистики маршрутов, индексов и маршрутизатора;
+ *   GetBusInfo, GetStopInfo         - запросы к каталогу по именам маршрутов и остановок;
+ *   MapRenderer::Render             - отрисовка карты;
+ *   ApplyStatRequests               - выполнение всех запросов статистики (карта берется из кэша);
+ *   PrintStat                       - вывод ответов на запросы статистики.
+ * Каждый этап повторяется, пока не наберется заданное время, и для него выводится медиана времени повтора.
+ * Результаты можно сохранить в JSON (--json) и сравнить с сохраненными ранее (--baseline): при замедлении
+ * медианы больше допуска (--tolerance, по умолчанию 10%) бенчмарк завершается с ошибкой.
+ *
+ * Запуск: throughput_benchmark [параметры генератора] [--input FILE] [--threads N] [--min-time SECONDS]
+ *                              [--filter SUBSTRING] [--json FILE] [--baseline FILE] [--tolerance FRACTION]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "city_generator.h"
+#include "json.h"
+#include "json_arena.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+constexpr size_t kMinLookupCount = 100000; // < наименьшее число запросов к каталогу за повтор
+constexpr size_t kLookupStride = 7919; // < шаг перебора имен (простое число, чтобы обойти имена вразнобой)
+
+// Приемник результатов запросов, чтобы компилятор не выбросил их вычисление
+volatile size_t result_sink = 0;
+
+// Параметры запуска бенчмарка
+struct BenchmarkOptions {
+    city_generator::CityOptions city; // < параметры синтетического города
+    string input_file; // < входной JSON вместо синтетического города
+    size_t thread_count = 1; // < число потоков для выполнения запросов статистики и отрисовки карты
+    double min_time = 0.5; // < наименьшее суммарное время повторов этапа в секундах
+    string filter; // < подстрока имени для выбора этапов
+    string json_file; // < файл для сохранения результатов
+    string baseline_file; // < файл с результатами для сравнения
+    double tolerance = 0.1; // < допустимое относительное замедление медианы
+};
+
+// Результат измерения этапа
+struct CaseResult {
+    string name; // < имя этапа
+    size_t iterations = 0; // < число повторов
+    double median_ms = 0; // < медиана времени повтора
+    double min_ms = 0; // < наименьшее время повтора
+    size_t items = 0; // < число элементов, обработанных за повтор
+    string unit; // < единица элементов (bytes, requests, lookups, maps, responses)
+};
+
+/*
+ * Замер одного повтора. Этап сам вызывает Measure вокруг измеряемой части,
+ * поэтому подготовка (например, построение каталога для ApplyBaseRequests) во время повтора не входит
+ */
+class Stopwatch {
+public:
+    template <typename Body>
+    void Measure(Body&& body) {
+        const auto start = Clock::now();
+        body();
+        elapsed_ += Clock::now() - start;
+    }
+
+    double GetMs() const {
+        return chrono::duration<double, milli>(elapsed_).count();
+    }
+
+private:
+    Clock::duration elapsed_{};
+};
+
+// Этап бенчмарка
+struct Case {
+    string name; // < имя этапа
+    size_t items; // < число элементов, обрабатываемых за повтор
+    string unit; // < единица элементов
+    function<void(Stopwatch&)> run; // < один повтор этапа
+};
+
+// Повторяет этап, пока суммарное измеренное время не превысит min_time (не меньше трех повторов)
+CaseResult RunCase(const Case& benchmark_case, double min_time) {
+    // Первый повтор прогревает кэши и распределитель памяти и в результат не входит
+    Stopwatch warmup;
+    benchmark_case.run(warmup);
+
+    vector<double> times;
+    double total_ms = 0;
+    while (times.size() < 3 || total_ms < min_time * 1000) {
+        Stopwatch stopwatch;
+        benchmark_case.run(stopwatch);
+        times.push_back(stopwatch.GetMs());
+        total_ms += times.back();
+    }
+    sort(times.begin(), times.end());
+    return {benchmark_case.name, times.size(), times[times.size() / 2], times.front(), benchmark_case.items, benchmark_case.unit};
+}
+
+// Загруженный и обработанный вход, на котором выполняются этапы, не меняющие каталог
+struct Fixture {
+    string input; // < входной JSON
+    request_handler::RequestHandler rh; // < обработчик с построенным каталогом
+    map_renderer::MapRenderer mr; // < рендерер с настройками из входа
+    vector<request_handler::StatRequest> stat_requests; // < запросы статистики из входа
+    vector<request_handler::StatResponse> stat_responses; // < ответы на запросы статистики
+};
+
+void PrepareFixture(Fixture& fixture, size_t thread_count) {
+    fixture.rh.SetThreadCount(thread_count);
+    fixture.mr.SetWorkerPool(&fixture.rh.GetWorkerPool());
+    json_reader::ParseRequest(string_view(fixture.input), fixture.rh, fixture.mr);
+    fixture.rh.ApplyBaseRequests();
+
+    const json::arena::Document document = json::arena::Load(string_view(fixture.input));
+    if (const auto it = document.GetRoot().AsMap().find("stat_requests"sv); it != document.GetRoot().AsMap().end()) {
+        for (const json::arena::Node& request : it->second.AsArray()) {
+            fixture.stat_requests.push_back(json_reader::ParseStatRequest(request.AsMap()));
+        }
+    }
+    fixture.stat_responses = fixture.rh.ApplyStatRequests(fixture.mr);
+}
+
+vector<Case> MakeCases(Fixture& fixture, size_t thread_count) {
+    const transport_catalogue::TransportCatalogue& catalogue = fixture.rh.GetCatalogue();
+    vector<Case> cases;
+
+    cases.push_back({"json::Load", fixture.input.size(), "bytes", [&fixture](Stopwatch& stopwatch) {
+        stopwatch.Measure([&] {
+            const json::Document document = json::Load(string_view(fixture.input));
+        });
+    }});
+
+    cases.push_back({"json::arena::Load", fixture.input.size(), "bytes", [&fixture](Stopwatch& stopwatch) {
+        stopwatch.Measure([&] {
+            const json::arena::Document document = json::arena::Load(string_view(fixture.input));
+        });
+    }});
+
+    const size_t base_request_count = catalogue.GetStopCount() + catalogue.GetBusCount();
+    cases.push_back({"ParseRequest", base_request_count, "requests", [&fixture, thread_count](Stopwatch& stopwatch) {
+        request_handler::RequestHandler rh;
+        map_renderer::MapRenderer mr;
+        rh.SetThreadCount(thread_count);
+        stopwatch.Measure([&] {
+            json_reader::ParseRequest(string_view(fixture.input), rh, mr);
+        });
+    }});
+
+    cases.push_back({"ApplyBaseRequests", base_request_count, "requests", [&fixture, thread_count](Stopwatch& stopwatch) {
+        request_handler::RequestHandler rh;
+        map_renderer::MapRenderer mr;
+        rh.SetThreadCount(thread_count);
+        json_reader::ParseRequest(string_view(fixture.input), rh, mr);
+        stopwatch.Measure([&] {
+            rh.ApplyBaseRequests();
+        });
+    }});
+
+    // Имена запрашиваются в перемешанном порядке, и запросов достаточно, чтобы повтор не был короче точности таймера
+    vector<string_view> bus_names;
+    for (domain::BusId bus_id : catalogue.GetAllBuses()) {
+        bus_names.push_back(catalogue.GetBus(bus_id)->name);
+    }
+    vector<string_view> stop_names;
+    for (size_t id = 0; id < catalogue.GetStopCount(); ++id) {
+        stop_names.push_back(catalogue.GetStop(static_cast<domain::StopId>(id))->name);
+    }
+    auto make_lookups = [](const vector<string_view>& names) {
+        vector<string_view> lookups;
+        for (size_t i = 0; !names.empty() && i < max<size_t>(kMinLookupCount, names.size()); ++i) {
+            lookups.push_back(names[(i * kLookupStride) % names.size()]);
+        }
+        return lookups;
+    };
+
+    vector<string_view> bus_lookups = make_lookups(bus_names);
+    cases.push_back({"GetBusInfo", bus_lookups.size(), "lookups", [&catalogue, bus_lookups](Stopwatch& stopwatch) {
+        size_t total_stops = 0;
+        stopwatch.Measure([&] {
+            for (string_view name : bus_lookups) {
+                total_stops += catalogue.GetBusInfo(name).num_of_stops;
+            }
+        });
+        result_sink = total_stops;
+    }});
+
+    vector<string_view> stop_lookups = make_lookups(stop_names);
+    cases.push_back({"GetStopInfo", stop_lookups.size(), "lookups", [&catalogue, stop_lookups](Stopwatch& stopwatch) {
+        size_t total_buses = 0;
+        stopwatch.Measure([&] {
+            for (string_view name : stop_lookups) {
+                total_buses += catalogue.GetStopInfo(name).value_or(domain::StopInfo{}).size();
+            }
+        });
+        result_sink = total_buses;
+    }});
+
+    if (fixture.mr.HasRenderSettings()) {
+        cases.push_back({"MapRenderer::Render", 1, "maps", [&fixture, &catalogue](Stopwatch& stopwatch) {
+            ostringstream out;
+            stopwatch.Measure([&] {
+                fixture.mr.Render(out, catalogue);
+            });
+        }});
+    }
+
+    cases.push_back({"ApplyStatRequests", fixture.stat_requests.size(), "requests", [&fixture](Stopwatch& stopwatch) {
+        for (const request_handler::StatRequest& stat_request : fixture.stat_requests) {
+            fixture.rh.AddStatRequest(stat_request);
+        }
+        stopwatch.Measure([&] {
+            const vector<request_handler::StatResponse> stat_responses = fixture.rh.ApplyStatRequests(fixture.mr);
+        });
+    }});
+
+    cases.push_back({"PrintStat", fixture.stat_responses.size(), "responses", [&fixture](Stopwatch& stopwatch) {
+        ostringstream out;
+        stopwatch.Measure([&] {
+            json_reader::PrintStat(out, fixture.stat_responses);
+        });
+    }});
+
+    return cases;
+}
+
+void PrintResults(const vector<CaseResult>& results, ostream& out) {
+    out << left << setw(22) << "case" << right << setw(8) << "iters" << setw(14) << "median, ms" << setw(14) << "min, ms"
+        << setw(16) << "items/s" << "  unit\n";
+    for (const CaseResult& result : results) {
+        const double rate = result.median_ms > 0 ? static_cast<double>(result.items) / result.median_ms * 1000 : 0;
+        out << left << setw(22) << result.name << right << setw(8) << result.iterations << fixed << setprecision(3)
+            << setw(14) << result.median_ms << setw(14) << result.min_ms << setprecision(0) << setw(16) << rate
+            << "  " << result.unit << '\n';
+    }
+}
+
+void SaveResults(const vector<CaseResult>& results, const string& file) {
+    ofstream out(file);
+    out << setprecision(6);
+    json::Writer writer(out);
+    writer.StartArray();
+    for (const CaseResult& result : results) {
+        writer.StartDict()
+            .Key("items"sv).Value(static_cast<int>(result.items))
+            .Key("iterations"sv).Value(static_cast<int>(result.iterations))
+            .Key("median_ms"sv).Value(result.median_ms)
+            .Key("min_ms"sv).Value(result.min_ms)
+            .Key("name"sv).Value(result.name)
+            .Key("unit"sv).Value(result.unit)
+            .EndDict();
+    }
+    writer.EndArray();
+    out << '\n';
+}
+
+// Сравнивает медианы с сохраненными результатами и возвращает число этапов, замедлившихся больше допуска
+size_t CompareWithBaseline(const vector<CaseResult>& results, const string& file, double tolerance, ostream& out) {
+    ifstream input(file);
+    if (!input) {
+        throw runtime_error("Cannot open baseline "s + file);
+    }
+    const json::arena::Document baseline = json::arena::Load(input);
+    unordered_map<string_view, double> baseline_ms;
+    for (const json::arena::Node& result : baseline.GetRoot().AsArray()) {
+        baseline_ms[result.AsMap().at("name"sv).AsString()] = result.AsMap().at("median_ms"sv).AsDouble();
+    }
+
+    size_t regressions = 0;
+    out << "\ncompared with " << file << " (tolerance " << setprecision(0) << tolerance * 100 << "%):\n";
+    for (const CaseResult& result : results) {
+        const auto it = baseline_ms.find(result.name);
+        if (it == baseline_ms.end() || it->second <= 0) {
+            continue;
+        }
+        const double change = result.median_ms / it->second - 1;
+        const bool is_regression = change > tolerance;
+        regressions += is_regression;
+        out << left << setw(22) << result.name << right << showpos << setprecision(1) << setw(8) << change * 100 << noshowpos
+            << "%" << (is_regression ? "  REGRESSION" : "") << '\n';
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (city_generator::ParseOption(i, argc, argv, options.city)) {
+            continue;
+        }
+        if (arg == "--input"sv && has_value) {
+            options.input_file = argv[++i];
+        } else if (arg == "--threads"sv && has_value) {
+            options.thread_count = stoul(argv[++i]);
+        } else if (arg == "--min-time"sv && has_value) {
+            options.min_time = stod(argv[++i]);
+        } else if (arg == "--filter"sv && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--json"sv && has_value) {
+            options.json_file = argv[++i];
+        } else if (arg == "--baseline"sv && has_value) {
+            options.baseline_file = argv[++i];
+        } else if (arg == "--tolerance"sv && has_value) {
+            options.tolerance = stod(argv[++i]);
+        } else {
+            cerr << "Usage: throughput_benchmark "sv << city_generator::kOptionsUsage
+                 << "\n    [--input FILE] [--threads N] [--min-time SECONDS] [--filter SUBSTRING]"
+                    " [--json FILE] [--baseline FILE] [--tolerance FRACTION]\n"sv;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Fixture fixture;
+    if (options.input_file.empty()) {
+        ostringstream input;
+        city_generator::WriteCity(input, options.city);
+        fixture.input = move(input).str();
+    } else {
+        ifstream input(options.input_file);
+        if (!input) {
+            cerr << "Cannot open "sv << options.input_file << '\n';
+            return EXIT_FAILURE;
+        }
+        fixture.input.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    PrepareFixture(fixture, options.thread_count);
+
+    const transport_catalogue::TransportCatalogue& catalogue = fixture.rh.GetCatalogue();
+    cout << "input: " << fixture.input.size() << " bytes, stops: " << catalogue.GetStopCount()
+         << ", buses: " << catalogue.GetBusCount() << ", stat requests: " << fixture.stat_requests.size()
+         << ", threads: " << fixture.rh.GetWorkerCount() << "\n\n";
+
+    vector<CaseResult> results;
+    for (const Case& benchmark_case : MakeCases(fixture, options.thread_count)) {
+        if (benchmark_case.name.find(options.filter) != string::npos) {
+            results.push_back(RunCase(benchmark_case, options.min_time));
+        }
+    }
+    PrintResults(results, cout);
+
+    if (!options.json_file.empty()) {
+        SaveResults(results, options.json_file);
+    }
+    if (!options.baseline_file.empty() && CompareWithBaseline(results, options.baseline_file, options.tolerance, cout) > 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+# Запускает программу на входе золотого теста и сравнивает ее вывод с эталонным.
+#
+# Параметры (-D):
+#   PROGRAM - путь к программе transport_catalogue;
+#   INPUT   - вход теста (stat_requests отвечаются по нему);
+#   EXPECTED - эталонный вывод;
+#   OUTPUT  - файл, в который сохраняется вывод программы;
+#   ARGS    - аргументы программы через ";" (например "--online");
+#   BASE_INPUT - вход для предварительного запуска make_base (для тестов снимка каталога, необязателен).
+# Программа запускается в каталоге файла OUTPUT, поэтому относительные пути снимков указывают в каталог сборки.
+
+foreach(parameter PROGRAM INPUT EXPECTED OUTPUT)
+    if(NOT DEFINED ${parameter})
+        message(FATAL_ERROR "${parameter} is not set")
+    endif()
+endforeach()
+
+get_filename_component(work_dir "${OUTPUT}" DIRECTORY)
+
+if(DEFINED BASE_INPUT)
+    execute_process(COMMAND "${PROGRAM}" make_base
+                    INPUT_FILE "${BASE_INPUT}"
+                    WORKING_DIRECTORY "${work_dir}"
+                    RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "make_base failed: ${result}")
+    endif()
+endif()
+
+execute_process(COMMAND "${PROGRAM}" ${ARGS}
+                INPUT_FILE "${INPUT}"
+                OUTPUT_FILE "${OUTPUT}"
+                WORKING_DIRECTORY "${work_dir}"
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${PROGRAM} failed: ${result}")
+endif()
+
+execute_process(COMMAND "${CMAKE_COMMAND}" -E compare_files "${OUTPUT}" "${EXPECTED}"
+                RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    file(READ "${OUTPUT}" actual)
+    file(READ "${EXPECTED}" expected)
+    message(FATAL_ERROR "Output differs from ${EXPECTED}\nexpected:\n${expected}\nactual:\n${actual}")
+endif()
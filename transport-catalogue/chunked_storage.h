@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace chunked_storage {
+
+/* Возвращает изменяемый объект, предварительно копируя его, если указатель на него разделяется с другими владельцами.
+   Новые владельцы появляются только при копировании в потоке, который вызывает функцию, поэтому единственный владелец
+   остается единственным, а барьер упорядочивает запись после чтений объекта в потоках, освободивших его раньше */
+template <typename T>
+T& MakeUnique(std::shared_ptr<T>& object) {
+    if (object.use_count() != 1) {
+        object = std::make_shared<T>(*object);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *object;
+}
+
+/*
+ * Вектор из блоков по ChunkSize элементов с копированием при записи.
+ * Копия вектора копирует только указатели на блоки, а блок копируется при первом изменении в одной из копий,
+ * поэтому копия обходится в (размер / ChunkSize) указателей, а изменение - в копирование одного блока.
+ * Элементы не перемещаются при добавлении новых: указатель на элемент действителен, пока жива копия,
+ * из которой он получен, и ее блок не скопирован изменением
+ */
+template <typename T, size_t ChunkSize = 256>
+class ChunkedVector {
+public:
+    // Возвращает элемент с номером index
+    const T& Get(size_t index) const {
+        return (*chunks_[index / ChunkSize])[index % ChunkSize];
+    }
+
+    // Возвращает изменяемый элемент с номером index, копируя его блок, если блок разделяется с другими копиями
+    T& GetMutable(size_t index) {
+        return GetMutableChunk(index / ChunkSize)[index % ChunkSize];
+    }
+
+    // Добавляет элемент в конец вектора
+    void Add(T value) {
+        if (size_ % ChunkSize == 0) {
+            chunks_.push_back(std::make_shared<Chunk>());
+            chunks_.back()->reserve(ChunkSize);
+        }
+        GetMutableChunk(chunks_.size() - 1).push_back(std::move(value));
+        ++size_;
+    }
+
+    // Возвращает количество элементов
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    // Блок элементов (емкость резервируется сразу, чтобы добавление не перемещало элементы)
+    struct Chunk : std::vector<T> {
+        Chunk() = default;
+
+        Chunk(const Chunk& other)
+            : std::vector<T>() {
+            this->reserve(ChunkSize);
+            this->assign(other.begin(), other.end());
+        }
+    };
+
+    // Возвращает изменяемый блок, копируя его, если он разделяется с другими копиями вектора
+    Chunk& GetMutableChunk(size_t chunk_index) {
+        return MakeUnique(chunks_[chunk_index]);
+    }
+
+    std::vector<std::shared_ptr<Chunk>> chunks_; // < блоки элементов
+    size_t size_ = 0; // < количество элементов
+};
+
+/*
+ * Хеш-таблица из сегментов с копированием при записи.
+ * Копия таблицы копирует только указатели на сегменты, а сегмент копируется при первом изменении в одной из копий.
+ * Число сегментов удваивается вместе с числом элементов, так что сегмент в среднем хранит не больше kShardSize элементов,
+ * и изменение обходится в копирование одного небольшого сегмента.
+ * Hash и KeyEqual могут быть прозрачными, тогда поиск принимает ключи других типов (например, std::string_view)
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ShardedMap {
+public:
+    static constexpr size_t kShardSize = 64; // < среднее число элементов сегмента, при превышении которого сегментов становится вдвое больше
+
+    // Возвращает значение по ключу (nullptr, если ключа нет)
+    template <typename K>
+    const Value* Find(const K& key) const {
+        if (size_ == 0) {
+            return nullptr;
+        }
+        const Shard& shard = *shards_[GetShardIndex(key)];
+        const auto it = shard.find(key);
+        return it != shard.end() ? &it->second : nullptr;
+    }
+
+    /* Возвращает изменяемое значение по ключу, вставляя значение по умолчанию при отсутствии ключа.
+       Второй элемент пары - флаг вставки. Указатель действителен до следующего изменения таблицы */
+    std::pair<Value*, bool> TryEmplace(const Key& key) {
+        if (shards_.empty() || size_ >= shards_.size() * kShardSize) {
+            Grow();
+        }
+        auto [it, inserted] = MakeUnique(shards_[GetShardIndex(key)]).try_emplace(key);
+        size_ += inserted;
+        return {&it->second, inserted};
+    }
+
+    // Задает значение по ключу
+    void Set(const Key& key, Value value) {
+        *TryEmplace(key).first = std::move(value);
+    }
+
+    // Передает обработчику все пары ключ-значение
+    template <typename Visitor>
+    void ForEach(Visitor&& visitor) const {
+        for (const std::shared_ptr<Shard>& shard : shards_) {
+            for (const auto& [key, value] : *shard) {
+                visitor(key, value);
+            }
+        }
+    }
+
+    // Удаляет все элементы
+    void Clear() {
+        shards_.clear();
+        size_ = 0;
+    }
+
+    // Возвращает количество элементов
+    size_t Size() const {
+        return size_;
+    }
+
+    // Проверяет, что таблица пуста
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+private:
+    using Shard = std::unordered_map<Key, Value, Hash, KeyEqual>;
+
+    // Возвращает номер сегмента ключа: хеш перемешивается, чтобы номер не зависел только от младших битов ключа
+    template <typename K>
+    size_t GetShardIndex(const K& key) const {
+        const uint64_t hash = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+        return static_cast<size_t>(hash >> 32) & (shards_.size() - 1);
+    }
+
+    // Удваивает число сегментов, перераспределяя элементы (в среднем не больше двух копирований элемента на вставку)
+    void Grow() {
+        const size_t shard_count = shards_.empty() ? 1 : 2 * shards_.size();
+        std::vector<std::shared_ptr<Shard>> old_shards = std::exchange(shards_, {});
+        shards_.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.push_back(std::make_shared<Shard>());
+        }
+        for (const std::shared_ptr<Shard>& shard : old_shards) {
+            for (const auto& [key, value] : *shard) {
+                shards_[GetShardIndex(key)]->emplace(key, value);
+            }
+        }
+    }
+
+    std::vector<std::shared_ptr<Shard>> shards_; // < сегменты таблицы (число сегментов - степень двойки)
+    size_t size_ = 0; // < количество элементов
+};
+
+} // namespace chunked_storage
@@ -0,0 +1,580 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+
+/*
+ * Иерархия сжатия (contraction hierarchy) ориентированного взвешенного графа.
+ * Вершины по очереди исключаются из графа в порядке возрастания важности, а кратчайшие пути через исключенную
+ * вершину сохраняются короткими связями (shortcut) между ее соседями. Номер вершины в этом порядке - ее ранг.
+ * Поиск пути - двунаправленный Дейкстра, в котором обе стороны идут только к вершинам большего ранга,
+ * поэтому просматривается лишь небольшая часть графа. Короткие связи раскрываются в ребра исходного графа.
+ * Вершины в массивах иерархии пронумерованы рангами: важные вершины, которые просматривает почти каждый поиск,
+ * лежат в памяти рядом.
+ * Иерархия неизменяема после построения, ее копии разделяют общую память
+ */
+template <typename Weight>
+class ContractionHierarchy {
+public:
+    // Ребро иерархии в списке смежности вершины
+    struct Arc {
+        VertexId to; // < ранг соседней вершины (большего ранга)
+        EdgeId edge_id; // < номер ребра иерархии
+        Weight weight; // < вес ребра
+    };
+
+    // Состав ребра иерархии: ребро исходного графа (second == kNoEdge) или пара ребер иерархии, замененных короткой связью
+    struct Edge {
+        EdgeId first; // < номер ребра исходного графа или первого ребра иерархии
+        EdgeId second; // < номер второго ребра иерархии
+    };
+
+    // Массивы иерархии (указывают либо на собственную память иерархии, либо на внешнюю, например отображенный в память файл)
+    struct Arrays {
+        std::span<const VertexId> ranks; // < ранг каждой вершины графа
+        std::span<const uint32_t> up_offsets; // < начало списка ребер вверх вершины каждого ранга (размер - число вершин + 1)
+        std::span<const Arc> up_arcs; // < исходящие ребра к вершинам большего ранга
+        std::span<const uint32_t> down_offsets; // < начало списка ребер вниз вершины каждого ранга (размер - число вершин + 1)
+        std::span<const Arc> down_arcs; // < входящие ребра от вершин большего ранга (to - начало ребра)
+        std::span<const Edge> edges; // < состав ребер иерархии по их номерам
+    };
+
+    static constexpr EdgeId kNoEdge = Router<Weight>::kNoEdge;
+
+    ContractionHierarchy() = default;
+
+    // Строит иерархию по графу
+    explicit ContractionHierarchy(const DirectedWeightedGraph<Weight>& graph) {
+        Contractor contractor(graph);
+        contractor.Run();
+        const Arrays arrays = contractor.GetArrays();
+        Attach(arrays, contractor.ReleaseStorage());
+    }
+
+    // Строит кратчайший путь между вершинами, если он существует (ребра пути - ребра исходного графа)
+    std::optional<typename Router<Weight>::RouteInfo> BuildRoute(VertexId from, VertexId to) const {
+        if (from == to) {
+            return typename Router<Weight>::RouteInfo{Weight{}, {}};
+        }
+
+        Workspace& workspace = GetWorkspace();
+        const uint32_t stamp = workspace.NextStamp();
+        Side& forward = workspace.forward;
+        Side& backward = workspace.backward;
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+        Queue forward_queue;
+        Queue backward_queue;
+
+        const VertexId source = arrays_.ranks[from];
+        const VertexId target = arrays_.ranks[to];
+        forward.Visit(source, stamp, Weight{}, kNoEdge, source);
+        forward_queue.push({Weight{}, source});
+        backward.Visit(target, stamp, Weight{}, kNoEdge, target);
+        backward_queue.push({Weight{}, target});
+
+        Weight best = std::numeric_limits<Weight>::infinity();
+        VertexId meeting = source;
+        /* Шаг одной стороны поиска: arcs - ребра вверх в направлении этой стороны, opposite_arcs - ребра в обратном направлении.
+           Если до вершины есть более короткий путь через соседа большего ранга, ее ребра не просматриваются (stall-on-demand):
+           кратчайший путь через такую вершину все равно найдется через этого соседа.
+           Вершины, путь до которых не короче уже найденного пути, в очередь не добавляются */
+        auto step = [&](Queue& queue, Side& side, const Side& other, std::span<const uint32_t> offsets, std::span<const Arc> arcs,
+                        std::span<const uint32_t> opposite_offsets, std::span<const Arc> opposite_arcs) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > side.labels[vertex].weight) {
+                return; // Устаревшая запись очереди
+            }
+            const Label& other_label = other.labels[vertex];
+            if (other_label.stamp == stamp && weight + other_label.weight < best) {
+                best = weight + other_label.weight;
+                meeting = vertex;
+            }
+            for (uint32_t i = opposite_offsets[vertex]; i < opposite_offsets[vertex + 1]; ++i) {
+                const Arc& arc = opposite_arcs[i];
+                const Label& label = side.labels[arc.to];
+                if (label.stamp == stamp && label.weight + arc.weight < weight) {
+                    return;
+                }
+            }
+            for (uint32_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = arcs[i];
+                const Weight new_weight = weight + arc.weight;
+                if (new_weight >= best) {
+                    continue;
+                }
+                const Label& label = side.labels[arc.to];
+                if (label.stamp != stamp || new_weight < label.weight) {
+                    side.Visit(arc.to, stamp, new_weight, arc.edge_id, vertex);
+                    queue.push({new_weight, arc.to});
+                }
+            }
+        };
+
+        // Каждая сторона останавливается, когда ее ближайшая вершина не может улучшить найденный путь
+        while (true) {
+            const bool can_forward = !forward_queue.empty() && forward_queue.top().first < best;
+            const bool can_backward = !backward_queue.empty() && backward_queue.top().first < best;
+            if (!can_forward && !can_backward) {
+                break;
+            }
+            if (can_forward && (!can_backward || forward_queue.top().first <= backward_queue.top().first)) {
+                step(forward_queue, forward, backward, arrays_.up_offsets, arrays_.up_arcs, arrays_.down_offsets, arrays_.down_arcs);
+            } else {
+                step(backward_queue, backward, forward, arrays_.down_offsets, arrays_.down_arcs, arrays_.up_offsets, arrays_.up_arcs);
+            }
+        }
+
+        if (best == std::numeric_limits<Weight>::infinity()) {
+            return std::nullopt;
+        }
+
+        // Ребра иерархии пути: от начала до точки встречи и от точки встречи до конца
+        std::vector<EdgeId> hierarchy_edges;
+        for (VertexId vertex = meeting; forward.labels[vertex].prev_edge != kNoEdge; vertex = forward.labels[vertex].prev_vertex) {
+            hierarchy_edges.push_back(forward.labels[vertex].prev_edge);
+        }
+        std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+        for (VertexId vertex = meeting; backward.labels[vertex].prev_edge != kNoEdge; vertex = backward.labels[vertex].prev_vertex) {
+            hierarchy_edges.push_back(backward.labels[vertex].prev_edge);
+        }
+
+        typename Router<Weight>::RouteInfo route{best, {}};
+        std::vector<EdgeId> stack;
+        for (EdgeId hierarchy_edge : hierarchy_edges) {
+            stack.push_back(hierarchy_edge);
+            while (!stack.empty()) {
+                const Edge& edge = arrays_.edges[stack.back()];
+                stack.pop_back();
+                if (edge.second == kNoEdge) {
+                    route.edges.push_back(edge.first);
+                } else {
+                    stack.push_back(edge.second);
+                    stack.push_back(edge.first);
+                }
+            }
+        }
+        return route;
+    }
+
+    // Возвращает количество вершин графа иерархии
+    size_t GetVertexCount() const {
+        return arrays_.up_offsets.empty() ? 0 : arrays_.up_offsets.size() - 1;
+    }
+
+    // Возвращает массивы иерархии
+    const Arrays& GetArrays() const {
+        return arrays_;
+    }
+
+    /* Использует готовые массивы без копирования.
+       owner продлевает время жизни памяти, на которую указывают массивы */
+    void Attach(const Arrays& arrays, std::shared_ptr<const void> owner) {
+        arrays_ = arrays;
+        storage_ = std::move(owner);
+    }
+
+private:
+    // Состояние вершины в одной стороне поиска (поля рядом, чтобы просмотр вершины читал одну строку кеша)
+    struct Label {
+        Weight weight; // < найденное расстояние до вершины
+        EdgeId prev_edge; // < последнее ребро иерархии найденного пути
+        VertexId prev_vertex; // < предыдущая вершина найденного пути
+        uint32_t stamp = 0; // < поколение запроса, в котором вершина была достигнута
+    };
+
+    // Рабочий массив одной стороны двунаправленного поиска
+    struct Side {
+        std::vector<Label> labels; // < состояния вершин по рангам
+
+        void Resize(size_t vertex_count) {
+            if (labels.size() < vertex_count) {
+                labels.resize(vertex_count);
+            }
+        }
+
+        void Visit(VertexId vertex, uint32_t current_stamp, Weight weight, EdgeId prev_edge, VertexId prev_vertex) {
+            labels[vertex] = {weight, prev_edge, prev_vertex, current_stamp};
+        }
+    };
+
+    // Рабочие массивы поиска, принадлежащие одному потоку
+    struct Workspace {
+        Side forward; // < поиск от начальной вершины
+        Side backward; // < поиск от конечной вершины
+        uint32_t stamp = 0; // < поколение текущего запроса
+
+        uint32_t NextStamp() {
+            if (++stamp == 0) {
+                // Счетчик переполнился - сбрасываем отметки, чтобы старые не совпали с новыми
+                for (Side* side : {&forward, &backward}) {
+                    for (Label& label : side->labels) {
+                        label.stamp = 0;
+                    }
+                }
+                stamp = 1;
+            }
+            return stamp;
+        }
+    };
+
+    Workspace& GetWorkspace() const {
+        thread_local Workspace workspace;
+        workspace.forward.Resize(GetVertexCount());
+        workspace.backward.Resize(GetVertexCount());
+        return workspace;
+    }
+
+    /*
+     * Построение иерархии.
+     * Пока вершины не исключены, граф хранится списками смежности, после исключения каждой вершины
+     * ее оставшиеся ребра становятся ребрами иерархии (к соседям большего ранга).
+     * Положение каждого ребра в списках смежности обоих концов хранится в хеш-таблице по паре вершин,
+     * поэтому добавление или уточнение короткой связи и удаление ребер исключенной вершины не просматривают списки
+     */
+    class Contractor {
+    public:
+        explicit Contractor(const DirectedWeightedGraph<Weight>& graph)
+            : vertex_count_(graph.GetVertexCount())
+            , out_(vertex_count_)
+            , in_(vertex_count_)
+            , priorities_(vertex_count_, 0)
+            , is_outdated_(vertex_count_, false)
+            , is_contracted_(vertex_count_, false)
+            , contracted_neighbours_(vertex_count_, 0)
+            , depths_(vertex_count_, 0)
+            , witness_weights_(vertex_count_)
+            , witness_stamps_(vertex_count_, 0)
+            , target_stamps_(vertex_count_, 0)
+            , target_bounds_(vertex_count_)
+            , up_(vertex_count_)
+            , down_(vertex_count_) {
+            storage_ = std::make_shared<Storage>();
+            order_.reserve(vertex_count_);
+            positions_.reserve(graph.GetEdgeCount() * 2);
+            for (EdgeId id = 0; id < graph.GetEdgeCount(); ++id) {
+                const graph::Edge<Weight>& edge = graph.GetEdge(id);
+                if (edge.from == edge.to) {
+                    continue;
+                }
+                // Из параллельных ребер остается самое легкое (при равенстве - с меньшим номером)
+                const std::optional<EdgeId> hierarchy_edge = AddLink(edge.from, edge.to, edge.weight);
+                if (hierarchy_edge) {
+                    storage_->edges[*hierarchy_edge] = {id, kNoEdge};
+                }
+            }
+        }
+
+        // Исключает все вершины в порядке возрастания важности
+        void Run() {
+            using QueueItem = std::pair<int, VertexId>;
+            std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                priorities_[vertex] = GetPriority(vertex);
+                queue.push({priorities_[vertex], vertex});
+            }
+
+            /* Исключение вершины меняет важность только ее соседей, поэтому они лишь помечаются устаревшими,
+               а пересчитывается важность при извлечении из очереди (ленивое обновление). Вершина, важность которой
+               выросла так, что она уже не наименьшая, возвращается в очередь с новой важностью */
+            while (!queue.empty()) {
+                const auto [priority, vertex] = queue.top();
+                queue.pop();
+                if (is_contracted_[vertex] || priority != priorities_[vertex]) {
+                    continue; // Устаревшая запись очереди
+                }
+                if (is_outdated_[vertex]) {
+                    is_outdated_[vertex] = false;
+                    priorities_[vertex] = GetPriority(vertex);
+                    if (!queue.empty() && priorities_[vertex] > queue.top().first) {
+                        queue.push({priorities_[vertex], vertex});
+                        continue;
+                    }
+                }
+                Contract(vertex);
+            }
+
+            BuildArrays();
+        }
+
+        Arrays GetArrays() const {
+            return {storage_->ranks, storage_->up_offsets, storage_->up_arcs, storage_->down_offsets, storage_->down_arcs,
+                    storage_->edges};
+        }
+
+        std::shared_ptr<const void> ReleaseStorage() {
+            return std::move(storage_);
+        }
+
+    private:
+        // Ограничения числа вершин, просматриваемых при поиске свидетеля (альтернативного пути не через исключаемую вершину):
+        // при оценке важности вершины достаточно приближенного числа коротких связей, при исключении поиск точнее
+        static constexpr size_t kSimulationSettleLimit = 30;
+        static constexpr size_t kContractionSettleLimit = 1000;
+
+        // Ребро графа, еще не вошедшее в иерархию
+        struct Link {
+            VertexId vertex; // < соседняя вершина
+            Weight weight; // < вес ребра
+            EdgeId edge_id; // < номер ребра иерархии
+        };
+
+        // Положение ребра в списках смежности его концов
+        struct LinkPosition {
+            uint32_t out_index; // < номер ребра в списке исходящих ребер начала
+            uint32_t in_index; // < номер ребра в списке входящих ребер конца
+        };
+
+        // Собственная память иерархии
+        struct Storage {
+            std::vector<VertexId> ranks;
+            std::vector<uint32_t> up_offsets;
+            std::vector<Arc> up_arcs;
+            std::vector<uint32_t> down_offsets;
+            std::vector<Arc> down_arcs;
+            std::vector<Edge> edges;
+        };
+
+        using QueueItem = std::pair<Weight, VertexId>;
+
+        static uint64_t GetLinkKey(VertexId from, VertexId to) {
+            return (static_cast<uint64_t>(from) << 32) | to;
+        }
+
+        /* Добавляет ребро from -> to или уменьшает вес уже существующего.
+           Возвращает номер нового ребра иерархии, если ребро было добавлено или заменено */
+        std::optional<EdgeId> AddLink(VertexId from, VertexId to, Weight weight) {
+            const auto [it, is_new] = positions_.try_emplace(GetLinkKey(from, to), LinkPosition{
+                static_cast<uint32_t>(out_[from].size()), static_cast<uint32_t>(in_[to].size())});
+            if (!is_new && out_[from][it->second.out_index].weight <= weight) {
+                return std::nullopt;
+            }
+
+            const EdgeId edge_id = static_cast<EdgeId>(storage_->edges.size());
+            storage_->edges.push_back({kNoEdge, kNoEdge});
+            if (is_new) {
+                out_[from].push_back({to, weight, edge_id});
+                in_[to].push_back({from, weight, edge_id});
+            } else {
+                out_[from][it->second.out_index] = {to, weight, edge_id};
+                in_[to][it->second.in_index] = {from, weight, edge_id};
+            }
+            return edge_id;
+        }
+
+        /* Ищет пути от вершины source до соседей targets исключаемой вершины в оставшемся графе без нее.
+           Путь до соседа достаточен, если он не длиннее пути через исключаемую вершину (in_weight + вес ребра до соседа).
+           Поиск останавливается, когда достаточные пути найдены до всех соседей, и ограничен весом limit и числом
+           settle_limit просмотренных вершин (ненайденный свидетель лишь добавляет лишнюю, но корректную короткую связь) */
+        void FindWitnesses(VertexId source, VertexId excluded, Weight in_weight, const std::vector<Link>& targets,
+                           Weight limit, size_t settle_limit) {
+            if (++witness_stamp_ == 0) {
+                std::fill(witness_stamps_.begin(), witness_stamps_.end(), 0);
+                std::fill(target_stamps_.begin(), target_stamps_.end(), 0);
+                witness_stamp_ = 1;
+            }
+            size_t targets_left = 0;
+            for (const Link& target : targets) {
+                if (target.vertex != source) {
+                    target_stamps_[target.vertex] = witness_stamp_;
+                    target_bounds_[target.vertex] = in_weight + target.weight;
+                    ++targets_left;
+                }
+            }
+
+            // Куча поиска переиспользуется между поисками, чтобы не выделять память на каждого соседа
+            witness_queue_.clear();
+            witness_stamps_[source] = witness_stamp_;
+            witness_weights_[source] = Weight{};
+            witness_queue_.push_back({Weight{}, source});
+            size_t settled = 0;
+            while (!witness_queue_.empty() && settled < settle_limit && targets_left > 0) {
+                std::pop_heap(witness_queue_.begin(), witness_queue_.end(), std::greater<QueueItem>{});
+                const auto [weight, vertex] = witness_queue_.back();
+                witness_queue_.pop_back();
+                if (weight > witness_weights_[vertex]) {
+                    continue;
+                }
+                ++settled;
+                for (const Link& link : out_[vertex]) {
+                    if (link.vertex == excluded) {
+                        continue;
+                    }
+                    const Weight new_weight = weight + link.weight;
+                    if (new_weight > limit) {
+                        continue; // Путь длиннее любого пути через исключаемую вершину не может быть свидетелем
+                    }
+                    if (witness_stamps_[link.vertex] != witness_stamp_ || new_weight < witness_weights_[link.vertex]) {
+                        witness_stamps_[link.vertex] = witness_stamp_;
+                        witness_weights_[link.vertex] = new_weight;
+                        witness_queue_.push_back({new_weight, link.vertex});
+                        std::push_heap(witness_queue_.begin(), witness_queue_.end(), std::greater<QueueItem>{});
+                        if (target_stamps_[link.vertex] == witness_stamp_ && new_weight <= target_bounds_[link.vertex]) {
+                            target_stamps_[link.vertex] = 0;
+                            --targets_left;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Проверяет, что найден путь до вершины не длиннее заданного
+        bool HasWitness(VertexId vertex, Weight weight) const {
+            return witness_stamps_[vertex] == witness_stamp_ && witness_weights_[vertex] <= weight;
+        }
+
+        /* Исключает вершину, добавляя короткие связи между соседями, если без них кратчайший путь теряется.
+           Если simulate, только подсчитывает число необходимых коротких связей.
+           Короткие связи соединяют соседей между собой, поэтому списки ребер самой вершины при их добавлении не меняются */
+        int ProcessVertex(VertexId vertex, bool simulate) {
+            int shortcut_count = 0;
+            const std::vector<Link>& in = in_[vertex];
+            const std::vector<Link>& out = out_[vertex];
+            Weight max_out_weight = Weight{};
+            for (const Link& out_link : out) {
+                max_out_weight = std::max(max_out_weight, out_link.weight);
+            }
+            for (const Link& in_link : in) {
+                FindWitnesses(in_link.vertex, vertex, in_link.weight, out, in_link.weight + max_out_weight,
+                              simulate ? kSimulationSettleLimit : kContractionSettleLimit);
+                for (const Link& out_link : out) {
+                    if (out_link.vertex == in_link.vertex) {
+                        continue;
+                    }
+                    const Weight weight = in_link.weight + out_link.weight;
+                    if (HasWitness(out_link.vertex, weight)) {
+                        continue;
+                    }
+                    ++shortcut_count;
+                    if (!simulate) {
+                        const std::optional<EdgeId> shortcut = AddLink(in_link.vertex, out_link.vertex, weight);
+                        if (shortcut) {
+                            storage_->edges[*shortcut] = {in_link.edge_id, out_link.edge_id};
+                        }
+                    }
+                }
+            }
+            return shortcut_count;
+        }
+
+        /* Важность вершины: разность добавляемых и удаляемых ребер, число уже исключенных соседей
+           и глубина вершины в иерархии. Последние два слагаемых распределяют исключение равномерно по графу,
+           благодаря чему иерархия получается неглубокой, а поиск просматривает мало вершин */
+        int GetPriority(VertexId vertex) {
+            const int shortcut_count = ProcessVertex(vertex, true);
+            const int edge_difference = shortcut_count - static_cast<int>(in_[vertex].size() + out_[vertex].size());
+            return 2 * edge_difference + contracted_neighbours_[vertex] + depths_[vertex];
+        }
+
+        // Исключает вершину, превращая ее оставшиеся ребра в ребра иерархии
+        void Contract(VertexId vertex) {
+            ProcessVertex(vertex, false);
+            is_contracted_[vertex] = true;
+            order_.push_back(vertex);
+
+            auto update_neighbour = [this, vertex](VertexId neighbour) {
+                ++contracted_neighbours_[neighbour];
+                depths_[neighbour] = std::max(depths_[neighbour], depths_[vertex] + 1);
+                is_outdated_[neighbour] = true;
+            };
+            for (const Link& link : out_[vertex]) {
+                up_[vertex].push_back({link.vertex, link.edge_id, link.weight});
+                EraseLink(vertex, link.vertex, false);
+                update_neighbour(link.vertex);
+            }
+            for (const Link& link : in_[vertex]) {
+                down_[vertex].push_back({link.vertex, link.edge_id, link.weight});
+                EraseLink(link.vertex, vertex, true);
+                update_neighbour(link.vertex);
+            }
+            out_[vertex] = {};
+            in_[vertex] = {};
+        }
+
+        /* Удаляет ребро from -> to из списка соседа исключаемой вершины: входящих ребер to (from_out == false)
+           или исходящих ребер from (from_out == true). На место удаленного ребра переносится последнее ребро списка */
+        void EraseLink(VertexId from, VertexId to, bool from_out) {
+            const auto it = positions_.find(GetLinkKey(from, to));
+            const uint32_t index = from_out ? it->second.out_index : it->second.in_index;
+            positions_.erase(it);
+
+            std::vector<Link>& links = from_out ? out_[from] : in_[to];
+            if (index + 1 != links.size()) {
+                links[index] = links.back();
+                if (from_out) {
+                    positions_.find(GetLinkKey(from, links[index].vertex))->second.out_index = index;
+                } else {
+                    positions_.find(GetLinkKey(links[index].vertex, to))->second.in_index = index;
+                }
+            }
+            links.pop_back();
+        }
+
+        // Переводит собранные списки ребер иерархии в формат CSR, нумеруя вершины рангами
+        void BuildArrays() {
+            std::vector<VertexId>& ranks = storage_->ranks;
+            ranks.resize(vertex_count_);
+            for (size_t rank = 0; rank < order_.size(); ++rank) {
+                ranks[order_[rank]] = static_cast<VertexId>(rank);
+            }
+
+            auto flatten = [this, &ranks](std::vector<std::vector<Arc>>& lists, std::vector<uint32_t>& offsets, std::vector<Arc>& arcs) {
+                offsets.assign(1, 0);
+                offsets.reserve(vertex_count_ + 1);
+                for (VertexId vertex : order_) {
+                    for (Arc arc : lists[vertex]) {
+                        arc.to = ranks[arc.to];
+                        arcs.push_back(arc);
+                    }
+                    offsets.push_back(static_cast<uint32_t>(arcs.size()));
+                    lists[vertex] = {};
+                }
+            };
+            flatten(up_, storage_->up_offsets, storage_->up_arcs);
+            flatten(down_, storage_->down_offsets, storage_->down_arcs);
+        }
+
+        size_t vertex_count_; // < количество вершин графа
+        std::vector<std::vector<Link>> out_; // < исходящие ребра неисключенных вершин
+        std::vector<std::vector<Link>> in_; // < входящие ребра неисключенных вершин
+        std::unordered_map<uint64_t, LinkPosition> positions_; // < положение ребер неисключенных вершин по паре концов
+        std::vector<int> priorities_; // < последняя рассчитанная важность вершины
+        std::vector<bool> is_outdated_; // < флаг устаревшей важности (после исключения соседа)
+        std::vector<bool> is_contracted_; // < флаг исключенной вершины
+        std::vector<int> contracted_neighbours_; // < число исключенных соседей вершины
+        std::vector<int> depths_; // < глубина вершины в иерархии (наибольшая глубина исключенного соседа + 1)
+        std::vector<VertexId> order_; // < исключенные вершины в порядке исключения
+
+        std::vector<Weight> witness_weights_; // < расстояния поиска свидетеля
+        std::vector<uint32_t> witness_stamps_; // < отметки вершин, достигнутых поиском свидетеля
+        std::vector<uint32_t> target_stamps_; // < отметки соседей, до которых еще не найден достаточный путь при поиске свидетеля
+        std::vector<Weight> target_bounds_; // < наибольший вес достаточного пути до соседа
+        std::vector<QueueItem> witness_queue_; // < куча поиска свидетеля
+        uint32_t witness_stamp_ = 0; // < отметка текущего поиска свидетеля
+
+        std::vector<std::vector<Arc>> up_; // < ребра иерархии вверх по вершинам
+        std::vector<std::vector<Arc>> down_; // < ребра иерархии вниз по вершинам (to - начало ребра)
+        std::shared_ptr<Storage> storage_; // < память строящейся иерархии
+    };
+
+    Arrays arrays_; // < массивы иерархии
+    std::shared_ptr<const void> storage_; // < владелец памяти массивов
+};
+
+} // namespace graph
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <set>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -8,15 +10,14 @@
 
 namespace domain {
 
+using StopId = uint32_t; // < порядковый номер остановки в каталоге
+using BusId = uint32_t; // < порядковый номер автобусного маршрута в каталоге
+
 struct Stop {
+	StopId id; // < порядковый номер остановки в каталоге
 	std::string name; // < название остановки
 	geo::Coordinates coords; // < координаты остановки
-};
-
-struct Bus {
-	std::string name; // < название автобусного маршрута
-	std::vector<const Stop*> stops; // < набор остановок на маршруте
-	bool is_roundtrip; // < флаг типа маршрута (true - кольцевой, false - некольцевой)
+	bool is_declared; // < флаг описанной остановки (false - остановка пока только упоминается в расстояниях или маршрутах)
 };
 
 struct BusInfo {
@@ -26,11 +27,12 @@ struct BusInfo {
 	double curvature; // < кривизна маршрута (отношение реальной длины к географической)
 };
 
-// Компаратор для сортировки указателей на Bus по имени маршрута
-struct BusPointerComparator {
-	bool operator()(const Bus* lhs, const Bus* rhs) const {
-		return lhs->name < rhs->name;
-	}
+struct Bus {
+	BusId id; // < порядковый номер маршрута в каталоге
+	std::string name; // < название автобусного маршрута
+	std::vector<StopId> stops; // < номера остановок на маршруте
+	bool is_roundtrip; // < флаг типа маршрута (true - кольцевой, false - некольцевой)
+	std::optional<BusInfo> info; // < предрасчитанная статистика маршрута (пусто, если требуется пересчет)
 };
 
 // Компаратор для сортировки указателей на Stop по имени остановки
@@ -40,6 +42,6 @@ struct StopPointerComparator {
 	}
 };
 
-using StopInfo = std::set<const Bus*, BusPointerComparator>;
+using StopInfo = std::span<const BusId>; // < номера автобусных маршрутов, проходящих через остановку, в порядке возрастания имени маршрута
 
 } // namespace domain
\ No newline at end of file
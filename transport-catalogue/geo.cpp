@@ -1,16 +1,306 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace geo {
 
+namespace {
+
+constexpr double kEarthRadius = 6371000; // < радиус Земли в метрах
+constexpr double kDegree = M_PI / 180.0; // < градус в радианах
+
+/*
+ * Пакеты значений для векторных ядер. Каждый набор инструкций определяет в своем пространстве имен
+ * тип Pack (kSize значений double) с загрузкой и арифметикой и тип Mask с результатом сравнения,
+ * а ядра ниже находят нужные функции по типу аргумента
+ */
+namespace scalar {
+
+struct Pack {
+    static constexpr size_t kSize = 1;
+    Pack(double value) : v(value) {}
+    static Pack Load(const double* data) { return *data; }
+    double v;
+};
+
+struct Mask {
+    bool v;
+};
+
+inline void Store(double* data, Pack value) { *data = value.v; }
+inline Pack operator+(Pack lhs, Pack rhs) { return {lhs.v + rhs.v}; }
+inline Pack operator-(Pack lhs, Pack rhs) { return {lhs.v - rhs.v}; }
+inline Pack operator*(Pack lhs, Pack rhs) { return {lhs.v * rhs.v}; }
+inline Pack operator/(Pack lhs, Pack rhs) { return {lhs.v / rhs.v}; }
+inline Mask operator<(Pack lhs, Pack rhs) { return {lhs.v < rhs.v}; }
+inline Mask operator<=(Pack lhs, Pack rhs) { return {lhs.v <= rhs.v}; }
+inline Pack Select(Mask mask, Pack lhs, Pack rhs) { return mask.v ? lhs : rhs; }
+inline Pack Min(Pack lhs, Pack rhs) { return {std::min(lhs.v, rhs.v)}; }
+inline Pack Max(Pack lhs, Pack rhs) { return {std::max(lhs.v, rhs.v)}; }
+inline Pack Abs(Pack value) { return {std::abs(value.v)}; }
+inline Pack Sqrt(Pack value) { return {std::sqrt(value.v)}; }
+inline Pack CopySign(Pack magnitude, Pack sign) { return {std::copysign(magnitude.v, sign.v)}; }
+
+} // namespace scalar
+
+#if defined(__AVX2__)
+namespace avx2 {
+
+struct Pack {
+    static constexpr size_t kSize = 4;
+    Pack(double value) : v(_mm256_set1_pd(value)) {}
+    Pack(__m256d value) : v(value) {}
+    static Pack Load(const double* data) { return _mm256_loadu_pd(data); }
+    __m256d v;
+};
+
+struct Mask {
+    __m256d v;
+};
+
+inline void Store(double* data, Pack value) { _mm256_storeu_pd(data, value.v); }
+inline Pack operator+(Pack lhs, Pack rhs) { return _mm256_add_pd(lhs.v, rhs.v); }
+inline Pack operator-(Pack lhs, Pack rhs) { return _mm256_sub_pd(lhs.v, rhs.v); }
+inline Pack operator*(Pack lhs, Pack rhs) { return _mm256_mul_pd(lhs.v, rhs.v); }
+inline Pack operator/(Pack lhs, Pack rhs) { return _mm256_div_pd(lhs.v, rhs.v); }
+inline Mask operator<(Pack lhs, Pack rhs) { return {_mm256_cmp_pd(lhs.v, rhs.v, _CMP_LT_OQ)}; }
+inline Mask operator<=(Pack lhs, Pack rhs) { return {_mm256_cmp_pd(lhs.v, rhs.v, _CMP_LE_OQ)}; }
+inline Pack Select(Mask mask, Pack lhs, Pack rhs) { return _mm256_blendv_pd(rhs.v, lhs.v, mask.v); }
+inline Pack Min(Pack lhs, Pack rhs) { return _mm256_min_pd(lhs.v, rhs.v); }
+inline Pack Max(Pack lhs, Pack rhs) { return _mm256_max_pd(lhs.v, rhs.v); }
+inline Pack Abs(Pack value) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), value.v); }
+inline Pack Sqrt(Pack value) { return _mm256_sqrt_pd(value.v); }
+inline Pack CopySign(Pack magnitude, Pack sign) {
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    return _mm256_or_pd(_mm256_andnot_pd(sign_bit, magnitude.v), _mm256_and_pd(sign_bit, sign.v));
+}
+
+} // namespace avx2
+
+namespace simd = avx2;
+constexpr std::string_view kInstructionSet = "avx2";
+
+#elif defined(__SSE2__) || defined(_M_X64)
+namespace sse2 {
+
+struct Pack {
+    static constexpr size_t kSize = 2;
+    Pack(double value) : v(_mm_set1_pd(value)) {}
+    Pack(__m128d value) : v(value) {}
+    static Pack Load(const double* data) { return _mm_loadu_pd(data); }
+    __m128d v;
+};
+
+struct Mask {
+    __m128d v;
+};
+
+inline void Store(double* data, Pack value) { _mm_storeu_pd(data, value.v); }
+inline Pack operator+(Pack lhs, Pack rhs) { return _mm_add_pd(lhs.v, rhs.v); }
+inline Pack operator-(Pack lhs, Pack rhs) { return _mm_sub_pd(lhs.v, rhs.v); }
+inline Pack operator*(Pack lhs, Pack rhs) { return _mm_mul_pd(lhs.v, rhs.v); }
+inline Pack operator/(Pack lhs, Pack rhs) { return _mm_div_pd(lhs.v, rhs.v); }
+inline Mask operator<(Pack lhs, Pack rhs) { return {_mm_cmplt_pd(lhs.v, rhs.v)}; }
+inline Mask operator<=(Pack lhs, Pack rhs) { return {_mm_cmple_pd(lhs.v, rhs.v)}; }
+inline Pack Select(Mask mask, Pack lhs, Pack rhs) { return _mm_or_pd(_mm_and_pd(mask.v, lhs.v), _mm_andnot_pd(mask.v, rhs.v)); }
+inline Pack Min(Pack lhs, Pack rhs) { return _mm_min_pd(lhs.v, rhs.v); }
+inline Pack Max(Pack lhs, Pack rhs) { return _mm_max_pd(lhs.v, rhs.v); }
+inline Pack Abs(Pack value) { return _mm_andnot_pd(_mm_set1_pd(-0.0), value.v); }
+inline Pack Sqrt(Pack value) { return _mm_sqrt_pd(value.v); }
+inline Pack CopySign(Pack magnitude, Pack sign) {
+    const __m128d sign_bit = _mm_set1_pd(-0.0);
+    return _mm_or_pd(_mm_andnot_pd(sign_bit, magnitude.v), _mm_and_pd(sign_bit, sign.v));
+}
+
+} // namespace sse2
+
+namespace simd = sse2;
+constexpr std::string_view kInstructionSet = "sse2";
+
+#else
+namespace simd = scalar;
+constexpr std::string_view kInstructionSet = "scalar";
+#endif
+
+// Многочлен с коэффициентами от старшего к младшему по схеме Горнера
+template <typename Pack, size_t N>
+Pack Polynomial(Pack x, const double (&coefficients)[N]) {
+    Pack result = coefficients[0];
+    for (size_t i = 1; i < N; ++i) {
+        result = result * x + coefficients[i];
+    }
+    return result;
+}
+
+// Синус на отрезке [-pi/2, pi/2]: минимаксные многочлены синуса до pi/4 и косинуса дополнительного угла дальше (Cephes)
+template <typename Pack>
+Pack SinHalfPi(Pack x) {
+    static constexpr double kSin[] = {1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6,
+                                      -1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1};
+    static constexpr double kCos[] = {-1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7,
+                                      2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2};
+    const Pack a = Abs(x);
+    const Pack a2 = a * a;
+    const Pack sin = a + a * a2 * Polynomial(a2, kSin);
+    const Pack b = Pack(M_PI_2) - a;
+    const Pack b2 = b * b;
+    const Pack cos = Pack(1.0) - Pack(0.5) * b2 + b2 * b2 * Polynomial(b2, kCos);
+    return CopySign(Select(a <= Pack(M_PI_4), sin, cos), x);
+}
+
+// Арксинус на отрезке [-1/2, 1/2]: рациональное приближение (Cephes)
+template <typename Pack>
+Pack AsinHalf(Pack x) {
+    static constexpr double kNumerator[] = {4.253011369004428248960E-3, -6.019598008014123785661E-1, 5.444622390564711410273E0,
+                                            -1.626247967210700244449E1, 1.956261983317594739197E1, -8.198089802484824371615E0};
+    static constexpr double kDenominator[] = {1.0, -1.474091372988853791896E1, 7.049610280856842141659E1,
+                                              -1.471791292232726029859E2, 1.395105614657485689735E2, -4.918853881490881290097E1};
+    const Pack x2 = x * x;
+    return x + x * x2 * Polynomial(x2, kNumerator) / Polynomial(x2, kDenominator);
+}
+
+// Арккосинус на отрезке [-1, 1]: вне [-1/2, 1/2] сводится к арксинусу половинного угла
+template <typename Pack>
+Pack Acos(Pack x) {
+    const Pack a = Abs(x);
+    const auto small = a <= Pack(0.5);
+    const Pack asin = AsinHalf(Select(small, x, Sqrt((Pack(1.0) - a) * Pack(0.5))));
+    const Pack large = Select(x < Pack(0.0), Pack(M_PI) - Pack(2.0) * asin, Pack(2.0) * asin);
+    return Select(small, Pack(M_PI_2) - asin, large);
+}
+
+// Арксинус на отрезке [0, 1]
+template <typename Pack>
+Pack AsinUnit(Pack x) {
+    const auto small = x <= Pack(0.5);
+    const Pack asin = AsinHalf(Select(small, x, Sqrt((Pack(1.0) - x) * Pack(0.5))));
+    return Select(small, asin, Pack(M_PI_2) - Pack(2.0) * asin);
+}
+
+// Разность долгот в градусах, приведенная к отрезку [0, 180]
+template <typename Pack>
+Pack LongitudeDelta(Pack from, Pack to) {
+    const Pack delta = Abs(from - to);
+    return Min(delta, Pack(360.0) - delta);
+}
+
+// Считает расстояния до точек набора с номера begin пакетами по Pack::kSize, возвращает номер первой необработанной точки
+template <typename Pack>
+size_t ComputeDistancesRange(Coordinates from, const CoordinatesBatch& to, size_t begin, double* distances) {
+    const PreparedCoordinates prepared = Prepare(from);
+    const Pack from_lng = prepared.lng;
+    const Pack from_sin_lat = prepared.sin_lat;
+    const Pack from_cos_lat = prepared.cos_lat;
+    size_t i = begin;
+    for (; i + Pack::kSize <= to.Size(); i += Pack::kSize) {
+        const Pack lng_delta = LongitudeDelta(from_lng, Pack::Load(&to.lng[i])) * Pack(kDegree);
+        const Pack cos_lng_delta = SinHalfPi(Pack(M_PI_2) - lng_delta);
+        const Pack cos_angle = from_sin_lat * Pack::Load(&to.sin_lat[i]) + from_cos_lat * Pack::Load(&to.cos_lat[i]) * cos_lng_delta;
+        Store(&distances[i], Acos(Max(Pack(-1.0), Min(Pack(1.0), cos_angle))) * Pack(kEarthRadius));
+    }
+    return i;
+}
+
+// Считает расстояния по формуле гаверсинусов пакетами по Pack::kSize, возвращает номер первой необработанной точки
+template <typename Pack>
+size_t ComputeHaversineDistancesRange(Coordinates from, const CoordinatesBatch& to, size_t begin, double* distances) {
+    const Pack from_lat = from.lat;
+    const Pack from_lng = from.lng;
+    const Pack from_cos_lat = std::cos(from.lat * kDegree);
+    size_t i = begin;
+    for (; i + Pack::kSize <= to.Size(); i += Pack::kSize) {
+        const Pack sin_lat_delta = SinHalfPi((Pack::Load(&to.lat[i]) - from_lat) * Pack(kDegree / 2));
+        const Pack sin_lng_delta = SinHalfPi(LongitudeDelta(from_lng, Pack::Load(&to.lng[i])) * Pack(kDegree / 2));
+        const Pack haversine = sin_lat_delta * sin_lat_delta + from_cos_lat * Pack::Load(&to.cos_lat[i]) * sin_lng_delta * sin_lng_delta;
+        Store(&distances[i], AsinUnit(Sqrt(Min(Pack(1.0), haversine))) * Pack(2 * kEarthRadius));
+    }
+    return i;
+}
+
+} // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
+    return ComputeDistance(Prepare(from), Prepare(to));
+}
+
+// Предрасчитывает тригонометрию широты точки
+PreparedCoordinates Prepare(Coordinates coords) {
+    return {coords.lng, std::sin(coords.lat * kDegree), std::cos(coords.lat * kDegree)};
+}
+
+/* Расстояние между подготовленными точками: один косинус разности долгот и один арккосинус.
+   Порядок операций повторяет исходную формулу, поэтому результат не зависит от того, подготовлены ли точки заранее */
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to) {
+    using namespace std;
+    return acos(from.sin_lat * to.sin_lat
+                + from.cos_lat * to.cos_lat * cos(abs(from.lng - to.lng) * kDegree))
+        * kEarthRadius;
+}
+
+// Расстояние по формуле гаверсинусов: в отличие от ComputeDistance не теряет точность на малых расстояниях
+double ComputeHaversineDistance(Coordinates from, Coordinates to) {
     using namespace std;
-    const double dr = M_PI / 180.0;
-    return acos(sin(from.lat * dr) * sin(to.lat * dr)
-                + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
-        * 6371000;
+    const double sin_lat_delta = sin((to.lat - from.lat) * kDegree / 2);
+    const double sin_lng_delta = sin((to.lng - from.lng) * kDegree / 2);
+    const double haversine = sin_lat_delta * sin_lat_delta + cos(from.lat * kDegree) * cos(to.lat * kDegree) * sin_lng_delta * sin_lng_delta;
+    return 2 * kEarthRadius * asin(min(1.0, sqrt(haversine)));
+}
+
+// Добавляет точку в конец набора
+void CoordinatesBatch::Add(Coordinates coords) {
+    const PreparedCoordinates prepared = Prepare(coords);
+    lat.push_back(coords.lat);
+    lng.push_back(coords.lng);
+    sin_lat.push_back(prepared.sin_lat);
+    cos_lat.push_back(prepared.cos_lat);
+}
+
+// Заменяет координаты точки с номером index
+void CoordinatesBatch::Set(size_t index, Coordinates coords) {
+    const PreparedCoordinates prepared = Prepare(coords);
+    lat[index] = coords.lat;
+    lng[index] = coords.lng;
+    sin_lat[index] = prepared.sin_lat;
+    cos_lat[index] = prepared.cos_lat;
+}
+
+// Возвращает подготовленную точку с номером index
+PreparedCoordinates CoordinatesBatch::Get(size_t index) const {
+    return {lng[index], sin_lat[index], cos_lat[index]};
+}
+
+// Возвращает количество точек в наборе
+size_t CoordinatesBatch::Size() const {
+    return lat.size();
+}
+
+/* Записывает в distances расстояния от точки from до каждой точки набора to по той же формуле, что ComputeDistance.
+   Хвост набора, не заполняющий векторный пакет, считается теми же многочленами скалярно */
+void ComputeDistances(Coordinates from, const CoordinatesBatch& to, std::span<double> distances) {
+    assert(distances.size() >= to.Size());
+    const size_t tail = ComputeDistancesRange<simd::Pack>(from, to, 0, distances.data());
+    ComputeDistancesRange<scalar::Pack>(from, to, tail, distances.data());
+}
+
+// То же, что ComputeDistances, но по формуле гаверсинусов, устойчивой для малых расстояний
+void ComputeHaversineDistances(Coordinates from, const CoordinatesBatch& to, std::span<double> distances) {
+    assert(distances.size() >= to.Size());
+    const size_t tail = ComputeHaversineDistancesRange<simd::Pack>(from, to, 0, distances.data());
+    ComputeHaversineDistancesRange<scalar::Pack>(from, to, tail, distances.data());
+}
+
+// Возвращает название набора инструкций, которым выполняются пакетные расчеты ("avx2", "sse2" или "scalar")
+std::string_view GetBatchInstructionSet() {
+    return kInstructionSet;
 }
 
-}  // namespace geo
\ No newline at end of file
+}  // namespace geo
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
 namespace geo {
 
 struct Coordinates {
@@ -9,4 +14,55 @@ struct Coordinates {
 
 double ComputeDistance(Coordinates from, Coordinates to);
 
-}  // namespace geo
\ No newline at end of file
+// Точка с предрасчитанными синусом и косинусом широты для многократного расчета расстояний
+struct PreparedCoordinates {
+    double lng; // < долгота в градусах
+    double sin_lat; // < синус широты
+    double cos_lat; // < косинус широты
+};
+
+// Предрасчитывает тригонометрию широты точки
+PreparedCoordinates Prepare(Coordinates coords);
+
+/* Расстояние между подготовленными точками: один косинус разности долгот и один арккосинус.
+   Результат совпадает с ComputeDistance для исходных координат до последнего бита */
+double ComputeDistance(const PreparedCoordinates& from, const PreparedCoordinates& to);
+
+// Расстояние по формуле гаверсинусов: в отличие от ComputeDistance не теряет точность на малых расстояниях
+double ComputeHaversineDistance(Coordinates from, Coordinates to);
+
+/*
+ * Координаты набора точек в виде структуры массивов с предрасчитанными синусом и косинусом широты.
+ * Используется для пакетного расчета расстояний от одной точки до многих
+ */
+struct CoordinatesBatch {
+    std::vector<double> lat; // < широты точек в градусах
+    std::vector<double> lng; // < долготы точек в градусах
+    std::vector<double> sin_lat; // < синусы широт
+    std::vector<double> cos_lat; // < косинусы широт
+
+    // Добавляет точку в конец набора
+    void Add(Coordinates coords);
+
+    // Заменяет координаты точки с номером index
+    void Set(size_t index, Coordinates coords);
+
+    // Возвращает подготовленную точку с номером index
+    PreparedCoordinates Get(size_t index) const;
+
+    // Возвращает количество точек в наборе
+    size_t Size() const;
+};
+
+/* Записывает в distances расстояния от точки from до каждой точки набора to по той же формуле, что ComputeDistance.
+   Синусы, косинусы и арккосинусы считаются векторными многочленами (AVX2, SSE2 или скалярно - по набору инструкций сборки),
+   поэтому результат может отличаться от ComputeDistance в последних знаках. Размер distances должен быть не меньше to.Size() */
+void ComputeDistances(Coordinates from, const CoordinatesBatch& to, std::span<double> distances);
+
+// То же, что ComputeDistances, но по формуле гаверсинусов, устойчивой для малых расстояний
+void ComputeHaversineDistances(Coordinates from, const CoordinatesBatch& to, std::span<double> distances);
+
+// Возвращает название набора инструкций, которым выполняются пакетные расчеты ("avx2", "sse2" или "scalar")
+std::string_view GetBatchInstructionSet();
+
+}  // namespace geo
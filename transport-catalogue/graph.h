@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+using VertexId = uint32_t;
+using EdgeId = uint32_t;
+
+template <typename Weight>
+struct Edge {
+    VertexId from; // < начальная вершина ребра
+    VertexId to; // < конечная вершина ребра
+    Weight weight; // < вес ребра
+};
+
+// Исходящее ребро в списке смежности вершины
+template <typename Weight>
+struct Arc {
+    VertexId to; // < конечная вершина ребра
+    EdgeId edge_id; // < номер ребра в графе
+    Weight weight; // < вес ребра
+};
+
+/*
+ * Ориентированный взвешенный граф.
+ * Ребра хранятся в одном векторе, а списки исходящих ребер вершин - в формате CSR (смещения + общий массив),
+ * который строится один раз методом Build после добавления всех ребер.
+ * Конечная вершина и вес копируются в список смежности, чтобы поиск читал память последовательно
+ */
+template <typename Weight>
+class DirectedWeightedGraph {
+public:
+    DirectedWeightedGraph() = default;
+    explicit DirectedWeightedGraph(size_t vertex_count)
+        : vertex_count_(vertex_count) {
+    }
+
+    // Добавляет ребро и возвращает его номер (списки исходящих ребер нужно перестроить методом Build)
+    EdgeId AddEdge(const Edge<Weight>& edge) {
+        edges_.push_back(edge);
+        return static_cast<EdgeId>(edges_.size() - 1);
+    }
+
+    // Строит списки исходящих ребер для всех вершин
+    void Build() {
+        incidence_offsets_.assign(vertex_count_ + 1, 0);
+        for (const Edge<Weight>& edge : edges_) {
+            if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+                throw std::out_of_range("Edge refers to a vertex outside of the graph");
+            }
+            ++incidence_offsets_[edge.from + 1];
+        }
+        for (size_t i = 1; i < incidence_offsets_.size(); ++i) {
+            incidence_offsets_[i] += incidence_offsets_[i - 1];
+        }
+
+        incidence_arcs_.resize(edges_.size());
+        std::vector<uint32_t> positions(incidence_offsets_.begin(), incidence_offsets_.end() - 1);
+        for (EdgeId id = 0; id < edges_.size(); ++id) {
+            const Edge<Weight>& edge = edges_[id];
+            incidence_arcs_[positions[edge.from]++] = {edge.to, id, edge.weight};
+        }
+    }
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    size_t GetEdgeCount() const {
+        return edges_.size();
+    }
+
+    const Edge<Weight>& GetEdge(EdgeId edge_id) const {
+        return edges_[edge_id];
+    }
+
+    // Возвращает ребра, исходящие из вершины
+    std::span<const Arc<Weight>> GetIncidentArcs(VertexId vertex) const {
+        return {incidence_arcs_.data() + incidence_offsets_[vertex], incidence_offsets_[vertex + 1] - incidence_offsets_[vertex]};
+    }
+
+private:
+    size_t vertex_count_ = 0; // < количество вершин
+    std::vector<Edge<Weight>> edges_; // < ребра графа
+    std::vector<uint32_t> incidence_offsets_; // < начало списка исходящих ребер каждой вершины (размер - число вершин + 1)
+    std::vector<Arc<Weight>> incidence_arcs_; // < исходящие ребра всех вершин подряд
+};
+
+} // namespace graph
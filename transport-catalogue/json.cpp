@@ -1,5 +1,7 @@
 #include "json.h"
 
+#include <charconv>
+#include <iterator>
 #include <unordered_map>
 
 using namespace std;
@@ -8,131 +10,225 @@ namespace json {
 
 namespace {
 
-// Загружает узел JSON-дерева из входного потока.
-Node LoadNode(istream& input);
-
-// Загружает массив JSON из входного потока
-Node LoadArray(std::istream& input) {
-    Array result;
-    char c;
-    if (!(input >> c)) throw ParsingError("Error in parsing array");
-    
-    while (c != ']') {
-        if (c != ',' && !std::isspace(c)) {
-            input.putback(c);
-            result.push_back(LoadNode(input));
+/*
+ * Потоковый разборщик JSON, работающий поверх непрерывного буфера с входными данными.
+ * О каждом встреченном элементе сообщает обработчику событий. Строки без escape-последовательностей
+ * передаются как string_view на буфер, числа разбираются через std::from_chars без промежуточных строк
+ */
+class Parser {
+public:
+    Parser(string_view input, Handler& handler)
+        : input_(input)
+        , handler_(handler) {
+    }
+
+    // Разбирает значение JSON, определяя его тип по первому символу
+    void ParseValue() {
+        switch (GetNonSpace("Unexpected end of input"sv)) {
+            case '[': ParseArray(); break;
+            case '{': ParseDict(); break;
+            case '"': handler_.String(ParseString()); break;
+            case 'n': ParseLiteral("null"sv); handler_.Null(); break;
+            case 't': ParseLiteral("true"sv); handler_.Bool(true); break;
+            case 'f': ParseLiteral("false"sv); handler_.Bool(false); break;
+            default:
+                --pos_;
+                ParseNumber();
         }
-        if (!(input >> c)) throw ParsingError("Error in parsing array");
     }
-    return Node(std::move(result));
-}
-
-// Загружает число (int или double) из входного потока
-Node LoadNumber(std::istream& input) {
-    using namespace std::literals;
-    std::string parsed_num;
-    
-    auto read_char = [&]() {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) throw ParsingError("Failed to read number from stream");
-    };
-    
-    auto read_digits = [&]() {
-        if (!std::isdigit(input.peek())) throw ParsingError("A digit is expected");
-        while (std::isdigit(input.peek())) read_char();
-    };
-    
-    if (input.peek() == '-') read_char();
-    (input.peek() == '0') ? read_char() : read_digits();
-    
-    bool is_int = true;
-    if (input.peek() == '.') { read_char(); read_digits(); is_int = false; }
-    
-    if (std::tolower(input.peek()) == 'e') {
-        read_char();
-        if (input.peek() == '+' || input.peek() == '-') read_char();
-        read_digits();
-        is_int = false;
+
+private:
+    // Пропускает пробельные символы и возвращает следующий символ
+    char GetNonSpace(string_view error_message) {
+        while (pos_ < input_.size() && IsSpace(input_[pos_])) {
+            ++pos_;
+        }
+        if (pos_ == input_.size()) {
+            throw ParsingError(string(error_message));
+        }
+        return input_[pos_++];
     }
-    
-    try {
-        return is_int ? Node(std::stoi(parsed_num)) : Node(std::stod(parsed_num));
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to number");
+
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
     }
-}
 
-// Загружает строку из входного потока
-std::string LoadString(std::istream& input) {
-    using namespace std::literals;
-    std::string s;
-    for (char ch; input.get(ch);) {
-        if (ch == '"') return s;
-        if (ch == '\\') {
-            if (!input.get(ch)) throw ParsingError("String parsing error");
-            switch (ch) {
-                case 'n': s += '\n'; break;
-                case 't': s += '\t'; break;
-                case 'r': s += '\r'; break;
-                case '"': case '\\': s += ch; break;
-                default: throw ParsingError("Unrecognized escape sequence \\"s + ch);
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // Разбирает массив JSON
+    void ParseArray() {
+        handler_.StartArray();
+        char c = GetNonSpace("Error in parsing array"sv);
+        while (c != ']') {
+            if (c != ',') {
+                --pos_;
+                ParseValue();
             }
-        } else if (ch == '\n' || ch == '\r') {
-            throw ParsingError("Unexpected end of line in string");
-        } else {
-            s += ch;
+            c = GetNonSpace("Error in parsing array"sv);
         }
+        handler_.EndArray();
     }
-    throw ParsingError("String parsing error");
-}
-
-// Загружает словарь из входного потока
-Node LoadDict(std::istream& input) {
-    Dict result;
-    char c;
-    if (!(input >> c)) throw ParsingError("Error in parsing object");
-    
-    while (c != '}') {
-        if (c != ',' && !std::isspace(c)) {
-            if (c != '"') throw ParsingError("Expected string key in object");
-            std::string key = LoadString(input);
-            if (!(input >> c) || c != ':') throw ParsingError("Expected ':' after key");
-            result.emplace(std::move(key), LoadNode(input));
+
+    // Разбирает словарь JSON
+    void ParseDict() {
+        handler_.StartDict();
+        char c = GetNonSpace("Error in parsing object"sv);
+        while (c != '}') {
+            if (c != ',') {
+                if (c != '"') throw ParsingError("Expected string key in object");
+                handler_.Key(ParseString());
+                if (GetNonSpace("Expected ':' after key"sv) != ':') throw ParsingError("Expected ':' after key");
+                ParseValue();
+            }
+            c = GetNonSpace("Error in parsing object"sv);
         }
-        if (!(input >> c)) throw ParsingError("Error in parsing object");
+        handler_.EndDict();
+    }
+
+    /*
+     * Разбирает строку (открывающая кавычка уже прочитана).
+     * Если в строке нет escape-последовательностей, возвращает string_view на входной буфер,
+     * иначе - на внутренний буфер разборщика, действительный до следующего вызова
+     */
+    string_view ParseString() {
+        const size_t begin = pos_;
+        while (pos_ < input_.size()) {
+            const char c = input_[pos_];
+            if (c == '"') {
+                return input_.substr(begin, pos_++ - begin);
+            }
+            if (c == '\\') {
+                break;
+            }
+            if (c == '\n' || c == '\r') {
+                throw ParsingError("Unexpected end of line in string");
+            }
+            ++pos_;
+        }
+
+        // Встретилась escape-последовательность, дальше собираем строку с заменами
+        buffer_.assign(input_.substr(begin, pos_ - begin));
+        while (pos_ < input_.size()) {
+            const char c = input_[pos_++];
+            if (c == '"') {
+                return buffer_;
+            }
+            if (c == '\\') {
+                if (pos_ == input_.size()) throw ParsingError("String parsing error");
+                const char escaped = input_[pos_++];
+                switch (escaped) {
+                    case 'n': buffer_ += '\n'; break;
+                    case 't': buffer_ += '\t'; break;
+                    case 'r': buffer_ += '\r'; break;
+                    case '"': case '\\': buffer_ += escaped; break;
+                    default: throw ParsingError("Unrecognized escape sequence \\"s + escaped);
+                }
+            } else if (c == '\n' || c == '\r') {
+                throw ParsingError("Unexpected end of line in string");
+            } else {
+                buffer_ += c;
+            }
+        }
+        throw ParsingError("String parsing error");
+    }
+
+    // Разбирает число (int или double)
+    void ParseNumber() {
+        const size_t begin = pos_;
+
+        auto read_digits = [&]() {
+            if (pos_ == input_.size() || !IsDigit(input_[pos_])) throw ParsingError("A digit is expected");
+            while (pos_ < input_.size() && IsDigit(input_[pos_])) ++pos_;
+        };
+        auto peek = [&]() {
+            return pos_ < input_.size() ? input_[pos_] : '\0';
+        };
+
+        if (peek() == '-') ++pos_;
+        (peek() == '0') ? static_cast<void>(++pos_) : read_digits();
+
+        bool is_int = true;
+        if (peek() == '.') { ++pos_; read_digits(); is_int = false; }
+
+        if (peek() == 'e' || peek() == 'E') {
+            ++pos_;
+            if (peek() == '+' || peek() == '-') ++pos_;
+            read_digits();
+            is_int = false;
+        }
+
+        const char* first = input_.data() + begin;
+        const char* last = input_.data() + pos_;
+        if (is_int) {
+            int value;
+            if (auto [ptr, ec] = from_chars(first, last, value); ec == errc{} && ptr == last) {
+                handler_.Int(value);
+                return;
+            }
+        } else {
+            double value;
+            if (auto [ptr, ec] = from_chars(first, last, value); ec == errc{} && ptr == last) {
+                handler_.Double(value);
+                return;
+            }
+        }
+        throw ParsingError("Failed to convert "s + string(first, last) + " to number");
     }
-    return Node(std::move(result));
-}
 
-// Загружает литералы null, false, true
-Node LoadLiteral(std::istream& input, const std::string& expected, Node Val) {
-    for (size_t i = 1; i < expected.size(); ++i) {
-        if (input.get() != expected[i]) throw ParsingError("Error in parsing '" + expected + "'");
+    // Разбирает литералы null, false, true (первый символ уже прочитан)
+    void ParseLiteral(string_view expected) {
+        if (input_.substr(pos_ - 1, expected.size()) != expected) {
+            throw ParsingError("Error in parsing '"s + string(expected) + "'");
+        }
+        pos_ += expected.size() - 1;
+        if (pos_ < input_.size() && isalnum(static_cast<unsigned char>(input_[pos_]))) {
+            throw ParsingError("Unexpected characters after '"s + string(expected) + "'");
+        }
     }
-    if (std::isalnum(input.peek())) throw ParsingError("Unexpected characters after '" + expected + "'");
-    return Val;
-}
-
-// Определяет тип загружаемого узла и вызывают соответствующий обработчик
-Node LoadNode(std::istream& input) {
-    char c;
-    input >> c;
-    
-    switch (c) {
-        case '[': return LoadArray(input);
-        case '{': return LoadDict(input);
-        case '"': return Node(LoadString(input));
-        case 'n': return LoadLiteral(input, "null", Node());
-        case 't': return LoadLiteral(input, "true", Node(true));
-        case 'f': return LoadLiteral(input, "false", Node(false));
-        default:
-            input.putback(c);
-            return LoadNumber(input);
+
+    string_view input_; // < входной буфер
+    size_t pos_ = 0; // < текущая позиция разбора
+    Handler& handler_; // < обработчик событий разбора
+    string buffer_; // < буфер для строк с escape-последовательностями
+};
+
+// Считывает поток целиком в непрерывный буфер
+string ReadAll(istream& input) {
+    string buffer;
+    char chunk[1 << 16];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        buffer.append(chunk, static_cast<size_t>(input.gcount()));
     }
+    return buffer;
 }
 
 }  // namespace
 
+// Выводит строку в кавычках, экранируя специальные символы
+void PrintString(string_view value, ostream& out) {
+    out.put('"');
+    // Участки без специальных символов выводятся целиком
+    size_t run_begin = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        string_view escaped;
+        switch (value[i]) {
+            case '\n': escaped = "\\n"sv; break;
+            case '\r': escaped = "\\r"sv; break;
+            case '\t': escaped = "\\t"sv; break;
+            case '\\': escaped = "\\\\"sv; break;
+            case '"': escaped = "\\\""sv; break;
+            default: continue;
+        }
+        out.write(value.data() + run_begin, i - run_begin);
+        out << escaped;
+        run_begin = i + 1;
+    }
+    out.write(value.data() + run_begin, value.size() - run_begin);
+    out.put('"');
+}
+
 void NodePrinter::operator() ([[maybe_unused]] const nullptr_t Val) {
     out << "null"sv;
 }
@@ -140,24 +236,7 @@ void NodePrinter::operator() ([[maybe_unused]] const nullptr_t Val) {
 // Реализация посетителя для вывода содержимого JSON-узла в поток
 
 void NodePrinter::operator() (const string& Val) {
-    static const std::unordered_map<char, std::string_view> chars_map = {
-        {'\n', "\\n"},
-        {'\r', "\\r"},
-        {'\t', "\\t"},
-        {'\\', "\\\\"},
-        {'\"', "\\\""}
-    };
-
-    out << "\""sv;
-    for (char c : Val) {
-        auto it = chars_map.find(c);
-        if (it != chars_map.end()) {
-            out << it->second;
-        } else {
-            out << c;
-        }
-    }
-    out << "\""sv;
+    PrintString(Val, out);
 }
 
 void NodePrinter::operator() (const bool Val) {
@@ -337,11 +416,195 @@ bool Document::operator==(const Document& other) const {
 
 // Конец реализации класса, представляющего JSON-документ
 
+// Реализация обработчика событий, собирающего JSON-дерево
+
+void TreeBuilder::StartDict() {
+    stack_.push_back(AddValue(Dict{}));
+}
+
+void TreeBuilder::Key(string_view key) {
+    key_ = key;
+}
+
+void TreeBuilder::EndDict() {
+    stack_.pop_back();
+}
+
+void TreeBuilder::StartArray() {
+    stack_.push_back(AddValue(Array{}));
+}
+
+void TreeBuilder::EndArray() {
+    stack_.pop_back();
+}
+
+void TreeBuilder::Null() {
+    AddValue(Node());
+}
+
+void TreeBuilder::Int(int value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::Double(double value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::String(string_view value) {
+    AddValue(Node(string(value)));
+}
+
+void TreeBuilder::Bool(bool value) {
+    AddValue(Node(value));
+}
+
+bool TreeBuilder::IsComplete() const {
+    return root_.has_value() && stack_.empty();
+}
+
+Node TreeBuilder::Extract() {
+    if (!IsComplete()) {
+        throw logic_error("Tree is not complete");
+    }
+    Node root = move(*root_);
+    root_.reset();
+    discarded_.clear();
+    return root;
+}
+
+// Размещает значение в корне или в текущем контейнере и возвращает указатель на него
+Node* TreeBuilder::AddValue(Node value) {
+    if (stack_.empty()) {
+        root_ = move(value);
+        return &*root_;
+    }
+    Node& container = *stack_.back();
+    if (container.IsArray()) {
+        return &container.AsArray().emplace_back(move(value));
+    }
+    // Из повторяющихся ключей остается первый: значение следующих достраивается в стороне и отбрасывается
+    auto [it, inserted] = container.AsMap().try_emplace(key_, move(value));
+    if (!inserted) {
+        return &discarded_.emplace_back(move(value));
+    }
+    return &it->second;
+}
+
+// Конец реализации обработчика событий, собирающего JSON-дерево
+
+// Потоково разбирает JSON из непрерывного буфера, сообщая обработчику о встреченных элементах
+void Parse(string_view input, Handler& handler) {
+    Parser(input, handler).ParseValue();
+}
+
+// Потоково разбирает JSON из входного потока, сообщая обработчику о встреченных элементах
+void Parse(istream& input, Handler& handler) {
+    Parse(string_view(ReadAll(input)), handler);
+}
+
 // Загружает JSON-документ из входного потока
 Document Load(istream& input) {
-    return Document{LoadNode(input)};
+    return Load(string_view(ReadAll(input)));
+}
+
+// Загружает JSON-документ из непрерывного буфера
+Document Load(string_view input) {
+    TreeBuilder builder;
+    Parse(input, builder);
+    return Document{builder.Extract()};
+}
+
+// Реализация потокового вывода JSON
+
+Writer::Writer(ostream& out)
+    : out_(out) {
+}
+
+Writer& Writer::StartDict() {
+    BeforeValue();
+    out_ << "{"sv;
+    has_items_.push_back(false);
+    return *this;
+}
+
+Writer& Writer::Key(string_view key) {
+    BeforeValue();
+    PrintString(key, out_);
+    out_ << ": "sv;
+    after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    has_items_.pop_back();
+    out_ << "}"sv;
+    return *this;
+}
+
+Writer& Writer::StartArray() {
+    BeforeValue();
+    out_ << "["sv;
+    has_items_.push_back(false);
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    has_items_.pop_back();
+    out_ << "]"sv;
+    return *this;
+}
+
+Writer& Writer::Value(nullptr_t) {
+    BeforeValue();
+    out_ << "null"sv;
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeforeValue();
+    out_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeforeValue();
+    out_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeforeValue();
+    out_ << (value ? "true"sv : "false"sv);
+    return *this;
 }
 
+Writer& Writer::Value(string_view value) {
+    BeforeValue();
+    PrintString(value, out_);
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(string_view(value));
+}
+
+// Выводит разделитель перед очередным элементом контейнера
+void Writer::BeforeValue() {
+    if (after_key_) {
+        // Значение после ключа идет сразу за двоеточием
+        after_key_ = false;
+        return;
+    }
+    if (!has_items_.empty()) {
+        if (has_items_.back()) {
+            out_ << ", "sv;
+        }
+        has_items_.back() = true;
+    }
+}
+
+// Конец реализации потокового вывода JSON
+
 // Вывод JSON- документа в поток вывода
 void Print(const Document& doc, std::ostream& output) {
     visit(NodePrinter{output}, doc.GetRoot().GetValue());
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <deque>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -19,6 +22,9 @@ public:
     using runtime_error::runtime_error;
 };
 
+// Выводит строку в кавычках, экранируя специальные символы
+void PrintString(std::string_view value, std::ostream& out);
+
 // Посетитель для вывода содержимого JSON-узла в поток
 struct NodePrinter {
     std::ostream& out;
@@ -99,9 +105,98 @@ private:
     Node root_;
 };
 
+/*
+ * Интерфейс обработчика событий потокового (SAX) разбора JSON.
+ * Строки, переданные в Key и String, действительны только во время вызова
+ */
+class Handler {
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void Null() = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+    virtual void Bool(bool value) = 0;
+
+protected:
+    ~Handler() = default;
+};
+
+// Обработчик событий разбора, собирающий из них JSON-дерево
+class TreeBuilder final : public Handler {
+public:
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void Null() override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+    void Bool(bool value) override;
+
+    // Проверяет, что корневой узел собран полностью
+    bool IsComplete() const;
+
+    // Возвращает собранный корневой узел и подготавливает построитель к сборке следующего
+    Node Extract();
+
+private:
+    Node* AddValue(Node value);
+
+    std::optional<Node> root_; // < собираемый корневой узел
+    std::vector<Node*> stack_; // < стек незакрытых массивов и словарей
+    std::string key_; // < последний прочитанный ключ словаря
+    std::deque<Node> discarded_; // < значения повторяющихся ключей (адреса не меняются, пока значение достраивается)
+};
+
+// Потоково разбирает JSON из непрерывного буфера, сообщая обработчику о встреченных элементах
+void Parse(std::string_view input, Handler& handler);
+
+// Потоково разбирает JSON из входного потока, сообщая обработчику о встреченных элементах
+void Parse(std::istream& input, Handler& handler);
+
 // Загружает JSON-документ из входного потока
 Document Load(std::istream& input);
 
+// Загружает JSON-документ из непрерывного буфера (например, целиком прочитанного или отображенного в память файла)
+Document Load(std::string_view input);
+
+/*
+ * Потоковый вывод JSON: элементы записываются в поток сразу, без построения узлов.
+ * Формат совпадает с json::Print. Ключи словаря выводятся в порядке вызова Key,
+ * поэтому для совпадения с выводом Dict их нужно передавать в лексикографическом порядке
+ */
+class Writer {
+public:
+    explicit Writer(std::ostream& out);
+
+    Writer& StartDict();
+    Writer& Key(std::string_view key);
+    Writer& EndDict();
+    Writer& StartArray();
+    Writer& EndArray();
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(bool value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const char* value);
+
+private:
+    void BeforeValue();
+
+    std::ostream& out_;
+    std::vector<bool> has_items_; // < флаги непустоты открытых массивов и словарей
+    bool after_key_ = false; // < флаг ожидания значения после ключа
+};
+
 // Вывод JSON- документа в поток вывода
 void Print(const Document& doc, std::ostream& output);
 
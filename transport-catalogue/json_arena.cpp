@@ -0,0 +1,319 @@
+#include "json_arena.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory_resource>
+#include <stdexcept>
+
+using namespace std;
+
+namespace json {
+
+namespace arena {
+
+/*
+ * Монотонная арена документа. Первый блок встроен в арену, поэтому документ из короткой строки
+ * (например, один запрос статистики) занимает одно выделение памяти; следующие блоки растут геометрически
+ */
+struct Arena {
+    static constexpr size_t kInitialSize = 2048; // < размер встроенного первого блока
+
+    alignas(max_align_t) array<byte, kInitialSize> initial_block; // < встроенный первый блок
+    pmr::monotonic_buffer_resource resource{initial_block.data(), initial_block.size()}; // < распределитель блоков
+
+    // Выделяет память под count объектов типа T (объекты не разрушаются)
+    template <typename T>
+    T* Allocate(size_t count) {
+        return static_cast<T*>(resource.allocate(count * sizeof(T), alignof(T)));
+    }
+};
+
+// Реализация методов доступа к массивам и словарям
+
+const Node& Array::at(size_t index) const {
+    if (index >= size_) {
+        throw out_of_range("Array index is out of range");
+    }
+    return data_[index];
+}
+
+Dict::const_iterator Dict::find(string_view key) const {
+    const value_type* it = lower_bound(begin(), end(), key, [](const value_type& item, string_view key) {
+        return item.first < key;
+    });
+    return it != end() && it->first == key ? it : end();
+}
+
+const Node& Dict::at(string_view key) const {
+    const const_iterator it = find(key);
+    if (it == end()) {
+        throw out_of_range("Dict has no key "s + string(key));
+    }
+    return it->second;
+}
+
+// Конец реализации методов доступа к массивам и словарям
+
+// Реализация класса, представляющего JSON-узел в арене
+
+const Val& Node::GetValue() const {
+    return *this;
+}
+
+bool Node::IsInt() const {
+    return holds_alternative<int>(*this);
+}
+
+bool Node::IsDouble() const {
+    return holds_alternative<double>(*this) || holds_alternative<int>(*this);
+}
+
+bool Node::IsPureDouble() const {
+    return holds_alternative<double>(*this);
+}
+
+bool Node::IsBool() const {
+    return holds_alternative<bool>(*this);
+}
+
+bool Node::IsString() const {
+    return holds_alternative<arena::String>(*this);
+}
+
+bool Node::IsNull() const {
+    return holds_alternative<nullptr_t>(*this);
+}
+
+bool Node::IsArray() const {
+    return holds_alternative<Array>(*this);
+}
+
+bool Node::IsMap() const {
+    return holds_alternative<Dict>(*this);
+}
+
+int Node::AsInt() const {
+    if (IsInt()) {
+        return get<int>(*this);
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+bool Node::AsBool() const {
+    if (IsBool()) {
+        return get<bool>(*this);
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+double Node::AsDouble() const {
+    if (IsDouble()) {
+        if (IsPureDouble()) {
+            return get<double>(*this);
+        } else {
+            return get<int>(*this);
+        }
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+const arena::String& Node::AsString() const {
+    if (IsString()) {
+        return get<arena::String>(*this);
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+const Array& Node::AsArray() const {
+    if (IsArray()) {
+        return get<Array>(*this);
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+const Dict& Node::AsMap() const {
+    if (IsMap()) {
+        return get<Dict>(*this);
+    } else {
+        throw logic_error("The type is not suitable");
+    }
+}
+
+// Конец реализации класса, представляющего JSON-узел в арене
+
+// Реализация класса, представляющего JSON-документ в арене
+
+Document::Document(unique_ptr<Arena> arena, Node root)
+    : arena_(move(arena))
+    , root_(root) {
+}
+
+Document::Document(Document&&) noexcept = default;
+Document& Document::operator=(Document&&) noexcept = default;
+Document::~Document() = default;
+
+const Node& Document::GetRoot() const {
+    return root_;
+}
+
+// Конец реализации класса, представляющего JSON-документ в арене
+
+// Реализация обработчика событий, собирающего JSON-дерево в арене
+
+TreeBuilder::TreeBuilder() = default;
+
+TreeBuilder::~TreeBuilder() = default;
+
+void TreeBuilder::StartDict() {
+    StartContainer(true);
+}
+
+void TreeBuilder::Key(string_view key) {
+    key_ = CopyString(key);
+}
+
+void TreeBuilder::EndDict() {
+    const size_t begin = stack_.back().begin;
+    const size_t size = values_.size() - begin;
+    Dict::value_type* items = GetArena().Allocate<Dict::value_type>(size);
+    for (size_t i = 0; i < size; ++i) {
+        new (items + i) Dict::value_type(keys_[begin + i], values_[begin + i]);
+    }
+
+    // Словари обычно малы, и устойчивая сортировка вставками не выделяет памяти
+    auto by_key = [](const Dict::value_type& lhs, const Dict::value_type& rhs) {
+        return lhs.first < rhs.first;
+    };
+    if (size <= 32) {
+        for (size_t i = 1; i < size; ++i) {
+            for (size_t j = i; j > 0 && by_key(items[j], items[j - 1]); --j) {
+                swap(items[j], items[j - 1]);
+            }
+        }
+    } else {
+        stable_sort(items, items + size, by_key);
+    }
+
+    // Сортировка устойчива, поэтому из равных ключей остается первый, как при разборе в обычное дерево
+    size_t unique_size = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (unique_size > 0 && items[unique_size - 1].first == items[i].first) {
+            continue;
+        }
+        items[unique_size++] = items[i];
+    }
+
+    values_.resize(begin);
+    keys_.resize(begin);
+    key_ = stack_.back().key;
+    stack_.pop_back();
+    AddValue(Dict(items, unique_size));
+}
+
+void TreeBuilder::StartArray() {
+    StartContainer(false);
+}
+
+void TreeBuilder::EndArray() {
+    const size_t begin = stack_.back().begin;
+    const size_t size = values_.size() - begin;
+    Node* items = GetArena().Allocate<Node>(size);
+    uninitialized_copy(values_.begin() + static_cast<ptrdiff_t>(begin), values_.end(), items);
+
+    values_.resize(begin);
+    keys_.resize(begin);
+    key_ = stack_.back().key;
+    stack_.pop_back();
+    AddValue(Array(items, size));
+}
+
+void TreeBuilder::Null() {
+    AddValue(Node());
+}
+
+void TreeBuilder::Int(int value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::Double(double value) {
+    AddValue(Node(value));
+}
+
+void TreeBuilder::String(string_view value) {
+    AddValue(Node(CopyString(value)));
+}
+
+void TreeBuilder::Bool(bool value) {
+    AddValue(Node(value));
+}
+
+bool TreeBuilder::IsComplete() const {
+    return root_.has_value() && stack_.empty();
+}
+
+Document TreeBuilder::Extract() {
+    if (!IsComplete()) {
+        throw logic_error("Tree is not complete");
+    }
+    Document document(move(arena_), *root_);
+    root_.reset();
+    return document;
+}
+
+// Запоминает начало элементов контейнера и ключ, под которым он будет добавлен после закрытия
+void TreeBuilder::StartContainer(bool is_dict) {
+    stack_.push_back({values_.size(), is_dict, key_});
+}
+
+// Размещает значение в корне или в стеке элементов текущего контейнера
+void TreeBuilder::AddValue(Node value) {
+    if (stack_.empty()) {
+        root_ = value;
+        return;
+    }
+    values_.push_back(value);
+    keys_.push_back(stack_.back().is_dict ? key_ : arena::String());
+}
+
+// Возвращает арену собираемого документа, создавая ее при первом обращении
+Arena& TreeBuilder::GetArena() {
+    if (!arena_) {
+        arena_ = make_unique<Arena>();
+    }
+    return *arena_;
+}
+
+arena::String TreeBuilder::CopyString(string_view value) {
+    if (value.empty()) {
+        return {};
+    }
+    char* data = GetArena().Allocate<char>(value.size());
+    memcpy(data, value.data(), value.size());
+    return string_view(data, value.size());
+}
+
+// Конец реализации обработчика событий, собирающего JSON-дерево в арене
+
+// Загружает JSON-документ в арену из входного потока
+Document Load(istream& input) {
+    TreeBuilder builder;
+    Parse(input, builder);
+    return builder.Extract();
+}
+
+// Загружает JSON-документ в арену из непрерывного буфера
+Document Load(string_view input) {
+    TreeBuilder builder;
+    Parse(input, builder);
+    return builder.Extract();
+}
+
+} // namespace arena
+
+} // namespace json
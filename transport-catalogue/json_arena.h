@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "json.h"
+
+namespace json {
+
+/*
+ * JSON-дерево, размещенное в монотонной арене документа.
+ * Строки - срезы арены, массивы - непрерывные блоки узлов, словари - отсортированные по ключам
+ * блоки пар ключ-значение. Узлы не владеют памятью и не имеют деструкторов: документ освобождает
+ * всю арену разом. Методы доступа (AsMap, AsArray, AsString, at, find, count) повторяют json::Node,
+ * поэтому код разбора запросов работает с обоими представлениями без изменений
+ */
+namespace arena {
+
+class Node;
+
+// Строка в арене документа (приводится к std::string для полей, которые хранят копию)
+class String : public std::string_view {
+public:
+    String() = default;
+    String(std::string_view value)
+        : std::string_view(value) {
+    }
+
+    operator std::string() const {
+        return std::string(*this);
+    }
+};
+
+// Массив узлов, размещенный в арене единым блоком
+class Array {
+public:
+    using value_type = Node;
+    using const_iterator = const Node*;
+    using iterator = const_iterator;
+
+    Array() = default;
+    Array(const Node* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    const Node* begin() const;
+    const Node* end() const;
+    size_t size() const;
+    bool empty() const;
+    const Node& operator[](size_t index) const;
+
+    // Возвращает элемент по индексу, выбрасывает std::out_of_range за пределами массива
+    const Node& at(size_t index) const;
+
+private:
+    const Node* data_ = nullptr; // < первый элемент в арене
+    size_t size_ = 0; // < число элементов
+};
+
+// Словарь: пары ключ-значение в арене, упорядоченные по ключам (поиск - двоичный)
+class Dict {
+public:
+    using value_type = std::pair<String, Node>;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+    Dict() = default;
+    Dict(const value_type* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    const value_type* begin() const;
+    const value_type* end() const;
+    size_t size() const;
+    bool empty() const;
+
+    // Возвращает пару с ключом key или end(), если ключа нет
+    const_iterator find(std::string_view key) const;
+
+    // Возвращает число пар с ключом key (0 или 1)
+    size_t count(std::string_view key) const;
+
+    // Возвращает значение по ключу, выбрасывает std::out_of_range, если ключа нет
+    const Node& at(std::string_view key) const;
+
+private:
+    const value_type* data_ = nullptr; // < первая пара в арене
+    size_t size_ = 0; // < число пар
+};
+
+using Val = std::variant<std::nullptr_t, int, double, String, bool, Array, Dict>;
+
+// Узел JSON-дерева в арене
+class Node : public Val {
+public:
+    Node() : Val(nullptr) {}
+    Node(int value) : Val(value) {}
+    Node(double value) : Val(value) {}
+    Node(String value) : Val(value) {}
+    Node(bool value) : Val(value) {}
+    Node(Array value) : Val(value) {}
+    Node(Dict value) : Val(value) {}
+
+    // Возвращает ссылку на хранимое значение
+    const Val& GetValue() const;
+
+    // Проверка типа узла
+    bool IsInt() const;
+    bool IsDouble() const;
+    bool IsPureDouble() const;
+    bool IsBool() const;
+    bool IsString() const;
+    bool IsNull() const;
+    bool IsArray() const;
+    bool IsMap() const;
+
+    // Преобразование узла к конкретному типу
+    int AsInt() const;
+    bool AsBool() const;
+    double AsDouble() const;
+    const String& AsString() const;
+    const Array& AsArray() const;
+    const Dict& AsMap() const;
+};
+
+static_assert(std::is_trivially_destructible_v<Node>, "arena nodes are released together with the arena");
+
+struct Arena;
+
+// JSON-документ, владеющий ареной со всеми своими узлами и строками
+class Document {
+public:
+    Document(std::unique_ptr<Arena> arena, Node root);
+    Document(Document&&) noexcept;
+    Document& operator=(Document&&) noexcept;
+    ~Document();
+
+    // Возвращает корневой узел (действителен, пока жив документ)
+    const Node& GetRoot() const;
+
+private:
+    std::unique_ptr<Arena> arena_; // < арена с узлами, строками, массивами и словарями документа
+    Node root_;
+};
+
+/*
+ * Обработчик событий разбора, собирающий дерево в арене.
+ * Элементы незакрытых массивов и словарей копятся во временных стеках построителя и переносятся
+ * в арену одним блоком при закрытии, поэтому в арене не остается недостроенных контейнеров.
+ * Построитель можно использовать повторно: временные стеки сохраняют выделенную память
+ */
+class TreeBuilder final : public Handler {
+public:
+    TreeBuilder();
+    ~TreeBuilder();
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+    void StartArray() override;
+    void EndArray() override;
+    void Null() override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+    void Bool(bool value) override;
+
+    // Проверяет, что корневой узел собран полностью
+    bool IsComplete() const;
+
+    // Возвращает собранный документ вместе с его ареной и подготавливает построитель к сборке следующего
+    Document Extract();
+
+private:
+    // Незакрытый массив или словарь
+    struct Frame {
+        size_t begin; // < начало элементов контейнера в стеке значений
+        bool is_dict; // < флаг словаря
+        arena::String key; // < ключ, под которым контейнер лежит в родительском словаре
+    };
+
+    // Открывает массив или словарь
+    void StartContainer(bool is_dict);
+
+    // Добавляет значение в корень или в текущий контейнер
+    void AddValue(Node value);
+
+    // Возвращает арену собираемого документа, создавая ее при первом обращении
+    Arena& GetArena();
+
+    // Копирует строку в арену
+    arena::String CopyString(std::string_view value);
+
+    std::unique_ptr<Arena> arena_; // < арена собираемого документа (создается при первом выделении)
+    std::optional<Node> root_; // < собранный корневой узел
+    std::vector<Frame> stack_; // < стек незакрытых массивов и словарей
+    std::vector<Node> values_; // < элементы незакрытых контейнеров
+    std::vector<arena::String> keys_; // < ключи элементов (для элементов массивов - пустые)
+    arena::String key_; // < последний прочитанный ключ словаря
+};
+
+// Загружает JSON-документ в арену из входного потока
+Document Load(std::istream& input);
+
+// Загружает JSON-документ в арену из непрерывного буфера (например, одной строки ввода)
+Document Load(std::string_view input);
+
+// Реализация методов доступа к массивам и словарям (нужен полный тип узла)
+
+inline const Node* Array::begin() const {
+    return data_;
+}
+
+inline const Node* Array::end() const {
+    return data_ + size_;
+}
+
+inline size_t Array::size() const {
+    return size_;
+}
+
+inline bool Array::empty() const {
+    return size_ == 0;
+}
+
+inline const Node& Array::operator[](size_t index) const {
+    return data_[index];
+}
+
+inline const Dict::value_type* Dict::begin() const {
+    return data_;
+}
+
+inline const Dict::value_type* Dict::end() const {
+    return data_ + size_;
+}
+
+inline size_t Dict::size() const {
+    return size_;
+}
+
+inline bool Dict::empty() const {
+    return size_ == 0;
+}
+
+inline size_t Dict::count(std::string_view key) const {
+    return find(key) != end() ? 1 : 0;
+}
+
+} // namespace arena
+
+} // namespace json
@@ -1,74 +1,60 @@
 #include "json_reader.h"
 
+#include <algorithm>
+#include <limits>
+
 using namespace std;
 
 namespace json_reader {
 
-// Пасрит json запрос на добавление остановки
-request_handler::StopRequest ParseStopRequest(const json::Dict& request) {
-    request_handler::StopRequest stop_request;
-
-    stop_request.name = request.at("name"s).AsString();
-    stop_request.coords = {request.at("latitude"s).AsDouble(), request.at("longitude").AsDouble()};
-    for (const auto& [stop, distance] : request.at("road_distances"s).AsMap()) {
-        stop_request.distances[stop] = distance.AsInt();
-    }
-
-    return stop_request;
-}
-
-// Парсит json запрос на добаление маршрута
-request_handler::BusRequest ParseBusRequest(const json::Dict& request) {
-    request_handler::BusRequest bus_request;
-
-    bus_request.name = request.at("name"s).AsString();
-    bus_request.is_roundtrip = request.at("is_roundtrip"s).AsBool();
-    for (const json::Node& stop : request.at("stops"s).AsArray()) {
-        bus_request.stops.push_back(stop.AsString());
-    }
-
-    return bus_request;
-}
-
-// Парсит базовые запросы на добаление маршрутов и оствновок в каталог
-void ParseBaseRequests(const json::Array& base_requests, request_handler::RequestHandler& rh) {
-    for (const json::Node& base_request : base_requests) {
-        const json::Dict& request = base_request.AsMap();
-        const string& request_type = request.at("type"s).AsString();
-        if (request_type == "Stop"sv) {
-            rh.AddStopRequest(ParseStopRequest(request));
-        } else if (request_type == "Bus"sv) {
-            rh.AddBusRequest(ParseBusRequest(request));
-        }
-    }
-}
-
 // Парсит запрос на получение статистики
-request_handler::StatRequest ParseStatRequest(const json::Dict& request) {
+request_handler::StatRequest ParseStatRequest(const json::arena::Dict& request) {
     request_handler::StatRequest stat_request;
 
     stat_request.id = request.at("id"s).AsInt();
     stat_request.type = request.at("type"s).AsString();
-    stat_request.name = stat_request.type == "Map"s ? ""s : request.at("name"s).AsString();
+    if (stat_request.type == "Route"s) {
+        stat_request.from = request.at("from"s).AsString();
+        stat_request.to = request.at("to"s).AsString();
+    } else if (stat_request.type == "NearbyStops"s) {
+        stat_request.coords = {request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+        stat_request.radius = request.at("radius"s).AsDouble();
+        stat_request.count = request.count("count"s) ? static_cast<size_t>(max(request.at("count"s).AsInt(), 0)) : numeric_limits<size_t>::max();
+    } else if (stat_request.type == "StopsInBox"s) {
+        stat_request.min_coords = {request.at("min_latitude"s).AsDouble(), request.at("min_longitude"s).AsDouble()};
+        stat_request.max_coords = {request.at("max_latitude"s).AsDouble(), request.at("max_longitude"s).AsDouble()};
+    } else if (stat_request.type == "MapTile"s) {
+        // Тайл задается номером на уровне масштаба либо прямоугольником, как в StopsInBox
+        if (request.count("zoom"s)) {
+            stat_request.zoom = request.at("zoom"s).AsInt();
+            stat_request.tile_x = request.at("x"s).AsInt();
+            stat_request.tile_y = request.at("y"s).AsInt();
+        } else {
+            stat_request.min_coords = {request.at("min_latitude"s).AsDouble(), request.at("min_longitude"s).AsDouble()};
+            stat_request.max_coords = {request.at("max_latitude"s).AsDouble(), request.at("max_longitude"s).AsDouble()};
+        }
+    } else if (stat_request.type != "Map"s) {
+        stat_request.name = request.at("name"s).AsString();
+    }
 
     return stat_request;
 }
 
 // Парсит запросы на получение статистики из каталога
-void ParseStatRequests(const json::Array& stat_requests, request_handler::RequestHandler& rh) {
-    for (const json::Node& stat_request : stat_requests) {
-        const json::Dict& request = stat_request.AsMap();
+void ParseStatRequests(const json::arena::Array& stat_requests, request_handler::RequestHandler& rh) {
+    for (const json::arena::Node& stat_request : stat_requests) {
+        const json::arena::Dict& request = stat_request.AsMap();
         rh.AddStatRequest(ParseStatRequest(request));
     }
 }
 
 // Парсит ноду с цветом
-svg::Color ParseColor(const json::Node& json_color) {
+svg::Color ParseColor(const json::arena::Node& json_color) {
     if (json_color.IsString()) {
         return {json_color.AsString()};
     }
 
-    const json::Array& array_color = json_color.AsArray();
+    const json::arena::Array& array_color = json_color.AsArray();
 
     int red = array_color[0].AsInt();
     int green = array_color[1].AsInt();
@@ -82,7 +68,7 @@ svg::Color ParseColor(const json::Node& json_color) {
 }
 
 // Парсит настройки рендера карты
-void ParsRenderSettings(const json::Dict& render_settings, map_renderer::MapRenderer& mr) {
+void ParsRenderSettings(const json::arena::Dict& render_settings, map_renderer::MapRenderer& mr) {
     map_renderer::RenderSettings settings;
 
     settings.width = render_settings.at("width"s).AsDouble();
@@ -94,87 +80,482 @@ void ParsRenderSettings(const json::Dict& render_settings, map_renderer::MapRend
     settings.stop_radius = render_settings.at("stop_radius"s).AsDouble();
 
     settings.bus_label_font_size = render_settings.at("bus_label_font_size"s).AsInt();
-    const json::Array& bus_label_offset = render_settings.at("bus_label_offset"s).AsArray();
+    const json::arena::Array& bus_label_offset = render_settings.at("bus_label_offset"s).AsArray();
     settings.bus_label_offset = {bus_label_offset[0].AsDouble(), bus_label_offset[1].AsDouble()};
 
     settings.stop_label_font_size = render_settings.at("stop_label_font_size"s).AsInt();
-    const json::Array& stop_label_offset = render_settings.at("stop_label_offset"s).AsArray();
+    const json::arena::Array& stop_label_offset = render_settings.at("stop_label_offset"s).AsArray();
     settings.stop_label_offset = {stop_label_offset[0].AsDouble(), stop_label_offset[1].AsDouble()};
 
     settings.underlayer_color = ParseColor(render_settings.at("underlayer_color"s));
     settings.underlayer_width = render_settings.at("underlayer_width"s).AsDouble();
 
-    for (const json::Node& color : render_settings.at("color_palette"s).AsArray()) {
+    for (const json::arena::Node& color : render_settings.at("color_palette"s).AsArray()) {
         settings.color_palette.push_back(ParseColor(color));
     }
 
+    if (const auto it = render_settings.find("simplify_lines"s); it != render_settings.end()) {
+        settings.simplify_lines = it->second.AsBool();
+    }
+
     mr.SetRenderSettings(settings);
 }
 
-// Парсит все запросы
-void ParseRequest(istream& input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr) {
-    json::Document doc = json::Load(input);
+// Парсит настройки маршрутизации
+void ParseRoutingSettings(const json::arena::Dict& routing_settings, request_handler::RequestHandler& rh) {
+    transport_router::RoutingSettings settings;
+
+    settings.bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
+    settings.bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
 
-    const json::Dict& requests = doc.GetRoot().AsMap();
-    const json::Array& base_requests = requests.at("base_requests"s).AsArray();
-    const json::Dict& render_settings = requests.at("render_settings"s).AsMap();
-    const json::Array& stat_requests = requests.at("stat_requests"s).AsArray();
+    // route_table: true - таблица из всех остановок, массив имен - из выбранных остановок
+    if (const auto it = routing_settings.find("route_table"s); it != routing_settings.end()) {
+        if (it->second.IsArray()) {
+            settings.use_route_table = true;
+            for (const json::arena::Node& stop : it->second.AsArray()) {
+                settings.route_table_stops.push_back(stop.AsString());
+            }
+        } else {
+            settings.use_route_table = it->second.AsBool();
+        }
+    }
+    if (const auto it = routing_settings.find("contraction_hierarchy"s); it != routing_settings.end()) {
+        settings.use_contraction_hierarchy = it->second.AsBool();
+    }
 
-    ParseBaseRequests(base_requests, rh);    
-    ParsRenderSettings(render_settings, mr);
-    ParseStatRequests(stat_requests, rh);
+    rh.SetRoutingSettings(settings);
 }
 
-// Выводит в поток собранную статистику в формате json
-void PrintStat(std::ostream& output, const std::deque<request_handler::StatResponse>& stats) {
-    json::Array json_stats;
+namespace {
+
+/*
+ * Обработчик событий потокового разбора входного JSON.
+ * Запросы из base_requests применяются к каталогу сразу по мере чтения, без построения JSON-дерева.
+ * Остальные разделы (render_settings, routing_settings, stat_requests) собираются для разбора в дерево в арене,
+ * которая освобождается целиком после разбора раздела
+ */
+class RequestStreamHandler final : public json::Handler {
+public:
+    RequestStreamHandler(request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr,
+                         serialization::SerializationSettings* serialization_settings)
+        : rh_(rh)
+        , mr_(mr)
+        , serialization_settings_(serialization_settings) {
+    }
 
-    for (const request_handler::StatResponse& stat : stats) {
-        json::Dict json_stat;
-
-        if (std::holds_alternative<domain::BusInfo>(stat.info)) {
-            domain::BusInfo bus_info =  get<domain::BusInfo>(stat.info);
-            json_stat = json::Builder{}
-                                .StartDict()
-                                    .Key("request_id").Value(stat.id)
-                                    .Key("curvature").Value(bus_info.curvature)
-                                    .Key("route_length").Value(bus_info.route_length)
-                                    .Key("stop_count").Value(bus_info.num_of_stops)
-                                    .Key("unique_stop_count").Value(bus_info.num_of_unique_stops)
-                                .EndDict()
-                                .Build().AsMap();
-        } else if (std::holds_alternative<domain::StopInfo>(stat.info)) {
-            const domain::StopInfo& stop_info = get<domain::StopInfo>(stat.info);
-            json::Array buses_on_stop;
-            for (const domain::Bus* bus : stop_info) {
-                buses_on_stop.push_back(json::Node(bus->name));
+    void StartDict() override {
+        if (SkipContainerStart()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.StartDict();
+            return;
+        }
+        CheckNotDistance();
+        ++depth_;
+        if (depth_ == kRequestDepth) {
+            StartBaseRequest();
+        }
+    }
+
+    void Key(string_view key) override {
+        if (skipped_depth_ > 0) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.Key(key);
+            return;
+        }
+        // Из повторяющихся ключей словаря учитывается первый, как при разборе в дерево
+        if (depth_ == kRootDepth) {
+            if (!IsFirstKey(root_keys_, key)) {
+                return;
             }
-            json_stat = json::Builder{}
-                                .StartDict()
-                                    .Key("request_id").Value(stat.id)
-                                    .Key("buses").Value(buses_on_stop)
-                                .EndDict()
-                                .Build().AsMap();
-        } else if (std::holds_alternative<string>(stat.info)) {
-            json_stat = json::Builder{}
-                                .StartDict()
-                                    .Key("request_id").Value(stat.id)
-                                    .Key("map").Value(get<string>(stat.info))
-                                .EndDict()
-                                .Build().AsMap();
+            in_base_requests_ = key == "base_requests"sv;
+            section_ = key;
+            is_section_open_ = !in_base_requests_;
+        } else if (depth_ == kRequestDepth) {
+            if (!IsFirstKey(request_keys_, key)) {
+                return;
+            }
+            field_ = key;
+        } else if (depth_ == kRequestFieldDepth && field_ == "road_distances"sv) {
+            distance_to_ = key;
+        }
+    }
+
+    void EndDict() override {
+        if (SkipContainerEnd()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.EndDict();
+            FinishSection();
+            return;
+        }
+        if (depth_ == kRequestDepth) {
+            FinishBaseRequest();
+        }
+        --depth_;
+    }
+
+    void StartArray() override {
+        if (SkipContainerStart()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.StartArray();
+            return;
+        }
+        CheckNotDistance();
+        ++depth_;
+    }
+
+    void EndArray() override {
+        if (SkipContainerEnd()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.EndArray();
+            FinishSection();
+            return;
+        }
+        --depth_;
+        if (depth_ == kRootDepth) {
+            in_base_requests_ = false;
+        }
+    }
+
+    void Null() override {
+        if (SkipScalar()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.Null();
+            FinishSection();
+            return;
+        }
+        CheckNotDistance();
+    }
+
+    void Int(int value) override {
+        if (SkipScalar()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.Int(value);
+            FinishSection();
+            return;
+        }
+        if (depth_ == kRequestFieldDepth && field_ == "road_distances"sv) {
+            stop_request_.distances.try_emplace(distance_to_, value);
         } else {
-            json_stat = json::Builder{}
-                                .StartDict()
-                                    .Key("request_id").Value(stat.id)
-                                    .Key("error_message").Value("not found")
-                                .EndDict()
-                                .Build().AsMap();
+            SetCoordinate(value);
         }
+    }
 
-        json_stats.push_back(json::Node(json_stat));
+    void Double(double value) override {
+        if (SkipScalar()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.Double(value);
+            FinishSection();
+            return;
+        }
+        CheckNotDistance();
+        SetCoordinate(value);
     }
 
-    json::Print(json::Document{json::Builder{}.Value(json_stats).Build()}, output);
+    void String(string_view value) override {
+        if (SkipScalar()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.String(value);
+            FinishSection();
+            return;
+        }
+        CheckNotDistance();
+        if (depth_ == kRequestDepth) {
+            if (field_ == "type"sv) {
+                type_ = value;
+            } else if (field_ == "name"sv) {
+                stop_request_.name = value;
+                bus_request_.name = value;
+            }
+        } else if (depth_ == kRequestFieldDepth && field_ == "stops"sv) {
+            bus_request_.stops.emplace_back(value);
+        }
+    }
+
+    void Bool(bool value) override {
+        if (SkipScalar()) {
+            return;
+        }
+        if (ForwardToSection()) {
+            section_builder_.Bool(value);
+            FinishSection();
+            return;
+        }
+        CheckNotDistance();
+        if (depth_ == kRequestDepth && field_ == "is_roundtrip"sv) {
+            bus_request_.is_roundtrip = value;
+        }
+    }
+
+private:
+    // Глубина вложенности: корневой словарь, массив base_requests, словарь запроса, значение поля запроса
+    static constexpr int kRootDepth = 1;
+    static constexpr int kRequestDepth = 3;
+    static constexpr int kRequestFieldDepth = 4;
+
+    // Проверяет, что текущее событие относится к разделу, собираемому в JSON-дерево
+    bool ForwardToSection() const {
+        return is_section_open_;
+    }
+
+    /* Запоминает ключ словаря и возвращает false, если он уже встречался.
+       Значение повторяющегося ключа пропускается целиком */
+    bool IsFirstKey(vector<string>& keys, string_view key) {
+        if (find(keys.begin(), keys.end(), key) != keys.end()) {
+            is_skipping_value_ = true;
+            return false;
+        }
+        keys.emplace_back(key);
+        return true;
+    }
+
+    // Пропускает начало контейнера внутри пропускаемого значения, возвращает true, если событие пропущено
+    bool SkipContainerStart() {
+        if (!is_skipping_value_ && skipped_depth_ == 0) {
+            return false;
+        }
+        is_skipping_value_ = false;
+        ++skipped_depth_;
+        return true;
+    }
+
+    // Пропускает конец контейнера внутри пропускаемого значения, возвращает true, если событие пропущено
+    bool SkipContainerEnd() {
+        if (skipped_depth_ == 0) {
+            return false;
+        }
+        --skipped_depth_;
+        return true;
+    }
+
+    // Пропускает простое значение внутри пропускаемого значения, возвращает true, если событие пропущено
+    bool SkipScalar() {
+        if (!is_skipping_value_ && skipped_depth_ == 0) {
+            return false;
+        }
+        is_skipping_value_ = false;
+        return true;
+    }
+
+    // Выбрасывает исключение, если текущее значение - расстояние до остановки, но не целое число
+    void CheckNotDistance() const {
+        if (depth_ == kRequestFieldDepth && field_ == "road_distances"sv) {
+            throw json::ParsingError("Road distance to stop "s + distance_to_ + " is not an integer"s);
+        }
+    }
+
+    // Разбирает полностью собранный раздел входного JSON
+    void FinishSection() {
+        if (!section_builder_.IsComplete()) {
+            return;
+        }
+        is_section_open_ = false;
+
+        const json::arena::Document document = section_builder_.Extract();
+        const json::arena::Node& section = document.GetRoot();
+        if (section_ == "render_settings"sv) {
+            ParsRenderSettings(section.AsMap(), mr_);
+        } else if (section_ == "routing_settings"sv) {
+            ParseRoutingSettings(section.AsMap(), rh_);
+        } else if (section_ == "stat_requests"sv) {
+            ParseStatRequests(section.AsArray(), rh_);
+        } else if (section_ == "serialization_settings"sv && serialization_settings_) {
+            serialization_settings_->file = section.AsMap().at("file"s).AsString();
+        }
+    }
+
+    // Подготавливает поля для разбора очередного запроса из base_requests
+    void StartBaseRequest() {
+        request_keys_.clear();
+        field_.clear();
+        type_.clear();
+        stop_request_.name.clear();
+        stop_request_.coords = {0, 0};
+        stop_request_.distances.clear();
+        bus_request_.name.clear();
+        bus_request_.stops.clear();
+        bus_request_.is_roundtrip = false;
+    }
+
+    // Применяет к каталогу полностью прочитанный запрос из base_requests
+    void FinishBaseRequest() {
+        if (!in_base_requests_) {
+            return;
+        }
+        if (type_ == "Stop"sv) {
+            rh_.ApplyStopRequest(stop_request_);
+        } else if (type_ == "Bus"sv) {
+            rh_.ApplyBusRequest(bus_request_);
+        }
+    }
+
+    // Задает координату остановки из числового поля запроса
+    void SetCoordinate(double value) {
+        if (depth_ != kRequestDepth) {
+            return;
+        }
+        if (field_ == "latitude"sv) {
+            stop_request_.coords.lat = value;
+        } else if (field_ == "longitude"sv) {
+            stop_request_.coords.lng = value;
+        }
+    }
+
+    request_handler::RequestHandler& rh_;
+    map_renderer::MapRenderer& mr_;
+    serialization::SerializationSettings* serialization_settings_;
+
+    int depth_ = 0; // < текущая глубина вложенности вне собираемых разделов
+    bool in_base_requests_ = false; // < флаг нахождения внутри массива base_requests
+    bool is_section_open_ = false; // < флаг сборки раздела в JSON-дерево
+    string section_; // < имя текущего раздела корневого словаря
+    vector<string> root_keys_; // < ключи корневого словаря, встреченные до сих пор
+    bool is_skipping_value_ = false; // < флаг пропуска следующего значения (значения повторяющегося ключа)
+    int skipped_depth_ = 0; // < глубина вложенности внутри пропускаемого значения
+    json::arena::TreeBuilder section_builder_; // < построитель дерева в арене для текущего раздела
+
+    string field_; // < имя текущего поля запроса
+    vector<string> request_keys_; // < поля текущего запроса, встреченные до сих пор
+    string type_; // < тип текущего запроса (Stop, Bus)
+    string distance_to_; // < имя остановки, до которой задается расстояние
+    request_handler::StopRequest stop_request_; // < текущий запрос на добавление остановки
+    request_handler::BusRequest bus_request_; // < текущий запрос на добавление маршрута
+};
+
+} // namespace
+
+// Парсит все запросы, применяя base_requests к каталогу по мере чтения
+void ParseRequest(istream& input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr,
+                  serialization::SerializationSettings* serialization_settings) {
+    RequestStreamHandler handler(rh, mr, serialization_settings);
+    json::Parse(input, handler);
+}
+
+// То же, что ParseRequest для потока, но разбирает уже прочитанный документ (например, одну строку ввода)
+void ParseRequest(string_view input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr,
+                  serialization::SerializationSettings* serialization_settings) {
+    RequestStreamHandler handler(rh, mr, serialization_settings);
+    json::Parse(input, handler);
+}
+
+namespace {
+
+// Выводит ответ на запрос статистики, ключи словаря выводятся в лексикографическом порядке
+void WriteStatResponse(json::Writer& writer, const request_handler::StatResponse& stat) {
+    writer.StartDict();
+
+    if (holds_alternative<domain::BusInfo>(stat.info)) {
+        const domain::BusInfo& bus_info = get<domain::BusInfo>(stat.info);
+        writer.Key("curvature"sv).Value(bus_info.curvature)
+              .Key("request_id"sv).Value(stat.id)
+              .Key("route_length"sv).Value(bus_info.route_length)
+              .Key("stop_count"sv).Value(bus_info.num_of_stops)
+              .Key("unique_stop_count"sv).Value(bus_info.num_of_unique_stops);
+    } else if (holds_alternative<request_handler::StopBuses>(stat.info)) {
+        writer.Key("buses"sv).StartArray();
+        for (const domain::Bus* bus : get<request_handler::StopBuses>(stat.info)) {
+            writer.Value(bus->name);
+        }
+        writer.EndArray()
+              .Key("request_id"sv).Value(stat.id);
+    } else if (holds_alternative<shared_ptr<const string>>(stat.info)) {
+        writer.Key("map"sv).Value(*get<shared_ptr<const string>>(stat.info))
+              .Key("request_id"sv).Value(stat.id);
+    } else if (holds_alternative<transport_router::RouteInfo>(stat.info)) {
+        const transport_router::RouteInfo& route_info = get<transport_router::RouteInfo>(stat.info);
+        writer.Key("items"sv).StartArray();
+        for (const transport_router::RouteItem& item : route_info.items) {
+            writer.StartDict();
+            if (holds_alternative<transport_router::WaitItem>(item)) {
+                const transport_router::WaitItem& wait = get<transport_router::WaitItem>(item);
+                writer.Key("stop_name"sv).Value(wait.stop->name)
+                      .Key("time"sv).Value(wait.time)
+                      .Key("type"sv).Value("Wait"sv);
+            } else {
+                const transport_router::BusItem& ride = get<transport_router::BusItem>(item);
+                writer.Key("bus"sv).Value(ride.bus->name)
+                      .Key("span_count"sv).Value(ride.span_count)
+                      .Key("time"sv).Value(ride.time)
+                      .Key("type"sv).Value("Bus"sv);
+            }
+            writer.EndDict();
+        }
+        writer.EndArray()
+              .Key("request_id"sv).Value(stat.id)
+              .Key("total_time"sv).Value(route_info.total_time);
+    } else if (holds_alternative<spatial_index::NearbyStops>(stat.info)) {
+        writer.Key("request_id"sv).Value(stat.id)
+              .Key("stops"sv).StartArray();
+        for (const spatial_index::StopDistance& item : get<spatial_index::NearbyStops>(stat.info)) {
+            writer.StartDict()
+                  .Key("distance"sv).Value(item.distance)
+                  .Key("name"sv).Value(item.stop->name)
+                  .EndDict();
+        }
+        writer.EndArray();
+    } else if (holds_alternative<spatial_index::StopsInBox>(stat.info)) {
+        writer.Key("request_id"sv).Value(stat.id)
+              .Key("stops"sv).StartArray();
+        for (const domain::Stop* stop : get<spatial_index::StopsInBox>(stat.info)) {
+            writer.Value(stop->name);
+        }
+        writer.EndArray();
+    } else {
+        writer.Key("error_message"sv).Value("not found"sv)
+              .Key("request_id"sv).Value(stat.id);
+    }
+
+    writer.EndDict();
+}
+
+} // namespace
+
+// Начинает вывод массива ответов
+StatPrinter::StatPrinter(ostream& output)
+    : writer_(output) {
+    writer_.StartArray();
+}
+
+// Выводит очередной ответ, ключи словаря выводятся в лексикографическом порядке
+void StatPrinter::Print(const request_handler::StatResponse& stat) {
+    WriteStatResponse(writer_, stat);
+}
+
+// Завершает вывод массива ответов
+void StatPrinter::Finish() {
+    writer_.EndArray();
+}
+
+// Выводит один ответ на запрос статистики в формате json (без перевода строки)
+void PrintStatResponse(ostream& output, const request_handler::StatResponse& stat) {
+    json::Writer writer(output);
+    WriteStatResponse(writer, stat);
+}
+
+// Выводит в поток собранную статистику в формате json
+void PrintStat(std::ostream& output, const std::vector<request_handler::StatResponse>& stats) {
+    StatPrinter printer(output);
+    for (const request_handler::StatResponse& stat : stats) {
+        printer.Print(stat);
+    }
+    printer.Finish();
 }
 
 } // namespace json_reader
\ No newline at end of file
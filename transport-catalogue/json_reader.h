@@ -1,20 +1,53 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
 #include "json.h"
-#include "json_builder.h"
+#include "json_arena.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "serialization.h"
 
 namespace json_reader {
 
-// Парсит входной json с запросами
-void ParseRequest(std::istream& input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr);
+/* Парсит входной json с запросами.
+   Если передан serialization_settings, в него записываются настройки из раздела serialization_settings */
+void ParseRequest(std::istream& input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr,
+                  serialization::SerializationSettings* serialization_settings = nullptr);
+
+// То же, что ParseRequest для потока, но разбирает уже прочитанный документ (например, одну строку ввода)
+void ParseRequest(std::string_view input, request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr,
+                  serialization::SerializationSettings* serialization_settings = nullptr);
+
+// Парсит один запрос на получение статистики
+request_handler::StatRequest ParseStatRequest(const json::arena::Dict& request);
+
+/*
+ * Потоково выводит ответы на запросы статистики в формате json-массива.
+ * Каждый ответ сериализуется сразу в поток, без построения промежуточных JSON-узлов
+ */
+class StatPrinter {
+public:
+    // Начинает вывод массива ответов
+    explicit StatPrinter(std::ostream& output);
+
+    // Выводит очередной ответ
+    void Print(const request_handler::StatResponse& stat);
+
+    // Завершает вывод массива ответов
+    void Finish();
+
+private:
+    json::Writer writer_;
+};
+
+// Выводит один ответ на запрос статистики в формате json (без перевода строки)
+void PrintStatResponse(std::ostream& output, const request_handler::StatResponse& stat);
 
 // Выводит в поток полученную статистику в формате json
-void PrintStat(std::ostream& output, const std::deque<request_handler::StatResponse>& stats);
+void PrintStat(std::ostream& output, const std::vector<request_handler::StatResponse>& stats);
 
 } // namespace json_reader
\ No newline at end of file
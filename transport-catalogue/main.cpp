@@ -1,17 +1,173 @@
+#include <charconv>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "json_reader.h"
 #include "map_renderer.h"
 #include "request_handler.h"
+#include "serialization.h"
+#include "server.h"
 
 using namespace std;
 
-int main() {
+namespace {
+
+constexpr size_t kMaxThreadCount = 1024; // < наибольшее число потоков, которое можно задать в --threads
+
+void PrintUsage(ostream& stream) {
+    stream << "Usage: transport_catalogue [make_base|process_requests] [--threads N] [--online | --serve | --socket PATH]\n"sv;
+}
+
+// Разбирает число потоков из аргумента --threads (пусто, если это не целое число от 0 до kMaxThreadCount)
+optional<size_t> ParseThreadCount(string_view text) {
+    size_t thread_count = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), thread_count);
+    if (error != errc{} || end != text.data() + text.size() || text.empty() || thread_count > kMaxThreadCount) {
+        return nullopt;
+    }
+    return thread_count;
+}
+
+// Выполняет запросы статистики и выводит ответы по мере готовности
+void ProcessStatRequests(request_handler::RequestHandler& rh, const map_renderer::MapRenderer& mr) {
+    json_reader::StatPrinter printer(cout);
+    rh.ApplyStatRequests(mr, [&printer](const request_handler::StatResponse& stat) {
+        printer.Print(stat);
+    });
+    printer.Finish();
+}
+
+/* Обрабатывает следующие документы ввода по одному в строке: изменения из base_requests применяются к каталогу,
+   после чего выводится строка с ответами на stat_requests этого документа */
+void ProcessOnlineRequests(request_handler::RequestHandler& rh, map_renderer::MapRenderer& mr) {
+    string line;
+    while (getline(cin, line)) {
+        if (line.find_first_not_of(" \t\r"sv) == string::npos) {
+            continue;
+        }
+        json_reader::ParseRequest(string_view(line), rh, mr);
+        rh.ApplyBaseRequests();
+        ProcessStatRequests(rh, mr);
+        cout << endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
     request_handler::RequestHandler rh;
     map_renderer::MapRenderer mr;
 
-    json_reader::ParseRequest(cin, rh, mr);
+    /*
+     * Режимы работы:
+     *   без режима       - построить каталог из base_requests и сразу ответить на stat_requests;
+     *   make_base        - построить каталог и сохранить снимок в файл из serialization_settings;
+     *   process_requests - загрузить снимок из файла serialization_settings и ответить на stat_requests.
+     * --threads N задает число потоков для выполнения запросов статистики и отрисовки карты (0 - по числу ядер);
+     * --online - документы читаются по одному в строке: первый обрабатывается как обычно,
+     *            а следующие дополняют или исправляют каталог и получают ответ отдельной строкой;
+     * --serve - первая строка ввода обрабатывается как обычно, а каждая следующая - отдельный запрос статистики,
+     *           ответ на который выводится строкой;
+     * --socket PATH - каталог строится по всему вводу, а запросы статистики по одному в строке
+     *                 принимаются на Unix-сокете PATH
+     */
+    string_view mode;
+    bool is_online = false;
+    bool is_serving = false;
+    optional<string> socket_path;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--threads"sv && i + 1 < argc) {
+            const optional<size_t> thread_count = ParseThreadCount(argv[++i]);
+            if (!thread_count) {
+                PrintUsage(cerr);
+                return 1;
+            }
+            rh.SetThreadCount(*thread_count);
+        } else if (argv[i] == "--online"sv) {
+            is_online = true;
+        } else if (argv[i] == "--serve"sv) {
+            is_serving = true;
+        } else if (argv[i] == "--socket"sv && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (argv[i] == "make_base"sv || argv[i] == "process_requests"sv) {
+            mode = argv[i];
+        } else {
+            PrintUsage(cerr);
+            return 1;
+        }
+    }
+
+    if ((is_online && (is_serving || socket_path)) || (is_serving && socket_path)) {
+        PrintUsage(cerr);
+        return 1;
+    }
+    // Карта отрисовывается тем же пулом потоков, что и запросы статистики
+    mr.SetWorkerPool(&rh.GetWorkerPool());
+
+    serialization::SerializationSettings serialization_settings;
+    if (is_online || is_serving) {
+        string line;
+        getline(cin, line);
+        json_reader::ParseRequest(string_view(line), rh, mr, &serialization_settings);
+    } else {
+        json_reader::ParseRequest(cin, rh, mr, &serialization_settings);
+    }
+
+    if (mode == "process_requests"sv) {
+        // Настройки из входного JSON имеют приоритет над сохраненными в снимке
+        serialization::SnapshotData snapshot_data = serialization::LoadCatalogue(serialization_settings.file, rh.GetCatalogue());
+        if (snapshot_data.render_settings && !mr.HasRenderSettings()) {
+            mr.SetRenderSettings(*snapshot_data.render_settings);
+        }
+        if (snapshot_data.routing_settings && !rh.GetRoutingSettings()) {
+            rh.SetRoutingSettings(*snapshot_data.routing_settings);
+        }
+        if (snapshot_data.route_table) {
+            rh.SetRouteTable(*snapshot_data.route_table);
+        }
+        if (snapshot_data.contraction_hierarchy) {
+            rh.SetContractionHierarchy(*snapshot_data.contraction_hierarchy);
+        }
+    }
+
     rh.ApplyBaseRequests();
 
-    json_reader::PrintStat(cout, rh.ApplyStatRequests(mr));
-}
\ No newline at end of file
+    if (mode == "make_base"sv) {
+        serialization::SnapshotData snapshot_data;
+        if (mr.HasRenderSettings()) {
+            snapshot_data.render_settings = mr.GetRenderSettings();
+        }
+        snapshot_data.routing_settings = rh.GetRoutingSettings();
+        if (const transport_router::TransportRouter* router = rh.GetRouter()) {
+            if (router->GetRouteTable()) {
+                snapshot_data.route_table = *router->GetRouteTable();
+            }
+            if (router->GetContractionHierarchy()) {
+                snapshot_data.contraction_hierarchy = *router->GetContractionHierarchy();
+            }
+        }
+        serialization::SaveCatalogue(serialization_settings.file, as_const(rh).GetCatalogue(), snapshot_data);
+        return 0;
+    }
+
+    // Ответы выводятся по мере готовности, без накопления всего массива в памяти
+    ProcessStatRequests(rh, mr);
+    if (is_online) {
+        cout << endl;
+        ProcessOnlineRequests(rh, mr);
+    } else if (is_serving) {
+        cout << endl;
+        server::Server(rh, mr).Serve(cin, cout);
+    } else if (socket_path) {
+        cout << endl;
+        try {
+            server::Server(rh, mr).ServeUnixSocket(*socket_path);
+        } catch (const exception& e) {
+            cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+}
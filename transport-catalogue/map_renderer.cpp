@@ -1,6 +1,7 @@
 #include "map_renderer.h"
 
-#include <deque>
+#include <cmath>
+#include <list>
 
 using namespace std;
 
@@ -14,189 +15,790 @@ svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
     };
 }
 
+const size_t kStopsPerCell = 4; // < среднее число остановок в ячейке сетки индекса
+const size_t kMaxCellsPerSide = 1024; // < наибольшее число ячеек сетки индекса по каждой из осей
+const size_t kTileCacheCapacity = 4096; // < наибольшее число тайлов в кэше
+const size_t kMinItemsPerChunk = 128; // < наименьшее число маршрутов или остановок в части слоя при параллельной отрисовке
+const size_t kChunksPerThread = 4; // < наибольшее число частей каждого слоя на поток
+
+const double kMaxSimplificationError = 0.5; // < наибольшее отклонение упрощенной линии маршрута от исходной в пикселях
+
+// Возвращает число символов в строке UTF-8 (байты продолжения многобайтовых символов не считаются)
+size_t CountCharacters(string_view text) {
+    return static_cast<size_t>(count_if(text.begin(), text.end(), [](char c) {
+        return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }));
+}
+
+// Возвращает квадрат расстояния от точки до отрезка
+double SquaredDistanceToSegment(svg::Point point, svg::Point begin, svg::Point end) {
+    const double dx = end.x - begin.x;
+    const double dy = end.y - begin.y;
+    const double length = dx * dx + dy * dy;
+    double t = 0;
+    if (length > 0) {
+        t = clamp(((point.x - begin.x) * dx + (point.y - begin.y) * dy) / length, 0.0, 1.0);
+    }
+    const double px = begin.x + t * dx - point.x;
+    const double py = begin.y + t * dy - point.y;
+    return px * px + py * py;
+}
+
+/* Упрощает ломаную: удаляет повторы вершин, а затем алгоритмом Дугласа-Пекера - вершины,
+   без которых ломаная отклоняется от исходной не больше чем на tolerance. Первая и последняя вершины сохраняются */
+void SimplifyPolyline(vector<svg::Point>& points, double tolerance) {
+    points.erase(unique(points.begin(), points.end(), [](svg::Point lhs, svg::Point rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }), points.end());
+    if (points.size() <= 2) {
+        return;
+    }
+
+    // Диапазоны обрабатываются через явный стек, чтобы длинные маршруты не углубляли рекурсию
+    vector<bool> keep(points.size(), false);
+    keep.front() = keep.back() = true;
+    vector<pair<size_t, size_t>> ranges{{0, points.size() - 1}};
+    const double squared_tolerance = tolerance * tolerance;
+    while (!ranges.empty()) {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+
+        double max_distance = 0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            const double distance = SquaredDistanceToSegment(points[i], points[first], points[last]);
+            if (distance > max_distance) {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+        if (max_distance > squared_tolerance) {
+            keep[farthest] = true;
+            ranges.emplace_back(first, farthest);
+            ranges.emplace_back(farthest, last);
+        }
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (keep[i]) {
+            points[size++] = points[i];
+        }
+    }
+    points.resize(size);
+}
+
+// Выводит SVG-документ в строку (точность буфера по умолчанию совпадает с точностью потока по умолчанию)
+shared_ptr<const string> RenderToString(const svg::Document& doc) {
+    svg::OutputBuffer out;
+    doc.Render(out);
+    return make_shared<const string>(out.Extract());
+}
+
 } // namespace
 
 namespace map_renderer {
 
+// Прямоугольник в координатах SVG-изображения
+struct MapRenderer::ScreenBox {
+    svg::Point min; // < левый верхний угол
+    svg::Point max; // < правый нижний угол
+
+    // Возвращает наименьший прямоугольник, содержащий обе точки
+    static ScreenBox Around(svg::Point lhs, svg::Point rhs) {
+        return {{std::min(lhs.x, rhs.x), std::min(lhs.y, rhs.y)}, {std::max(lhs.x, rhs.x), std::max(lhs.y, rhs.y)}};
+    }
+
+    /* Оценивает сверху прямоугольник подписи text с подложкой толщиной stroke.
+       Текст выводится от опорной точки вправо, а ширина символа не больше размера шрифта */
+    static ScreenBox AroundLabel(svg::Point anchor, svg::Point offset, int font_size, string_view text, double stroke) {
+        const svg::Point base{anchor.x + offset.x, anchor.y + offset.y};
+        const double width = static_cast<double>(font_size) * static_cast<double>(CountCharacters(text));
+        return {{base.x - stroke, base.y - font_size - stroke}, {base.x + width + stroke, base.y + font_size + stroke}};
+    }
+
+    // Возвращает прямоугольник, расширенный на margin во все стороны
+    ScreenBox Expanded(double margin) const {
+        return {{min.x - margin, min.y - margin}, {max.x + margin, max.y + margin}};
+    }
+
+    bool Contains(svg::Point point) const {
+        return min.x <= point.x && point.x <= max.x && min.y <= point.y && point.y <= max.y;
+    }
+
+    bool Intersects(const ScreenBox& other) const {
+        return min.x <= other.max.x && other.min.x <= max.x && min.y <= other.max.y && other.min.y <= max.y;
+    }
+
+    bool operator== (const ScreenBox& other) const {
+        return min.x == other.min.x && min.y == other.min.y && max.x == other.max.x && max.y == other.max.y;
+    }
+};
+
+/*
+ * Спроецированная карта для одного поколения каталога и настроек рендера.
+ * Индекс - равномерная сетка над плоскостью карты: для каждой ячейки хранятся остановки, подписи остановок и перегоны маршрутов,
+ * которые ее задевают. Индекс строится при первом запросе тайла, а отрисованные карта и тайлы кэшируются
+ */
+struct MapRenderer::Layout {
+    // Перегон маршрута между остановками segment и segment + 1 (у маршрута из одной остановки - сама остановка)
+    struct SegmentRef {
+        uint32_t bus; // < номер маршрута в buses
+        uint32_t segment; // < номер первой остановки перегона на маршруте
+
+        auto operator<=> (const SegmentRef& other) const = default;
+    };
+
+    // Списки элементов по ячейкам сетки, уложенные подряд в одном массиве
+    template <typename Item>
+    struct CellLists {
+        vector<uint32_t> offsets; // < начало списка каждой ячейки и конец последнего
+        vector<Item> items; // < элементы всех ячеек
+
+        // Раскладывает пары (ячейка, элемент) по ячейкам подсчетом
+        void Build(size_t cell_count, const vector<pair<uint32_t, Item>>& entries) {
+            offsets.assign(cell_count + 1, 0);
+            for (const auto& [cell, item] : entries) {
+                ++offsets[cell + 1];
+            }
+            for (size_t cell = 0; cell < cell_count; ++cell) {
+                offsets[cell + 1] += offsets[cell];
+            }
+            items.resize(entries.size());
+            vector<uint32_t> positions(offsets.begin(), offsets.end() - 1);
+            for (const auto& [cell, item] : entries) {
+                items[positions[cell]++] = item;
+            }
+        }
+    };
+
+    struct ScreenBoxHasher {
+        size_t operator()(const ScreenBox& box) const {
+            const hash<double> hasher;
+            size_t result = hasher(box.min.x);
+            for (double value : {box.min.y, box.max.x, box.max.y}) {
+                result = result * 37 + hasher(value);
+            }
+            return result;
+        }
+    };
+
+    using TileList = list<pair<ScreenBox, shared_ptr<const string>>>;
+
+    // Проецирует остановки маршрутов так же, как при отрисовке всей карты
+    void Project(const transport_catalogue::TransportCatalogue& catalogue, const RenderSettings& settings) {
+        const size_t stop_count = catalogue.GetStopCount();
+        vector<bool> is_on_map(stop_count, false);
+        buses.reserve(catalogue.GetBusCount());
+        bus_colors.reserve(catalogue.GetBusCount());
+        uint32_t color_index = 0;
+        for (domain::BusId bus_id : catalogue.GetAllBuses()) {
+            const domain::Bus* bus = catalogue.GetBus(bus_id);
+            // Маршрут через остановку без координат (пока только упомянутую) на карте не отрисовать
+            if (any_of(bus->stops.begin(), bus->stops.end(), [&catalogue](domain::StopId stop_id) { return !catalogue.GetStop(stop_id)->is_declared; })) {
+                continue;
+            }
+            buses.push_back(bus);
+            bus_colors.push_back(color_index);
+            if (bus->stops.size() == 0) {
+                continue;
+            }
+            ++color_index;
+            for (domain::StopId stop_id : bus->stops) {
+                is_on_map[stop_id] = true;
+            }
+        }
+
+        // Упорядочиваем все остановки в лексикографическом порядке
+        for (domain::StopId stop_id = 0; stop_id < stop_count; ++stop_id) {
+            if (is_on_map[stop_id]) {
+                stops.push_back(catalogue.GetStop(stop_id));
+            }
+        }
+        sort(stops.begin(), stops.end(), domain::StopPointerComparator{});
+
+        // Крайние точки набора не зависят от повторов, поэтому проекция совпадает с построенной по всем остановкам маршрутов
+        vector<geo::Coordinates> geo_coords;
+        geo_coords.reserve(stops.size());
+        for (const domain::Stop* stop : stops) {
+            geo_coords.push_back(stop->coords);
+        }
+        projector.emplace(geo_coords.begin(), geo_coords.end(), settings.width, settings.height, settings.padding);
+
+        // Спроецированные координаты доступны и в порядке stops, и по номеру остановки
+        stop_points.reserve(stops.size());
+        screen_coords.resize(stop_count);
+        for (const domain::Stop* stop : stops) {
+            const svg::Point point = (*projector)(stop->coords);
+            stop_points.push_back(point);
+            screen_coords[stop->id] = point;
+        }
+    }
+
+    // Строит сетку индекса над прямоугольником карты
+    void BuildIndex(const RenderSettings& settings) {
+        const double cells_per_side = ceil(sqrt(static_cast<double>(stops.size()) / kStopsPerCell));
+        columns = rows = clamp<size_t>(static_cast<size_t>(cells_per_side), 1, kMaxCellsPerSide);
+        cell_width = std::max(settings.width, 1.0) / static_cast<double>(columns);
+        cell_height = std::max(settings.height, 1.0) / static_cast<double>(rows);
+
+        vector<pair<uint32_t, uint32_t>> stop_entries;
+        stop_entries.reserve(stops.size());
+        for (size_t i = 0; i < stops.size(); ++i) {
+            ForEachCell({stop_points[i], stop_points[i]}, [&](uint32_t cell) {
+                stop_entries.emplace_back(cell, static_cast<uint32_t>(i));
+            });
+        }
+        stop_cells.Build(columns * rows, stop_entries);
+
+        // Подпись остановки попадает во все ячейки, которые задевает ее собственный прямоугольник
+        vector<pair<uint32_t, uint32_t>> stop_label_entries;
+        stop_label_entries.reserve(stops.size());
+        for (size_t i = 0; i < stops.size(); ++i) {
+            const ScreenBox label_box = ScreenBox::AroundLabel(stop_points[i], settings.stop_label_offset, settings.stop_label_font_size,
+                                                               stops[i]->name, settings.underlayer_width);
+            ForEachCell(label_box, [&](uint32_t cell) {
+                stop_label_entries.emplace_back(cell, static_cast<uint32_t>(i));
+            });
+        }
+        stop_label_cells.Build(columns * rows, stop_label_entries);
+
+        // Длинный перегон попадает во все ячейки, которые задевает его ограничивающий прямоугольник
+        vector<pair<uint32_t, SegmentRef>> segment_entries;
+        for (size_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+            const vector<domain::StopId>& bus_stops = buses[bus_index]->stops;
+            for (size_t segment = 0; segment + 1 < std::max<size_t>(bus_stops.size(), 2); ++segment) {
+                const svg::Point from = screen_coords[bus_stops[segment]];
+                const svg::Point to = screen_coords[bus_stops[std::min(segment + 1, bus_stops.size() - 1)]];
+                const SegmentRef ref{static_cast<uint32_t>(bus_index), static_cast<uint32_t>(segment)};
+                ForEachCell(ScreenBox::Around(from, to), [&](uint32_t cell) {
+                    segment_entries.emplace_back(cell, ref);
+                });
+            }
+        }
+        segment_cells.Build(columns * rows, segment_entries);
+    }
+
+    // Передает обработчику номера ячеек сетки, которые задевает прямоугольник
+    template <typename Visitor>
+    void ForEachCell(const ScreenBox& box, Visitor visitor) const {
+        const auto to_cell = [](double value, double cell_size, size_t count) {
+            const double cell = floor(value / cell_size);
+            return cell <= 0 ? size_t{0} : std::min(static_cast<size_t>(cell), count - 1);
+        };
+        const size_t column_begin = to_cell(box.min.x, cell_width, columns);
+        const size_t column_end = to_cell(box.max.x, cell_width, columns);
+        const size_t row_begin = to_cell(box.min.y, cell_height, rows);
+        const size_t row_end = to_cell(box.max.y, cell_height, rows);
+        for (size_t row = row_begin; row <= row_end; ++row) {
+            for (size_t column = column_begin; column <= column_end; ++column) {
+                visitor(static_cast<uint32_t>(row * columns + column));
+            }
+        }
+    }
+
+    // Возвращает без повторов и по возрастанию элементы ячеек, которые задевает прямоугольник
+    template <typename Item>
+    vector<Item> Collect(const CellLists<Item>& lists, const ScreenBox& box) const {
+        vector<Item> result;
+        ForEachCell(box, [&](uint32_t cell) {
+            result.insert(result.end(), lists.items.begin() + lists.offsets[cell], lists.items.begin() + lists.offsets[cell + 1]);
+        });
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    // Возвращает отрисованный тайл из кэша, отмечая его как последний использованный
+    shared_ptr<const string> FindTile(const ScreenBox& box) {
+        const auto it = tile_index.find(box);
+        if (it == tile_index.end()) {
+            return nullptr;
+        }
+        tiles.splice(tiles.begin(), tiles, it->second);
+        return it->second->second;
+    }
+
+    // Добавляет тайл в кэш, вытесняя давно не использованные, и возвращает тайл из кэша
+    shared_ptr<const string> AddTile(const ScreenBox& box, shared_ptr<const string> svg) {
+        // Тайл мог успеть отрисовать другой поток
+        if (shared_ptr<const string> cached = FindTile(box)) {
+            return cached;
+        }
+        tiles.emplace_front(box, move(svg));
+        tile_index.emplace(box, tiles.begin());
+        if (tiles.size() > kTileCacheCapacity) {
+            tile_index.erase(tiles.back().first);
+            tiles.pop_back();
+        }
+        return tiles.front().second;
+    }
+
+    uint64_t catalogue_generation = 0; // < поколение каталога
+    uint64_t settings_generation = 0; // < поколение настроек рендера
+
+    once_flag projection_once; // < флаг однократного проецирования
+    once_flag index_once; // < флаг однократного построения сетки индекса
+    once_flag map_once; // < флаг однократной отрисовки всей карты
+    mutex tiles_mutex; // < мьютекс, защищающий кэш тайлов
+
+    vector<const domain::Bus*> buses; // < маршруты в порядке вывода
+    vector<uint32_t> bus_colors; // < номер цвета палитры для каждого маршрута
+    vector<const domain::Stop*> stops; // < остановки маршрутов в порядке возрастания имени
+    vector<svg::Point> stop_points; // < спроецированные координаты остановок в порядке stops
+    ScreenCoords screen_coords; // < спроецированные координаты остановок по номеру (заданы только для остановок из stops)
+    optional<SphereProjector> projector; // < проекция всей карты
+
+    size_t columns = 1; // < число столбцов сетки
+    size_t rows = 1; // < число строк сетки
+    double cell_width = 1; // < ширина ячейки
+    double cell_height = 1; // < высота ячейки
+    CellLists<uint32_t> stop_cells; // < номера остановок в ячейках
+    CellLists<uint32_t> stop_label_cells; // < номера остановок, подписи которых задевают ячейку
+    CellLists<SegmentRef> segment_cells; // < перегоны маршрутов в ячейках
+
+    shared_ptr<const string> map; // < отрисованная карта (пусто, пока не запрошена)
+    TileList tiles; // < отрисованные тайлы, последние использованные первыми
+    unordered_map<ScreenBox, TileList::iterator, ScreenBoxHasher> tile_index; // < тайлы по их области
+};
+
 // Задание настроек для рендера
 void MapRenderer::SetRenderSettings(const RenderSettings& settings) {
     settings_ = settings;
+    ++settings_generation_;
 }
 
-// Отрисовывает автобусные маршруты
-void MapRenderer::DrawBusLines(svg::Document& doc, const set<const domain::Bus*, domain::BusPointerComparator>& buses) const {
-    size_t color_index = 0;
-    for (const domain::Bus* bus : buses) {
-        if (bus->stops.size() == 0) {
-            continue;
+// Возвращает текущие настройки рендера
+const RenderSettings& MapRenderer::GetRenderSettings() const {
+    return settings_;
+}
+
+// Проверяет, что настройки рендера были заданы
+bool MapRenderer::HasRenderSettings() const {
+    return settings_generation_ != 0;
+}
+
+/* Возвращает отрисованную карту в виде SVG-документа.
+   Карта отрисовывается один раз и переиспользуется, пока не изменятся каталог (его поколение) или настройки рендера */
+shared_ptr<const string> MapRenderer::GetMap(const transport_catalogue::TransportCatalogue& catalogue) const {
+    const shared_ptr<Layout> layout = GetLayout(catalogue);
+    // Одновременные запросы карты дожидаются одной общей отрисовки, не задерживая запросы тайлов
+    call_once(layout->map_once, [&] {
+        svg::OutputBuffer out;
+        RenderLayout(*layout, out);
+        layout->map = make_shared<const string>(out.Extract());
+    });
+    return layout->map;
+}
+
+/* Возвращает SVG-документ с частью карты внутри тайла (пустой указатель, если тайл задан неверно).
+   Тайлы кэшируются до изменения каталога или настроек рендера */
+shared_ptr<const string> MapRenderer::GetTile(const transport_catalogue::TransportCatalogue& catalogue, const MapTile& tile) const {
+    const shared_ptr<Layout> layout = GetLayout(catalogue);
+    call_once(layout->index_once, [&] {
+        layout->BuildIndex(settings_);
+    });
+    const optional<ScreenBox> box = GetTileBox(*layout, tile);
+    if (!box) {
+        return nullptr;
+    }
+    {
+        lock_guard guard(layout->tiles_mutex);
+        if (shared_ptr<const string> svg = layout->FindTile(*box)) {
+            return svg;
         }
+    }
+
+    // Разные тайлы отрисовываются параллельно: проекция и индекс после построения только читаются
+    shared_ptr<const string> svg = RenderToString(BuildTileDocument(*layout, *box));
 
-        svg::Polyline poly_line;
+    lock_guard guard(layout->tiles_mutex);
+    return layout->AddTile(*box, move(svg));
+}
 
-        poly_line.SetFillColor({});
-        poly_line.SetStrokeColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
-        poly_line.SetStrokeWidth(settings_.line_width);
-        poly_line.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-        poly_line.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+// Проецирует остановки маршрутов на плоскость карты
+shared_ptr<MapRenderer::Layout> MapRenderer::BuildLayout(const transport_catalogue::TransportCatalogue& catalogue) const {
+    shared_ptr<Layout> layout = make_shared<Layout>();
+    layout->Project(catalogue, settings_);
+    return layout;
+}
 
-        for (const domain::Stop* stop : bus->stops) {
-            poly_line.AddPoint(screen_coords_by_stop_name_.at(stop->name));
-            poly_line.AddPoint(screen_coords_by_stop_name_.at(stop->name));
+/* Возвращает проекцию карты для текущих каталога и настроек, заменяя устаревшую.
+   Мьютекс держится только на время поиска или замены указателя, а проецирует один из запросивших потоков вне его */
+shared_ptr<MapRenderer::Layout> MapRenderer::GetLayout(const transport_catalogue::TransportCatalogue& catalogue) const {
+    shared_ptr<Layout> layout;
+    {
+        lock_guard guard(cache_mutex_);
+        if (!layout_
+            || layout_->catalogue_generation != catalogue.GetGeneration()
+            || layout_->settings_generation != settings_generation_) {
+            layout_ = make_shared<Layout>();
+            layout_->catalogue_generation = catalogue.GetGeneration();
+            layout_->settings_generation = settings_generation_;
         }
+        layout = layout_;
+    }
+    call_once(layout->projection_once, [&] {
+        layout->Project(catalogue, settings_);
+    });
+    return layout;
+}
 
-        doc.Add(poly_line);
+// Возвращает область тайла в координатах карты, если тайл задан верно
+optional<MapRenderer::ScreenBox> MapRenderer::GetTileBox(const Layout& layout, const MapTile& tile) const {
+    if (tile.zoom >= 0) {
+        if (tile.zoom > kMaxTileZoom) {
+            return nullopt;
+        }
+        const int64_t tile_count = int64_t{1} << tile.zoom;
+        if (tile.x < 0 || tile.y < 0 || tile.x >= tile_count || tile.y >= tile_count) {
+            return nullopt;
+        }
+        const double tile_width = settings_.width / static_cast<double>(tile_count);
+        const double tile_height = settings_.height / static_cast<double>(tile_count);
+        return ScreenBox{{tile.x * tile_width, tile.y * tile_height}, {(tile.x + 1) * tile_width, (tile.y + 1) * tile_height}};
+    }
 
-        ++color_index;
+    // Прямоугольник, пересекающий 180-й меридиан, в проекции карты не непрерывен
+    if (tile.min_coords.lat > tile.max_coords.lat || tile.min_coords.lng > tile.max_coords.lng) {
+        return nullopt;
     }
+    // Широта растет вверх, а координата y - вниз
+    return ScreenBox{(*layout.projector)({tile.max_coords.lat, tile.min_coords.lng}), (*layout.projector)({tile.min_coords.lat, tile.max_coords.lng})};
 }
 
+// Отрисовывает линии маршрутов с номерами из [begin, end)
+void MapRenderer::DrawBusLines(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const {
+    svg::PathStyle style;
+    style.fill_color = svg::NoneColor;
+    style.width = settings_.line_width;
+    style.line_cap = svg::StrokeLineCap::ROUND;
+    style.line_join = svg::StrokeLineJoin::ROUND;
+
+    // Массив вершин переиспользуется для всех маршрутов
+    vector<svg::Point> points;
+    for (size_t bus_index = begin; bus_index < end; ++bus_index) {
+        const domain::Bus* bus = layout.buses[bus_index];
+        if (bus->stops.size() == 0) {
+            continue;
+        }
 
-// Отрисовывает подписи к автобусным маршрутам
-void MapRenderer::DrawBusLabels(svg::Document& doc, const set<const domain::Bus*, domain::BusPointerComparator>& buses) const {
-    size_t color_index = 0;
-    for (const domain::Bus* bus : buses) {
-        svg::Text underlayer;
-        svg::Text text;
+        style.stroke_color = settings_.color_palette[layout.bus_colors[bus_index] % settings_.color_palette.size()];
 
-        underlayer.SetPosition(screen_coords_by_stop_name_.at(bus->stops[0]->name));
-        text.SetPosition(screen_coords_by_stop_name_.at(bus->stops[0]->name));
-        underlayer.SetPosition(screen_coords_by_stop_name_.at(bus->stops[0]->name));
-        text.SetPosition(screen_coords_by_stop_name_.at(bus->stops[0]->name));
-        underlayer.SetOffset(settings_.bus_label_offset);
-        text.SetOffset(settings_.bus_label_offset);
-        underlayer.SetFontSize(settings_.bus_label_font_size);
-        text.SetFontSize(settings_.bus_label_font_size);
-        underlayer.SetFontFamily("Verdana");
-        text.SetFontFamily("Verdana");
-        underlayer.SetFontWeight("bold");
-        text.SetFontWeight("bold");
-        underlayer.SetData(bus->name);
-        text.SetData(bus->name);
+        points.clear();
+        for (domain::StopId stop_id : bus->stops) {
+            const svg::Point point = layout.screen_coords[stop_id];
+            points.push_back(point);
+            points.push_back(point);
+        }
+        if (settings_.simplify_lines) {
+            SimplifyPolyline(points, GetSimplificationTolerance(1));
+        }
 
-        underlayer.SetFillColor(settings_.underlayer_color);
-        underlayer.SetStrokeColor(settings_.underlayer_color);
-        underlayer.SetStrokeWidth(settings_.underlayer_width);
-        underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-        underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+        doc.AddPolyline(points.data(), points.size(), doc.AddStyle(style));
+    }
+}
 
-        text.SetFillColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
+// Добавляет подпись с подложкой: сначала подложку, затем сам текст
+void MapRenderer::DrawLabel(svg::Document& doc, svg::TextElement label, svg::StyleId underlayer_style, svg::StyleId text_style) const {
+    label.style = underlayer_style;
+    doc.AddText(label);
+    label.style = text_style;
+    doc.AddText(label);
+}
+
+// Отрисовывает подписи к маршрутам с номерами из [begin, end)
+void MapRenderer::DrawBusLabels(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const {
+    svg::TextElement label;
+    label.offset = settings_.bus_label_offset;
+    label.font_size = settings_.bus_label_font_size;
+    label.font_family = doc.AddString("Verdana"sv);
+    label.font_weight = doc.AddString("bold"sv);
+    const svg::StyleId underlayer_style = doc.AddStyle(MakeUnderlayerStyle());
+
+    svg::PathStyle text_style;
+    for (size_t bus_index = begin; bus_index < end; ++bus_index) {
+        const domain::Bus* bus = layout.buses[bus_index];
+        if (bus->stops.size() == 0) {
+            continue;
+        }
 
-        doc.Add(underlayer);
-        doc.Add(text);
+        // Цвет подписи совпадает с цветом линии маршрута
+        text_style.fill_color = settings_.color_palette[layout.bus_colors[bus_index] % settings_.color_palette.size()];
+        const svg::StyleId text_style_id = doc.AddStyle(text_style);
+
+        // Название маршрута копируется в документ один раз для всех его подписей
+        label.data = doc.AddString(bus->name);
+        label.position = layout.screen_coords[bus->stops[0]];
+        DrawLabel(doc, label, underlayer_style, text_style_id);
 
         // Если маршрут кольцевой или начальная и конечная остановки совпадают, то название маршрута выводим только у начальной остановки
-        if (!(bus->is_roundtrip) && bus->stops.size() != 1 && bus->stops[0]->name != bus->stops[bus->stops.size() / 2]->name) {
-            underlayer.SetPosition(screen_coords_by_stop_name_.at(bus->stops[bus->stops.size() / 2]->name));
-            text.SetPosition(screen_coords_by_stop_name_.at(bus->stops[bus->stops.size() / 2]->name));
-            underlayer.SetPosition(screen_coords_by_stop_name_.at(bus->stops[bus->stops.size() / 2]->name));
-            text.SetPosition(screen_coords_by_stop_name_.at(bus->stops[bus->stops.size() / 2]->name));
-            underlayer.SetOffset(settings_.bus_label_offset);
-            text.SetOffset(settings_.bus_label_offset);
-            underlayer.SetFontSize(settings_.bus_label_font_size);
-            text.SetFontSize(settings_.bus_label_font_size);
-            underlayer.SetFontFamily("Verdana");
-            text.SetFontFamily("Verdana");
-            underlayer.SetFontWeight("bold");
-            text.SetFontWeight("bold");
-            underlayer.SetData(bus->name);
-            text.SetData(bus->name);
-
-            underlayer.SetFillColor(settings_.underlayer_color);
-            underlayer.SetStrokeColor(settings_.underlayer_color);
-            underlayer.SetStrokeWidth(settings_.underlayer_width);
-            underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-            underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
-
-            text.SetFillColor(settings_.color_palette[color_index % settings_.color_palette.size()]);
-
-            doc.Add(underlayer);
-            doc.Add(text);
-        }
-
-        ++color_index;
+        if (!(bus->is_roundtrip) && bus->stops.size() != 1 && bus->stops[0] != bus->stops[bus->stops.size() / 2]) {
+            label.position = layout.screen_coords[bus->stops[bus->stops.size() / 2]];
+            DrawLabel(doc, label, underlayer_style, text_style_id);
+        }
     }    
 }
 
-// Отрисовывает остановки, через которые проходят автобусные маршруты
-void MapRenderer::DrawStopCircles(svg::Document& doc, const set<const domain::Stop*, domain::StopPointerComparator>& stops) const {
-    for (const domain::Stop* stop : stops) {
-        svg::Circle circle;
+// Отрисовывает остановки с номерами из [begin, end)
+void MapRenderer::DrawStopCircles(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const {
+    svg::PathStyle style;
+    style.fill_color = "white"s;
+    const svg::StyleId style_id = doc.AddStyle(style);
 
-        circle.SetCenter(screen_coords_by_stop_name_.at(stop->name));
-        circle.SetCenter(screen_coords_by_stop_name_.at(stop->name));
-        circle.SetRadius(settings_.stop_radius);
-        circle.SetFillColor("white");
-
-        doc.Add(circle);
+    for (size_t stop_index = begin; stop_index < end; ++stop_index) {
+        doc.AddCircle(layout.stop_points[stop_index], settings_.stop_radius, style_id);
     }
 }
 
-// Отрисовывает названия остановок
-void MapRenderer::DrawStopLabels(svg::Document& doc, const set<const domain::Stop*, domain::StopPointerComparator>& stops) const {
-    for (const domain::Stop* stop : stops) {
-        svg::Text underlayer;
-        svg::Text text;
+// Отрисовывает названия остановок с номерами из [begin, end)
+void MapRenderer::DrawStopLabels(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const {
+    svg::TextElement label;
+    label.offset = settings_.stop_label_offset;
+    label.font_size = settings_.stop_label_font_size;
+    label.font_family = doc.AddString("Verdana"sv);
+    const svg::StyleId underlayer_style = doc.AddStyle(MakeUnderlayerStyle());
+
+    svg::PathStyle text_style;
+    text_style.fill_color = "black"s;
+    const svg::StyleId text_style_id = doc.AddStyle(text_style);
+
+    for (size_t stop_index = begin; stop_index < end; ++stop_index) {
+        label.position = layout.stop_points[stop_index];
+        label.data = doc.AddString(layout.stops[stop_index]->name);
+        DrawLabel(doc, label, underlayer_style, text_style_id);
+    }
+}
 
-        underlayer.SetPosition(screen_coords_by_stop_name_.at(stop->name));
-        text.SetPosition(screen_coords_by_stop_name_.at(stop->name));
-        underlayer.SetPosition(screen_coords_by_stop_name_.at(stop->name));
-        text.SetPosition(screen_coords_by_stop_name_.at(stop->name));
-        underlayer.SetOffset(settings_.stop_label_offset);
-        text.SetOffset(settings_.stop_label_offset);
-        underlayer.SetFontSize(settings_.stop_label_font_size);
-        text.SetFontSize(settings_.stop_label_font_size);
-        underlayer.SetFontFamily("Verdana");
-        text.SetFontFamily("Verdana");
-        underlayer.SetData(stop->name);
-        text.SetData(stop->name);
+/* Возвращает допустимое отклонение упрощенной линии маршрута в координатах карты при масштабе scale:
+   не больше полпикселя и не больше половины ширины линии, чтобы упрощение было незаметно */
+double MapRenderer::GetSimplificationTolerance(double scale) const {
+    return std::min(kMaxSimplificationError, settings_.line_width / 2) / scale;
+}
 
-        underlayer.SetFillColor(settings_.underlayer_color);
-        underlayer.SetStrokeColor(settings_.underlayer_color);
-        underlayer.SetStrokeWidth(settings_.underlayer_width);
-        underlayer.SetStrokeLineCap(svg::StrokeLineCap::ROUND);
-        underlayer.SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+// Возвращает стиль подложки подписей
+svg::PathStyle MapRenderer::MakeUnderlayerStyle() const {
+    svg::PathStyle style;
+    style.fill_color = settings_.underlayer_color;
+    style.stroke_color = settings_.underlayer_color;
+    style.width = settings_.underlayer_width;
+    style.line_cap = svg::StrokeLineCap::ROUND;
+    style.line_join = svg::StrokeLineJoin::ROUND;
+    return style;
+}
 
-        text.SetFillColor({"black"});
+// Строит SVG-документ всей карты
+svg::Document MapRenderer::BuildDocument(const Layout& layout) const {
+    svg::Document doc;
 
-        doc.Add(underlayer);
-        doc.Add(text);
+    // Линия маршрута и до двух подписей с подложками на автобус, круг и подпись с подложкой на остановку
+    size_t point_count = 0;
+    for (const domain::Bus* bus : layout.buses) {
+        point_count += bus->stops.size() * 2;
     }
+    doc.Reserve(layout.buses.size() * 5 + layout.stops.size() * 3, point_count);
+
+    // Отрисуем все необходимые элементы
+    DrawBusLines(doc, layout, 0, layout.buses.size());
+    DrawBusLabels(doc, layout, 0, layout.buses.size());
+    DrawStopCircles(doc, layout, 0, layout.stops.size());
+    DrawStopLabels(doc, layout, 0, layout.stops.size());
+
+    return doc;
 }
 
-// Рендерит карту с выводом в поток
-void MapRenderer::Render(std::ostream& out, const set<const domain::Bus*, domain::BusPointerComparator>& buses) {
+/* Строит SVG-документ с частью карты внутри прямоугольника.
+   Слои и порядок элементов в них те же, что у всей карты, но выводятся только элементы, задевающие прямоугольник */
+svg::Document MapRenderer::BuildTileDocument(const Layout& layout, const ScreenBox& box) const {
     svg::Document doc;
+    doc.SetViewBox(box.min, box.max.x - box.min.x, box.max.y - box.min.y);
+
+    // Подряд идущие видимые перегоны одного маршрута выводятся одной ломаной
+    svg::PathStyle line_style;
+    line_style.fill_color = svg::NoneColor;
+    line_style.width = settings_.line_width;
+    line_style.line_cap = svg::StrokeLineCap::ROUND;
+    line_style.line_join = svg::StrokeLineJoin::ROUND;
+
+    // Масштаб тайла относительно всей карты: на более крупном масштабе линии упрощаются точнее
+    const double scale = std::min(settings_.width / (box.max.x - box.min.x), settings_.height / (box.max.y - box.min.y));
+    const vector<Layout::SegmentRef> segments = layout.Collect(layout.segment_cells, box.Expanded(settings_.line_width / 2));
+    vector<svg::Point> points;
+    for (size_t begin = 0; begin < segments.size();) {
+        size_t end = begin + 1;
+        while (end < segments.size() && segments[end].bus == segments[begin].bus && segments[end].segment == segments[end - 1].segment + 1) {
+            ++end;
+        }
 
-    // Упорядочиваем все остановки в лексикографическом порядке
-    // Создаем поле со всеми координатами остановок
-    set<const domain::Stop*, domain::StopPointerComparator> stops;
-    deque<geo::Coordinates> geo_coords;
-    for (const domain::Bus* bus : buses) {
+        const domain::Bus* bus = layout.buses[segments[begin].bus];
+        const size_t last_stop = min<size_t>(segments[end - 1].segment + 1, bus->stops.size() - 1);
+        points.clear();
+        for (size_t stop_index = segments[begin].segment; stop_index <= last_stop; ++stop_index) {
+            points.push_back(layout.screen_coords[bus->stops[stop_index]]);
+        }
+        if (settings_.simplify_lines) {
+            SimplifyPolyline(points, GetSimplificationTolerance(scale));
+        }
+        line_style.stroke_color = settings_.color_palette[layout.bus_colors[segments[begin].bus] % settings_.color_palette.size()];
+        doc.AddPolyline(points.data(), points.size(), doc.AddStyle(line_style));
+
+        begin = end;
+    }
+
+    const svg::StyleId underlayer_style = doc.AddStyle(MakeUnderlayerStyle());
+
+    // Подписи маршрутов: маршрутов немного, поэтому их начальные и конечные остановки проверяются перебором
+    svg::TextElement bus_label;
+    bus_label.offset = settings_.bus_label_offset;
+    bus_label.font_size = settings_.bus_label_font_size;
+    bus_label.font_family = doc.AddString("Verdana"sv);
+    bus_label.font_weight = doc.AddString("bold"sv);
+    svg::PathStyle bus_text_style;
+    for (size_t bus_index = 0; bus_index < layout.buses.size(); ++bus_index) {
+        const domain::Bus* bus = layout.buses[bus_index];
         if (bus->stops.size() == 0) {
             continue;
         }
-        
-        for (const domain::Stop* stop : bus->stops) {
-            geo_coords.push_back(stop->coords);
-            stops.insert(stop);
+
+        vector<domain::StopId> anchors{bus->stops[0]};
+        if (!(bus->is_roundtrip) && bus->stops.size() != 1 && bus->stops[0] != bus->stops[bus->stops.size() / 2]) {
+            anchors.push_back(bus->stops[bus->stops.size() / 2]);
+        }
+
+        bus_text_style.fill_color = settings_.color_palette[layout.bus_colors[bus_index] % settings_.color_palette.size()];
+        bus_label.data = {};
+        for (domain::StopId anchor : anchors) {
+            bus_label.position = layout.screen_coords[anchor];
+            if (!ScreenBox::AroundLabel(bus_label.position, bus_label.offset, settings_.bus_label_font_size, bus->name, settings_.underlayer_width).Intersects(box)) {
+                continue;
+            }
+            if (bus_label.data.IsEmpty()) {
+                bus_label.data = doc.AddString(bus->name);
+            }
+            DrawLabel(doc, bus_label, underlayer_style, doc.AddStyle(bus_text_style));
         }
     }
 
-    // Создадим на основе поля координат объект для проецирования географических координат на плоскость
-    const SphereProjector proj{geo_coords.begin(), geo_coords.end(), settings_.width, settings_.height, settings_.padding};
+    // Кружки и подписи остановок выбираются по своим сеткам и уточняются по своим размерам
+    svg::PathStyle circle_style;
+    circle_style.fill_color = "white"s;
+    const svg::StyleId circle_style_id = doc.AddStyle(circle_style);
+    const ScreenBox circle_box = box.Expanded(settings_.stop_radius);
+    for (uint32_t stop_index : layout.Collect(layout.stop_cells, circle_box)) {
+        if (circle_box.Contains(layout.stop_points[stop_index])) {
+            doc.AddCircle(layout.stop_points[stop_index], settings_.stop_radius, circle_style_id);
+        }
+    }
 
-    // Создадим словарь, который по имени остановки возвращает спроецированные координаты
-    for (const domain::Stop* stop : stops) {
-        screen_coords_by_stop_name_[stop->name] = proj(stop->coords);
+    svg::TextElement stop_label;
+    stop_label.offset = settings_.stop_label_offset;
+    stop_label.font_size = settings_.stop_label_font_size;
+    stop_label.font_family = doc.AddString("Verdana"sv);
+    svg::PathStyle stop_text_style;
+    stop_text_style.fill_color = "black"s;
+    const svg::StyleId stop_text_style_id = doc.AddStyle(stop_text_style);
+    for (uint32_t stop_index : layout.Collect(layout.stop_label_cells, box)) {
+        const domain::Stop* stop = layout.stops[stop_index];
+        stop_label.position = layout.stop_points[stop_index];
+        if (ScreenBox::AroundLabel(stop_label.position, stop_label.offset, settings_.stop_label_font_size, stop->name, settings_.underlayer_width).Intersects(box)) {
+            stop_label.data = doc.AddString(stop->name);
+            DrawLabel(doc, stop_label, underlayer_style, stop_text_style_id);
+        }
     }
 
-    // Отрисуем все необходимые элементы
-    DrawBusLines(doc, buses);
-    DrawBusLabels(doc, buses);
-    DrawStopCircles(doc, stops);
-    DrawStopLabels(doc, stops);
+    return doc;
+}
 
-    doc.Render(out);
+/* Отрисовывает всю карту в буфер.
+   Слои разбиваются на части по диапазонам маршрутов и остановок, которые строятся и выводятся в отдельные буферы
+   параллельно, а затем склеиваются в порядке слоев. Элементы частей не зависят друг от друга,
+   поэтому результат совпадает с последовательной отрисовкой при любом числе потоков */
+void MapRenderer::RenderLayout(const Layout& layout, svg::OutputBuffer& out) const {
+    enum class Layer {
+        BUS_LINES,
+        BUS_LABELS,
+        STOP_CIRCLES,
+        STOP_LABELS
+    };
+
+    // Часть слоя: элементы слоя для маршрутов или остановок с номерами из [begin, end)
+    struct Chunk {
+        Layer layer;
+        size_t begin;
+        size_t end;
+    };
+
+    const size_t thread_count = GetWorkerCount();
+    vector<Chunk> chunks;
+    for (const auto& [layer, item_count] : {pair{Layer::BUS_LINES, layout.buses.size()}, pair{Layer::BUS_LABELS, layout.buses.size()},
+                                           pair{Layer::STOP_CIRCLES, layout.stops.size()}, pair{Layer::STOP_LABELS, layout.stops.size()}}) {
+        // Частей с запасом больше, чем потоков, чтобы потоки выравнивались на частях разной стоимости
+        const size_t chunk_count = clamp<size_t>(item_count / kMinItemsPerChunk, 1, thread_count * kChunksPerThread);
+        for (size_t i = 0; i < chunk_count; ++i) {
+            chunks.push_back({layer, item_count * i / chunk_count, item_count * (i + 1) / chunk_count});
+        }
+    }
+
+    // Для небольшой карты или одного потока параллельная отрисовка не окупается
+    if (thread_count == 1 || chunks.size() <= 4) {
+        BuildDocument(layout).Render(out);
+        return;
+    }
+
+    vector<svg::OutputBuffer> parts(chunks.size(), svg::OutputBuffer(out.GetPrecision()));
+    // Пул разбирает части по одной, поэтому потоки выравниваются на частях разной стоимости
+    pool_->ParallelFor(chunks.size(), [&](size_t i) {
+        const Chunk& chunk = chunks[i];
+        svg::Document doc;
+        switch (chunk.layer) {
+        case Layer::BUS_LINES:
+            DrawBusLines(doc, layout, chunk.begin, chunk.end);
+            break;
+        case Layer::BUS_LABELS:
+            DrawBusLabels(doc, layout, chunk.begin, chunk.end);
+            break;
+        case Layer::STOP_CIRCLES:
+            DrawStopCircles(doc, layout, chunk.begin, chunk.end);
+            break;
+        case Layer::STOP_LABELS:
+            DrawStopLabels(doc, layout, chunk.begin, chunk.end);
+            break;
+        }
+        doc.RenderElements(parts[i]);
+    });
+
+    size_t size = out.View().size() + 128;
+    for (const svg::OutputBuffer& part : parts) {
+        size += part.View().size();
+    }
+    out.Reserve(size);
+
+    const svg::Document frame;
+    frame.RenderHeader(out);
+    for (const svg::OutputBuffer& part : parts) {
+        out << part.View();
+    }
+    frame.RenderFooter(out);
+}
+
+// Возвращает число потоков для отрисовки карты (1 без пула потоков)
+size_t MapRenderer::GetWorkerCount() const {
+    return pool_ ? pool_->GetThreadCount() : 1;
+}
+
+/* Задает пул потоков для параллельной отрисовки карты (nullptr - отрисовка в вызывающем потоке).
+   Пул не принадлежит рендеру и должен жить, пока рендер используется */
+void MapRenderer::SetWorkerPool(worker_pool::WorkerPool* pool) {
+    pool_ = pool;
+}
+
+// Рендерит карту с выводом в поток
+void MapRenderer::Render(std::ostream& out, const transport_catalogue::TransportCatalogue& catalogue) const {
+    // Разметка собирается в буфере с точностью потока и записывается в поток одним вызовом
+    svg::OutputBuffer buffer(static_cast<int>(out.precision()));
+    RenderLayout(*BuildLayout(catalogue), buffer);
+    const string_view text = buffer.View();
+    out.write(text.data(), static_cast<streamsize>(text.size()));
 }
 
-} // namespace map_renderer
\ No newline at end of file
+} // namespace map_renderer
@@ -3,14 +3,17 @@
 #include "domain.h"
 #include "geo.h"
 #include "svg.h"
+#include "transport_catalogue.h"
+#include "worker_pool.h"
 
 #include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
-#include <set>
+#include <string>
 #include <string_view>
-#include <unordered_map>
 #include <vector>
 
 namespace {
@@ -105,31 +108,111 @@ struct RenderSettings {
     double underlayer_width;
 
     std::vector<svg::Color> color_palette;
+
+    bool simplify_lines = false; // < флаг упрощения линий маршрутов: повторы вершин и незаметные отклонения не выводятся
+};
+
+// Спроецированные на плоскость координаты остановок по их номеру
+using ScreenCoords = std::vector<svg::Point>;
+
+// Наибольший уровень масштаба тайла
+inline constexpr int kMaxTileZoom = 20;
+
+/*
+ * Область карты для отрисовки тайлом: на уровне масштаба zoom вся карта делится на 2^zoom x 2^zoom тайлов,
+ * либо (при zoom < 0) область задается прямоугольником в географических координатах
+ */
+struct MapTile {
+    int zoom = -1; // < уровень масштаба (отрицательный - область задана прямоугольником)
+    int x = 0; // < номер столбца тайла слева направо
+    int y = 0; // < номер строки тайла сверху вниз
+    geo::Coordinates min_coords{}; // < угол прямоугольника с наименьшими широтой и долготой
+    geo::Coordinates max_coords{}; // < угол прямоугольника с наибольшими широтой и долготой
 };
 
 class MapRenderer {
 public:
-    // Рендерит карту с выводом в поток
-    void Render(std::ostream& out, const std::set<const domain::Bus*, domain::BusPointerComparator>& buses);
+    // Рендерит карту с выводом в поток (безопасно вызывать одновременно из нескольких потоков)
+    void Render(std::ostream& out, const transport_catalogue::TransportCatalogue& catalogue) const;
+
+    /* Возвращает отрисованную карту в виде SVG-документа.
+       Карта отрисовывается один раз и переиспользуется, пока не изменятся каталог (его поколение) или настройки рендера */
+    std::shared_ptr<const std::string> GetMap(const transport_catalogue::TransportCatalogue& catalogue) const;
+
+    /* Возвращает SVG-документ с частью карты внутри тайла (пустой указатель, если тайл задан неверно).
+       Тайл использует проекцию всей карты и выводится в ее координатах с атрибутом viewBox, поэтому соседние тайлы стыкуются.
+       Отрисовываются только перегоны, остановки и подписи, задевающие тайл: кандидаты выбираются по сетке
+       над спроецированными координатами. Тайлы кэшируются до изменения каталога или настроек рендера */
+    std::shared_ptr<const std::string> GetTile(const transport_catalogue::TransportCatalogue& catalogue, const MapTile& tile) const;
+
+    /* Задает пул потоков для параллельной отрисовки карты (nullptr - отрисовка в вызывающем потоке).
+       Пул не принадлежит рендеру и должен жить, пока рендер используется */
+    void SetWorkerPool(worker_pool::WorkerPool* pool);
 
     // Задание настроек для рендера
     void SetRenderSettings(const RenderSettings& settings);
 
+    // Возвращает текущие настройки рендера
+    const RenderSettings& GetRenderSettings() const;
+
+    // Проверяет, что настройки рендера были заданы
+    bool HasRenderSettings() const;
+
 private:
-    // Отрисовывает автобусные маршруты
-    void DrawBusLines(svg::Document& doc, const std::set<const domain::Bus*, domain::BusPointerComparator>& buses) const;
+    // Прямоугольник в координатах SVG-изображения
+    struct ScreenBox;
+
+    // Спроецированная карта для одного поколения каталога и настроек рендера вместе с индексом и кэшем отрисовок
+    struct Layout;
+
+    // Проецирует остановки маршрутов на плоскость карты
+    std::shared_ptr<Layout> BuildLayout(const transport_catalogue::TransportCatalogue& catalogue) const;
+
+    // Возвращает проекцию карты для текущих каталога и настроек, заменяя устаревшую (проецирует вне cache_mutex_)
+    std::shared_ptr<Layout> GetLayout(const transport_catalogue::TransportCatalogue& catalogue) const;
 
-    // Отрисовывает подписи к автобусным маршрутам
-    void DrawBusLabels(svg::Document& doc, const std::set<const domain::Bus*, domain::BusPointerComparator>& buses) const;
+    // Возвращает область тайла в координатах карты, если тайл задан верно
+    std::optional<ScreenBox> GetTileBox(const Layout& layout, const MapTile& tile) const;
 
-    // Отрисовывает остановки, через которые проходят автобусные маршруты
-    void DrawStopCircles(svg::Document& doc, const std::set<const domain::Stop*, domain::StopPointerComparator>& stops) const;
+    // Строит SVG-документ всей карты
+    svg::Document BuildDocument(const Layout& layout) const;
 
-    // Отрисовывает названия остановок
-    void DrawStopLabels(svg::Document& doc, const std::set<const domain::Stop*, domain::StopPointerComparator>& stops) const;
+    // Отрисовывает всю карту в буфер, параллельно по частям слоев при нескольких потоках
+    void RenderLayout(const Layout& layout, svg::OutputBuffer& out) const;
+
+    // Возвращает число потоков для отрисовки карты (1 без пула потоков)
+    size_t GetWorkerCount() const;
+
+    // Строит SVG-документ с частью карты внутри прямоугольника
+    svg::Document BuildTileDocument(const Layout& layout, const ScreenBox& box) const;
+
+    // Возвращает допустимое отклонение упрощенной линии маршрута в координатах карты при масштабе scale относительно всей карты
+    double GetSimplificationTolerance(double scale) const;
+
+    // Возвращает стиль подложки подписей
+    svg::PathStyle MakeUnderlayerStyle() const;
+
+    // Добавляет подпись с подложкой: сначала подложку, затем сам текст
+    void DrawLabel(svg::Document& doc, svg::TextElement label, svg::StyleId underlayer_style, svg::StyleId text_style) const;
+
+    // Отрисовывает линии маршрутов с номерами из [begin, end)
+    void DrawBusLines(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const;
+
+    // Отрисовывает подписи к маршрутам с номерами из [begin, end)
+    void DrawBusLabels(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const;
+
+    // Отрисовывает остановки с номерами из [begin, end)
+    void DrawStopCircles(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const;
+
+    // Отрисовывает названия остановок с номерами из [begin, end)
+    void DrawStopLabels(svg::Document& doc, const Layout& layout, size_t begin, size_t end) const;
 
     RenderSettings settings_; // < настройки рендера
-    std::unordered_map<std::string_view, svg::Point> screen_coords_by_stop_name_; // < спроецированные координаты остановок на плоскость по их имени
+    uint64_t settings_generation_ = 0; // < поколение настроек рендера, увеличивается при каждом их изменении
+    worker_pool::WorkerPool* pool_ = nullptr; // < пул потоков для отрисовки карты
+
+    mutable std::mutex cache_mutex_; // < мьютекс, защищающий указатель на проекцию карты
+    mutable std::shared_ptr<Layout> layout_; // < проекция карты для последних каталога и настроек
 };
 
 } // namespace map_renderer
\ No newline at end of file
@@ -1,11 +1,51 @@
 #include "request_handler.h"
 
-#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 using namespace std;
 
 namespace request_handler {
 
+namespace {
+
+constexpr size_t kTasksPerWorker = 64; // < длина очереди пула на один поток
+
+// Объект, построенный по версии каталога, вместе с этой версией: каталог живет, пока используется объект
+template <typename T>
+struct CatalogueBound {
+    template <typename... Args>
+    explicit CatalogueBound(shared_ptr<const transport_catalogue::TransportCatalogue> catalogue_version, Args&&... args)
+        : catalogue(move(catalogue_version))
+        , value(*catalogue, forward<Args>(args)...) {
+    }
+
+    shared_ptr<const transport_catalogue::TransportCatalogue> catalogue; // < версия каталога, по которой построен объект
+    T value; // < построенный объект
+};
+
+} // namespace
+
+LazyRouter::LazyRouter(Builder builder)
+    : builder_(move(builder)) {
+}
+
+// Возвращает маршрутизатор, строя его при первом обращении
+const transport_router::TransportRouter& LazyRouter::Get() const {
+    call_once(once_, [this]() {
+        router_ = builder_();
+        builder_ = nullptr;
+    });
+    return *router_;
+}
+
+RequestHandler::RequestHandler()
+    : version_(make_shared<const CatalogueVersion>(CatalogueVersion{make_shared<const transport_catalogue::TransportCatalogue>(), nullptr, nullptr}))
+    , pool_(make_unique<worker_pool::WorkerPool>(GetWorkerCount(), kTasksPerWorker * GetWorkerCount())) {
+}
+
 // Добавляет в очередь запрос на добавление остановки
 void RequestHandler::AddStopRequest(const StopRequest& stop_request) {
     stop_requests_.push_back(stop_request);
@@ -21,58 +61,266 @@ void RequestHandler::AddStatRequest(const StatRequest& stat_request) {
     stat_requests_.push_back(stat_request);
 }
 
-// Выполняет запросы на добавление остановок и маршрутов в каталог
+// Сразу применяет к каталогу запрос на добавление остановки, минуя очередь
+void RequestHandler::ApplyStopRequest(const StopRequest& stop_request) {
+    transport_catalogue::TransportCatalogue& catalogue = GetCatalogue();
+    NoteStopRequest(stop_request);
+    catalogue.AddStop(stop_request.name, stop_request.coords);
+    for (const auto& [stop, distance] : stop_request.distances) {
+        catalogue.SetStopDistances(stop_request.name, stop, distance);
+    }
+}
+
+// Сразу применяет к каталогу запрос на добавление маршрута, минуя очередь
+void RequestHandler::ApplyBusRequest(const BusRequest& bus_request) {
+    is_router_outdated_ = true;
+    GetCatalogue().AddBus(bus_request.name, bus_request.stops, bus_request.is_roundtrip);
+}
+
+/* Выполняет запросы на добавление остановок и маршрутов в каталог.
+   При повторном вызове пересчитываются только индексы, затронутые изменениями */
 void RequestHandler::ApplyBaseRequests() {
-    for (const StopRequest& stop_request : stop_requests_) {
-        catalogue_.AddStop(stop_request.name, stop_request.coords);
+    shared_ptr<const CatalogueVersion> current = version_.load();
+    shared_ptr<const transport_catalogue::TransportCatalogue> catalogue = current->catalogue;
+    if (draft_ || !stop_requests_.empty() || !bus_requests_.empty()) {
+        transport_catalogue::TransportCatalogue& draft = GetCatalogue();
+        for (const StopRequest& stop_request : stop_requests_) {
+            NoteStopRequest(stop_request);
+            draft.AddStop(stop_request.name, stop_request.coords);
+        }
+
+        for (const StopRequest& stop_request : stop_requests_) {
+            for (const auto& [stop, distance] : stop_request.distances) {
+                draft.SetStopDistances(stop_request.name, stop, distance);
+            }
+        }
+        stop_requests_.clear();
+
+        for (const BusRequest& bus_request : bus_requests_) {
+            draft.AddBus(bus_request.name, bus_request.stops, bus_request.is_roundtrip);
+            is_router_outdated_ = true;
+        }
+        bus_requests_.clear();
+
+        draft.CompactChanges();
+        draft.UpdateBusesInfo();
+        catalogue = move(draft_);
     }
 
-    for (const StopRequest& stop_request : stop_requests_) {
-        for (const auto& [stop, distance] : stop_request.distances) {
-            catalogue_.SetStopDistances(stop_request.name, stop, distance);
+    // Новая версия строится, пока запросы статистики читают опубликованную
+    auto next = make_shared<CatalogueVersion>(*current);
+    next->catalogue = catalogue;
+    if (is_stop_index_outdated_) {
+        auto stop_index = make_shared<CatalogueBound<spatial_index::StopIndex>>(catalogue);
+        next->stop_index = shared_ptr<const spatial_index::StopIndex>(stop_index, &stop_index->value);
+        is_stop_index_outdated_ = false;
+    } else if (!changed_stops_.empty()) {
+        vector<domain::StopId> changed_stops;
+        changed_stops.reserve(changed_stops_.size());
+        for (const string& name : changed_stops_) {
+            changed_stops.push_back(catalogue->GetStop(name)->id);
         }
+        auto stop_index = make_shared<CatalogueBound<spatial_index::StopIndex>>(catalogue, *current->stop_index, changed_stops);
+        next->stop_index = shared_ptr<const spatial_index::StopIndex>(stop_index, &stop_index->value);
+    }
+    changed_stops_.clear();
+    if (is_router_outdated_) {
+        next->router = routing_settings_ ? MakeRouter(catalogue) : nullptr;
+        is_router_outdated_ = false;
     }
-    stop_requests_.clear();
+    route_table_.reset();
+    hierarchy_.reset();
+
+    // Снятую с публикации версию освобождает последний читавший ее пакет запросов
+    current.reset();
+    version_.store(move(next));
+}
 
-    for (const BusRequest& bus_request : bus_requests_) {
-        catalogue_.AddBus(bus_request.name, bus_request.stops, bus_request.is_roundtrip);
+/* Создает маршрутизатор версии каталога, который при построении использует готовые иерархию сжатия и таблицу маршрутов,
+   если они подходят */
+shared_ptr<const LazyRouter> RequestHandler::MakeRouter(const shared_ptr<const transport_catalogue::TransportCatalogue>& catalogue) const {
+    // Построитель получает копии настроек и готовых данных, потому что вызывается уже после публикации версии
+    return make_shared<const LazyRouter>([catalogue, settings = *routing_settings_, route_table = route_table_, hierarchy = hierarchy_,
+                                          thread_count = GetWorkerCount()]() -> shared_ptr<const transport_router::TransportRouter> {
+        auto bound = make_shared<CatalogueBound<transport_router::TransportRouter>>(catalogue, settings);
+        transport_router::TransportRouter& router = bound->value;
+        if (settings.use_contraction_hierarchy && !(hierarchy && router.SetContractionHierarchy(*hierarchy))) {
+            router.BuildContractionHierarchy();
+        }
+        if (settings.use_route_table && !(route_table && router.SetRouteTable(*route_table))) {
+            router.BuildRouteTable(thread_count);
+        }
+        return {bound, &router};
+    });
+}
+
+/* Выполняет запросы на получение статистики из каталога.
+   Ответы возвращаются в порядке поступления запросов независимо от числа потоков */
+vector<StatResponse> RequestHandler::ApplyStatRequests(const map_renderer::MapRenderer& mr) {
+    // Весь пакет отвечается по одной версии каталога, а ответы продлевают ее жизнь
+    const shared_ptr<const CatalogueVersion> version = version_.load();
+    vector<StatResponse> stat_responses(stat_requests_.size());
+    ApplyStatRequestsRange(*version, mr, 0, stat_responses);
+    for (StatResponse& stat_response : stat_responses) {
+        stat_response.version = version;
     }
-    bus_requests_.clear();
+    stat_requests_.clear();
+    return stat_responses;
 }
 
-// Выполняет запросы на получение статистики из каталога
-deque<StatResponse> RequestHandler::ApplyStatRequests(map_renderer::MapRenderer& mr) {
-    deque<StatResponse> stat_responses;
+/* Выполняет запросы на получение статистики, передавая ответы обработчику по мере готовности.
+   Ответы передаются в порядке поступления запросов, одновременно в памяти хранится лишь небольшое окно ответов */
+void RequestHandler::ApplyStatRequests(const map_renderer::MapRenderer& mr, const function<void(const StatResponse&)>& on_response) {
+    // Весь пакет отвечается по одной версии каталога
+    const shared_ptr<const CatalogueVersion> version = version_.load();
+    // Окно выбрано так, чтобы каждому потоку доставалось достаточно запросов
+    const size_t window_size = kTasksPerWorker * GetWorkerCount();
+    vector<StatResponse> stat_responses;
+    for (size_t begin = 0; begin < stat_requests_.size(); begin += window_size) {
+        stat_responses.assign(min(window_size, stat_requests_.size() - begin), {});
+        ApplyStatRequestsRange(*version, mr, begin, stat_responses);
+        for (const StatResponse& stat_response : stat_responses) {
+            on_response(stat_response);
+        }
+    }
+    stat_requests_.clear();
+}
 
-    for (const StatRequest& stat_request : stat_requests_) {
-        if (stat_request.type == "Bus") {
-            domain::BusInfo bus_info = catalogue_.GetBusInfo(stat_request.name);
-            if (bus_info.num_of_stops) {
-                stat_responses.emplace_back(stat_request.id, bus_info);
-            } else {
-                stat_responses.emplace_back(stat_request.id, nullptr);
-            }
-        } else if (stat_request.type == "Stop") {
-            const domain::StopInfo& stop_info = catalogue_.GetStopInfo(stat_request.name);
-            if (&stop_info != &catalogue_.GetStopInfo("")) {
-                stat_responses.emplace_back(stat_request.id, stop_info);
-            } else {
-                stat_responses.emplace_back(stat_request.id, nullptr);
+// Выполняет запросы из заданного диапазона очереди параллельно, записывая ответы по их индексу
+void RequestHandler::ApplyStatRequestsRange(const CatalogueVersion& version, const map_renderer::MapRenderer& mr, size_t begin,
+                                            vector<StatResponse>& stat_responses) const {
+    // Опубликованная версия каталога неизменяема, поэтому запросы независимы
+    // Пул разбирает запросы по одному, поэтому долгий запрос Map не задерживает остальные
+    pool_->ParallelFor(stat_responses.size(), [&](size_t i) {
+        stat_responses[i] = ApplyStatRequest(stat_requests_[begin + i], version, mr);
+    });
+}
+
+/* Выполняет один запрос на получение статистики по опубликованной версии каталога.
+   Ответ продлевает жизнь этой версии, поэтому его можно выводить и после публикации следующей */
+StatResponse RequestHandler::ApplyStatRequest(const StatRequest& stat_request, const map_renderer::MapRenderer& mr) const {
+    shared_ptr<const CatalogueVersion> version = version_.load();
+    StatResponse stat_response = ApplyStatRequest(stat_request, *version, mr);
+    stat_response.version = move(version);
+    return stat_response;
+}
+
+// Задает число потоков для выполнения запросов статистики (0 - по числу ядер процессора)
+void RequestHandler::SetThreadCount(size_t thread_count) {
+    thread_count_ = thread_count;
+    pool_.reset();
+    pool_ = make_unique<worker_pool::WorkerPool>(GetWorkerCount(), kTasksPerWorker * GetWorkerCount());
+}
+
+// Задает настройки маршрутизации (граф маршрутов строится при выполнении базовых запросов)
+void RequestHandler::SetRoutingSettings(const transport_router::RoutingSettings& routing_settings) {
+    routing_settings_ = routing_settings;
+    is_router_outdated_ = true;
+}
+
+// Возвращает настройки маршрутизации, если они заданы
+const optional<transport_router::RoutingSettings>& RequestHandler::GetRoutingSettings() const {
+    return routing_settings_;
+}
+
+/* Задает готовую таблицу маршрутов (например, загруженную из снимка каталога).
+   Таблица используется вместо предрасчета, если подходит к построенному графу маршрутов */
+void RequestHandler::SetRouteTable(const transport_router::RouteTable& route_table) {
+    route_table_ = route_table;
+}
+
+/* Задает готовую иерархию сжатия графа маршрутов (например, загруженную из снимка каталога).
+   Иерархия используется вместо построения, если подходит к построенному графу маршрутов */
+void RequestHandler::SetContractionHierarchy(const transport_router::RoutingHierarchy& hierarchy) {
+    hierarchy_ = hierarchy;
+}
+
+// Возвращает маршрутизатор опубликованной версии, строя его при первом обращении (nullptr без настроек маршрутизации)
+const transport_router::TransportRouter* RequestHandler::GetRouter() const {
+    const shared_ptr<const CatalogueVersion> version = version_.load();
+    return version->router ? &version->router->Get() : nullptr;
+}
+
+// Возвращает число потоков для выполнения запросов статистики с учетом значения по умолчанию
+size_t RequestHandler::GetWorkerCount() const {
+    return thread_count_ ? thread_count_ : max<size_t>(thread::hardware_concurrency(), 1);
+}
+
+// Возвращает пул потоков обработчика, который переиспользуется всеми пакетами запросов статистики
+worker_pool::WorkerPool& RequestHandler::GetWorkerPool() const {
+    return *pool_;
+}
+
+// Отмечает индексы, которые затрагивает запрос на добавление остановки
+void RequestHandler::NoteStopRequest(const StopRequest& stop_request) {
+    changed_stops_.push_back(stop_request.name);
+    // Расстояния влияют на граф маршрутов, только если одна из остановок обслуживается маршрутами
+    for (const auto& [stop, distance] : stop_request.distances) {
+        if (GetCatalogue().IsStopServed(stop_request.name) || GetCatalogue().IsStopServed(stop)) {
+            is_router_outdated_ = true;
+            break;
+        }
+    }
+}
+
+// Выполняет один запрос на получение статистики
+StatResponse RequestHandler::ApplyStatRequest(const StatRequest& stat_request, const CatalogueVersion& version, const map_renderer::MapRenderer& mr) const {
+    const transport_catalogue::TransportCatalogue& catalogue = *version.catalogue;
+    if (stat_request.type == "Bus") {
+        domain::BusInfo bus_info = catalogue.GetBusInfo(stat_request.name);
+        if (bus_info.num_of_stops) {
+            return {stat_request.id, bus_info};
+        }
+    } else if (stat_request.type == "Stop") {
+        if (const optional<domain::StopInfo> stop_info = catalogue.GetStopInfo(stat_request.name)) {
+            StopBuses buses;
+            buses.reserve(stop_info->size());
+            for (domain::BusId bus_id : *stop_info) {
+                buses.push_back(catalogue.GetBus(bus_id));
             }
-        } else if (stat_request.type == "Map") {
-            stringstream map;
-            mr.Render(map, catalogue_.GetAllBuses()); 
-            stat_responses.emplace_back(stat_request.id, map.str());
+            return {stat_request.id, move(buses)};
         }
+    } else if (stat_request.type == "Map") {
+        return {stat_request.id, mr.GetMap(catalogue)};
+    } else if (stat_request.type == "MapTile") {
+        const map_renderer::MapTile tile{stat_request.zoom, stat_request.tile_x, stat_request.tile_y, stat_request.min_coords, stat_request.max_coords};
+        shared_ptr<const string> svg = mr.GetTile(catalogue, tile);
+        if (svg) {
+            return {stat_request.id, move(svg)};
+        }
+    } else if (stat_request.type == "Route" && version.router) {
+        // Маршрутизатор мог быть построен по одной из прежних версий, поэтому остановки ищутся в текущей
+        const domain::Stop* from = catalogue.GetStop(stat_request.from);
+        const domain::Stop* to = catalogue.GetStop(stat_request.to);
+        optional<transport_router::RouteInfo> route_info = from && to ? version.router->Get().FindRoute(from->id, to->id) : nullopt;
+        if (route_info) {
+            return {stat_request.id, move(*route_info)};
+        }
+    } else if (stat_request.type == "NearbyStops" && version.stop_index) {
+        return {stat_request.id, version.stop_index->FindNearby(stat_request.coords, stat_request.radius, stat_request.count)};
+    } else if (stat_request.type == "StopsInBox" && version.stop_index) {
+        return {stat_request.id, version.stop_index->FindInBox(stat_request.min_coords, stat_request.max_coords)};
     }
-    stat_requests_.clear();
+    return {stat_request.id, nullptr};
+}
 
-    return stat_responses;
+// Возвращает опубликованную версию каталога
+shared_ptr<const CatalogueVersion> RequestHandler::GetVersion() const {
+    return version_.load();
 }
 
-// Возвращает константную ссылку на каталог
+// Возвращает константную ссылку на опубликованный каталог (действительна до следующего ApplyBaseRequests)
 const transport_catalogue::TransportCatalogue& RequestHandler::GetCatalogue() const {
-    return catalogue_;
+    return *version_.load()->catalogue;
+}
+
+/* Возвращает ссылку на изменяемую копию каталога для следующей версии (например, для загрузки снимка).
+   Копия создается при первом изменении после публикации */
+transport_catalogue::TransportCatalogue& RequestHandler::GetCatalogue() {
+    if (!draft_) {
+        draft_ = make_shared<transport_catalogue::TransportCatalogue>(*version_.load()->catalogue);
+    }
+    return *draft_;
 }
 
-} // request_handler
\ No newline at end of file
+} // request_handler
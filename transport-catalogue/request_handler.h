@@ -1,11 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include "map_renderer.h"
+#include "spatial_index.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
+#include "worker_pool.h"
 
 namespace request_handler {
 
@@ -23,26 +33,130 @@ struct BusRequest {
 
 struct StatRequest {
     int id; // < id запроса статистики
-    std::string type; // < типа запроса статистики (Bus, Stop, Map)
-    std::string name; // < имя маршрута или остановки (для Map значение "")
+    std::string type; // < типа запроса статистики (Bus, Stop, Map, MapTile, Route, NearbyStops, StopsInBox)
+    std::string name; // < имя маршрута или остановки (только для Bus и Stop)
+    std::string from; // < имя начальной остановки (только для Route)
+    std::string to; // < имя конечной остановки (только для Route)
+    geo::Coordinates coords{}; // < точка поиска (только для NearbyStops)
+    double radius = 0; // < радиус поиска в метрах (только для NearbyStops)
+    size_t count = 0; // < наибольшее число остановок в ответе (только для NearbyStops)
+    geo::Coordinates min_coords{}; // < угол прямоугольника с наименьшими широтой и долготой (только для StopsInBox и MapTile)
+    geo::Coordinates max_coords{}; // < угол прямоугольника с наибольшими широтой и долготой (только для StopsInBox и MapTile)
+    int zoom = -1; // < уровень масштаба тайла (только для MapTile; отрицательный - область задана прямоугольником)
+    int tile_x = 0; // < номер столбца тайла (только для MapTile)
+    int tile_y = 0; // < номер строки тайла (только для MapTile)
 };
 
+/*
+ * Маршрутизатор версии каталога, который строится при первом запросе маршрута, а не при публикации версии:
+ * обновление маршрутов не ждет построения иерархии сжатия и таблицы маршрутов, пока маршруты не запрошены.
+ * Одновременные запросы маршрута ждут одного и того же построения
+ */
+class LazyRouter {
+public:
+    using Builder = std::function<std::shared_ptr<const transport_router::TransportRouter>()>;
+
+    explicit LazyRouter(Builder builder);
+
+    // Возвращает маршрутизатор, строя его при первом обращении
+    const transport_router::TransportRouter& Get() const;
+
+private:
+    mutable std::once_flag once_; // < флаг однократного построения
+    mutable Builder builder_; // < построитель маршрутизатора (освобождается после построения)
+    mutable std::shared_ptr<const transport_router::TransportRouter> router_; // < построенный маршрутизатор
+};
+
+/*
+ * Версия каталога вместе с построенными по ней индексами, неизменяемая после публикации.
+ * Индексы, которые не затронули изменения, разделяются с предыдущими версиями
+ * и продлевают жизнь той версии каталога, по которой были построены
+ */
+struct CatalogueVersion {
+    std::shared_ptr<const transport_catalogue::TransportCatalogue> catalogue; // < каталог
+    std::shared_ptr<const LazyRouter> router; // < маршрутизатор (пусто без настроек маршрутизации)
+    std::shared_ptr<const spatial_index::StopIndex> stop_index; // < пространственный индекс остановок
+};
+
+using StopBuses = std::vector<const domain::Bus*>; // < автобусные маршруты, проходящие через остановку, в порядке возрастания имени
+
 struct StatResponse {
     int id; // < id запроса статистики
-    std::variant<std::nullptr_t, domain::BusInfo, domain::StopInfo, std::string> info; // < описание ответа на запрос
+    std::variant<std::nullptr_t, domain::BusInfo, StopBuses, std::shared_ptr<const std::string>, transport_router::RouteInfo, spatial_index::NearbyStops, spatial_index::StopsInBox> info; // < описание ответа на запрос (карта разделяется между ответами)
+    std::shared_ptr<const CatalogueVersion> version{}; // < версия каталога, на остановки и маршруты которой ссылается ответ (задается для ответов, переживающих пакет запросов)
 };
 
+/*
+ * Обработчик запросов к каталогу.
+ * Запросы статистики отвечаются по опубликованной версии каталога без блокировок: пакет запоминает версию
+ * в начале и читает ее до конца, даже если тем временем опубликована новая.
+ * Изменения применяются к копии каталога, и ApplyBaseRequests публикует ее как новую версию, обновляя
+ * только затронутые изменениями индексы. Прежние версии освобождаются, когда их перестают читать.
+ * Запросы на изменение выполняются одним потоком, а пакеты запросов статистики - из любых потоков
+ */
 class RequestHandler {
 public:
-    // Выполняет запросы на добавление остановок и маршрутов в каталог
+    RequestHandler();
+
+    /* Выполняет запросы на добавление остановок и маршрутов в каталог.
+       Если заданы настройки маршрутизации, по каталогу при первом запросе маршрута строится граф маршрутов
+       и, если они включены, иерархия сжатия и таблица маршрутов.
+       При повторном вызове пересчитывается только статистика затронутых маршрутов, изменения расстояний и маршрутов
+       на остановках перестраивают таблицы каталога, лишь когда их накопится достаточно (TransportCatalogue::CompactChanges),
+       измененные остановки добавляются к пространственному индексу без перестроения дерева,
+       а маршрутизатор заново строится при следующем запросе маршрута, если менялись маршруты или расстояния на них.
+       Результат публикуется как новая версия каталога */
     void ApplyBaseRequests();
 
-    // Выполняет запросы на получение статистики из каталога
-    std::deque<StatResponse> ApplyStatRequests(map_renderer::MapRenderer& mr);
+    /* Выполняет запросы на получение статистики из каталога.
+       Ответы возвращаются в порядке поступления запросов независимо от числа потоков */
+    std::vector<StatResponse> ApplyStatRequests(const map_renderer::MapRenderer& mr);
+
+    /* Выполняет запросы на получение статистики, передавая ответы обработчику по мере готовности.
+       Ответы передаются в порядке поступления запросов, одновременно в памяти хранится лишь небольшое окно ответов */
+    void ApplyStatRequests(const map_renderer::MapRenderer& mr, const std::function<void(const StatResponse&)>& on_response);
+
+    /* Выполняет один запрос на получение статистики по опубликованной версии каталога.
+       Ответ продлевает жизнь этой версии, поэтому его можно выводить и после публикации следующей */
+    StatResponse ApplyStatRequest(const StatRequest& stat_request, const map_renderer::MapRenderer& mr) const;
+
+    /* Задает число потоков для выполнения запросов статистики (0 - по числу ядер процессора).
+       Пул потоков создается заново, поэтому вызывается до выполнения запросов */
+    void SetThreadCount(size_t thread_count);
+
+    // Возвращает число потоков для выполнения запросов статистики с учетом значения по умолчанию
+    size_t GetWorkerCount() const;
+
+    // Возвращает пул потоков обработчика, который переиспользуется всеми пакетами запросов статистики
+    worker_pool::WorkerPool& GetWorkerPool() const;
+
+    // Задает настройки маршрутизации (граф маршрутов строится при выполнении базовых запросов)
+    void SetRoutingSettings(const transport_router::RoutingSettings& routing_settings);
 
-    // Возвращает константную ссылку на каталог
+    // Возвращает настройки маршрутизации, если они заданы
+    const std::optional<transport_router::RoutingSettings>& GetRoutingSettings() const;
+
+    /* Задает готовую таблицу маршрутов (например, загруженную из снимка каталога).
+       Таблица используется вместо предрасчета, если подходит к построенному графу маршрутов */
+    void SetRouteTable(const transport_router::RouteTable& route_table);
+
+    /* Задает готовую иерархию сжатия графа маршрутов (например, загруженную из снимка каталога).
+       Иерархия используется вместо построения, если подходит к построенному графу маршрутов */
+    void SetContractionHierarchy(const transport_router::RoutingHierarchy& hierarchy);
+
+    // Возвращает маршрутизатор опубликованной версии, строя его при первом обращении (nullptr без настроек маршрутизации)
+    const transport_router::TransportRouter* GetRouter() const;
+
+    // Возвращает опубликованную версию каталога
+    std::shared_ptr<const CatalogueVersion> GetVersion() const;
+
+    // Возвращает константную ссылку на опубликованный каталог (действительна до следующего ApplyBaseRequests)
     const transport_catalogue::TransportCatalogue& GetCatalogue() const;
 
+    /* Возвращает ссылку на изменяемую копию каталога для следующей версии (например, для загрузки снимка).
+       Изменения становятся видны запросам статистики после ApplyBaseRequests */
+    transport_catalogue::TransportCatalogue& GetCatalogue();
+
     // Добавляет в очередь запрос на добавление остановки
     void AddStopRequest(const StopRequest& stop_request);
 
@@ -52,12 +166,44 @@ public:
     // Добавляет в очередь запрос на получение статистики
     void AddStatRequest(const StatRequest& stat_request);
 
+    // Сразу применяет к каталогу запрос на добавление остановки, минуя очередь
+    void ApplyStopRequest(const StopRequest& stop_request);
+
+    // Сразу применяет к каталогу запрос на добавление маршрута, минуя очередь
+    void ApplyBusRequest(const BusRequest& bus_request);
+
 private:
-    transport_catalogue::TransportCatalogue catalogue_; // < транспортный справочник (каталог)
+    // Выполняет запросы из заданного диапазона очереди параллельно, записывая ответы по их индексу
+    void ApplyStatRequestsRange(const CatalogueVersion& version, const map_renderer::MapRenderer& mr, size_t begin,
+                                std::vector<StatResponse>& stat_responses) const;
+
+    // Отмечает индексы, которые затрагивает запрос на добавление остановки
+    void NoteStopRequest(const StopRequest& stop_request);
+
+    /* Создает маршрутизатор версии каталога, который при построении использует готовые иерархию сжатия и таблицу маршрутов,
+       если они подходят */
+    std::shared_ptr<const LazyRouter> MakeRouter(const std::shared_ptr<const transport_catalogue::TransportCatalogue>& catalogue) const;
+
+    // Выполняет один запрос на получение статистики
+    StatResponse ApplyStatRequest(const StatRequest& stat_request, const CatalogueVersion& version, const map_renderer::MapRenderer& mr) const;
+
+    std::atomic<std::shared_ptr<const CatalogueVersion>> version_; // < опубликованная версия, по которой отвечаются запросы статистики
+    std::shared_ptr<transport_catalogue::TransportCatalogue> draft_; // < копия каталога с изменениями для следующей версии
 
     std::deque<StopRequest> stop_requests_; // < очередь запросов на добалвение остановки
     std::deque<BusRequest> bus_requests_; // < очередь запросов на добавление маршрутов
     std::deque<StatRequest> stat_requests_; // < очередь запросов на получение статистики
+
+    size_t thread_count_ = 1; // < число потоков для выполнения запросов статистики
+    std::unique_ptr<worker_pool::WorkerPool> pool_; // < пул из GetWorkerCount() потоков для выполнения запросов статистики
+
+    std::optional<transport_router::RoutingSettings> routing_settings_; // < настройки маршрутизации
+    std::optional<transport_router::RouteTable> route_table_; // < готовая таблица маршрутов для следующего построения маршрутизатора
+    std::optional<transport_router::RoutingHierarchy> hierarchy_; // < готовая иерархия сжатия для следующего построения маршрутизатора
+
+    bool is_router_outdated_ = true; // < флаг изменения маршрутов, расстояний на них или настроек маршрутизации
+    bool is_stop_index_outdated_ = true; // < флаг построения пространственного индекса заново (при первой публикации)
+    std::vector<std::string> changed_stops_; // < имена остановок, добавленных или перемещенных после публикации
 };
 
 } // namespace request_handler
\ No newline at end of file
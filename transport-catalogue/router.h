@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph {
+
+/*
+ * Поиск кратчайшего пути в графе алгоритмом Дейкстры с двоичной кучей.
+ * Рабочие массивы размером с граф выделяются один раз на поток и переиспользуются между запросами,
+ * а их сброс заменен отметками поколения запроса, поэтому поиск можно вызывать одновременно из нескольких потоков
+ */
+template <typename Weight>
+class Router {
+public:
+    struct RouteInfo {
+        Weight weight; // < суммарный вес пути
+        std::vector<EdgeId> edges; // < ребра пути в порядке следования
+    };
+
+    explicit Router(const DirectedWeightedGraph<Weight>& graph)
+        : graph_(graph) {
+    }
+
+    static constexpr EdgeId kNoEdge = std::numeric_limits<EdgeId>::max(); // < отсутствие ребра (для начальной и недостижимых вершин)
+
+    // Строит кратчайший путь между вершинами, если он существует
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const {
+        Workspace& workspace = GetWorkspace();
+        const uint32_t stamp = Search(workspace, from, to);
+
+        if (workspace.stamps[to] != stamp) {
+            return std::nullopt;
+        }
+
+        RouteInfo route{workspace.weights[to], {}};
+        for (EdgeId edge_id = workspace.prev_edges[to]; edge_id != kNoEdge; edge_id = workspace.prev_edges[graph_.GetEdge(edge_id).from]) {
+            route.edges.push_back(edge_id);
+        }
+        std::reverse(route.edges.begin(), route.edges.end());
+        return route;
+    }
+
+    /* Находит кратчайшие пути из вершины до всех вершин графа (дерево кратчайших путей).
+       Для каждой вершины записывает вес пути и последнее ребро пути; недостижимые вершины получают
+       бесконечный вес и kNoEdge. Размер weights и prev_edges должен быть равен числу вершин графа */
+    void BuildRouteTree(VertexId from, std::span<Weight> weights, std::span<EdgeId> prev_edges) const {
+        Workspace& workspace = GetWorkspace();
+        const uint32_t stamp = Search(workspace, from, std::nullopt);
+
+        for (VertexId vertex = 0; vertex < graph_.GetVertexCount(); ++vertex) {
+            const bool is_reached = workspace.stamps[vertex] == stamp;
+            weights[vertex] = is_reached ? workspace.weights[vertex] : std::numeric_limits<Weight>::infinity();
+            prev_edges[vertex] = is_reached ? workspace.prev_edges[vertex] : kNoEdge;
+        }
+    }
+
+private:
+
+    // Рабочие массивы поиска, принадлежащие одному потоку
+    struct Workspace {
+        std::vector<Weight> weights; // < найденные расстояния до вершин
+        std::vector<EdgeId> prev_edges; // < последние ребра найденных путей
+        std::vector<uint32_t> stamps; // < поколение запроса, в котором вершина была достигнута
+        uint32_t stamp = 0; // < поколение текущего запроса
+
+        uint32_t NextStamp() {
+            if (++stamp == 0) {
+                // Счетчик переполнился - сбрасываем отметки, чтобы старые не совпали с новыми
+                std::fill(stamps.begin(), stamps.end(), 0);
+                stamp = 1;
+            }
+            return stamp;
+        }
+
+        void Visit(VertexId vertex, uint32_t current_stamp, Weight weight, EdgeId prev_edge) {
+            stamps[vertex] = current_stamp;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+        }
+    };
+
+    /* Выполняет поиск из вершины from до извлечения вершины to из очереди (без to - до обхода всех достижимых вершин).
+       Возвращает отметку поиска, которой помечены достигнутые вершины рабочих массивов */
+    uint32_t Search(Workspace& workspace, VertexId from, std::optional<VertexId> to) const {
+        const uint32_t stamp = workspace.NextStamp();
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+        workspace.Visit(from, stamp, Weight{}, kNoEdge);
+        queue.push({Weight{}, from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > workspace.weights[vertex]) {
+                continue; // Устаревшая запись очереди
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (const Arc<Weight>& arc : graph_.GetIncidentArcs(vertex)) {
+                const Weight new_weight = weight + arc.weight;
+                if (workspace.stamps[arc.to] != stamp || new_weight < workspace.weights[arc.to]) {
+                    workspace.Visit(arc.to, stamp, new_weight, arc.edge_id);
+                    queue.push({new_weight, arc.to});
+                }
+            }
+        }
+        return stamp;
+    }
+
+    Workspace& GetWorkspace() const {
+        thread_local Workspace workspace;
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (workspace.stamps.size() < vertex_count) {
+            workspace.weights.resize(vertex_count);
+            workspace.prev_edges.resize(vertex_count);
+            workspace.stamps.resize(vertex_count, 0);
+        }
+        return workspace;
+    }
+
+    const DirectedWeightedGraph<Weight>& graph_;
+};
+
+} // namespace graph
@@ -0,0 +1,673 @@
+#include "serialization.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TC_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+namespace serialization {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'C', 'S', 'N', 'A', 'P', '\0', '\0'}; // < сигнатура файла снимка
+constexpr uint32_t kVersion = 7; // < версия формата снимка (снимки других версий не читаются, их нужно пересобрать make_base)
+constexpr uint32_t kByteOrderMark = 0x01020304; // < метка для проверки порядка байт
+constexpr uint32_t kHasRenderSettings = 1; // < флаг наличия настроек рендера в снимке
+constexpr uint32_t kHasRoutingSettings = 2; // < флаг наличия настроек маршрутизации в снимке
+constexpr uint32_t kHasRouteTable = 4; // < флаг наличия таблицы маршрутов в снимке
+constexpr uint32_t kHasContractionHierarchy = 8; // < флаг наличия иерархии сжатия графа маршрутов в снимке
+
+static_assert(sizeof(int) == sizeof(int32_t), "Snapshot format requires 32-bit int");
+
+/*
+ * Буфер для записи снимка.
+ * Массивы выравниваются по 8 байт от начала файла, чтобы при загрузке их можно было использовать на месте
+ */
+class SnapshotWriter {
+public:
+    template <typename T>
+    void Write(T value) {
+        static_assert(is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void WriteArray(span<const T> values) {
+        static_assert(is_trivially_copyable_v<T>);
+        Write<uint64_t>(values.size());
+        Align();
+        buffer_.append(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    }
+
+    void WriteString(string_view value) {
+        WriteArray(span<const char>(value.data(), value.size()));
+    }
+
+    const string& GetBuffer() const {
+        return buffer_;
+    }
+
+private:
+    void Align() {
+        buffer_.resize((buffer_.size() + 7) & ~size_t{7}, '\0');
+    }
+
+    string buffer_;
+};
+
+// Последовательное чтение снимка с проверкой границ
+class SnapshotReader {
+public:
+    SnapshotReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    template <typename T>
+    T Read() {
+        static_assert(is_trivially_copyable_v<T>);
+        Require(sizeof(T));
+        T value;
+        memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    // Возвращает массив, указывающий прямо на данные снимка
+    template <typename T>
+    span<const T> ReadArray() {
+        static_assert(is_trivially_copyable_v<T>);
+        const uint64_t count = Read<uint64_t>();
+        pos_ = (pos_ + 7) & ~size_t{7};
+        if (count > (size_ - min(pos_, size_)) / sizeof(T)) {
+            throw SerializationError("Snapshot is truncated");
+        }
+        const T* values = reinterpret_cast<const T*>(data_ + pos_);
+        pos_ += count * sizeof(T);
+        return {values, static_cast<size_t>(count)};
+    }
+
+    string_view ReadString() {
+        const span<const char> chars = ReadArray<char>();
+        return {chars.data(), chars.size()};
+    }
+
+private:
+    void Require(size_t bytes) const {
+        if (pos_ > size_ || size_ - pos_ < bytes) {
+            throw SerializationError("Snapshot is truncated");
+        }
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+/*
+ * Содержимое файла снимка.
+ * Файл отображается в память только для чтения, а при недоступности mmap считывается одним блоком
+ */
+class SnapshotFile {
+public:
+    explicit SnapshotFile(const filesystem::path& path) {
+#ifdef TC_HAS_MMAP
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+                void* mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (mapping != MAP_FAILED) {
+                    mapping_ = mapping;
+                    data_ = static_cast<const char*>(mapping);
+                    size_ = static_cast<size_t>(file_stat.st_size);
+                }
+            }
+            close(fd);
+            if (mapping_) {
+                return;
+            }
+        }
+#endif
+        ifstream input(path, ios::binary | ios::ate);
+        if (!input) {
+            throw SerializationError("Failed to open snapshot " + path.string());
+        }
+        size_ = static_cast<size_t>(input.tellg());
+        // Буфер из 8-байтовых слов гарантирует выравнивание массивов
+        buffer_.resize((size_ + 7) / 8);
+        input.seekg(0);
+        if (!input.read(reinterpret_cast<char*>(buffer_.data()), static_cast<streamsize>(size_))) {
+            throw SerializationError("Failed to read snapshot " + path.string());
+        }
+        data_ = reinterpret_cast<const char*>(buffer_.data());
+    }
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    ~SnapshotFile() {
+#ifdef TC_HAS_MMAP
+        if (mapping_) {
+            munmap(mapping_, size_);
+        }
+#endif
+    }
+
+    const char* Data() const {
+        return data_;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    void* mapping_ = nullptr; // < адрес отображения файла в память
+    vector<uint64_t> buffer_; // < считанное содержимое файла, если отображение недоступно
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Записывает набор строк как массив смещений и общий блок символов
+template <typename Names>
+void WriteNames(SnapshotWriter& writer, const Names& names) {
+    vector<uint32_t> offsets{0};
+    string blob;
+    for (string_view name : names) {
+        blob += name;
+        offsets.push_back(static_cast<uint32_t>(blob.size()));
+    }
+    writer.WriteArray(span<const uint32_t>(offsets));
+    writer.WriteString(blob);
+}
+
+// Читает набор строк, записанный WriteNames
+vector<string_view> ReadNames(SnapshotReader& reader) {
+    const span<const uint32_t> offsets = reader.ReadArray<uint32_t>();
+    const string_view blob = reader.ReadString();
+    if (offsets.empty()) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+
+    vector<string_view> names;
+    names.reserve(offsets.size() - 1);
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > blob.size()) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+        names.push_back(blob.substr(offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    return names;
+}
+
+void WriteColor(SnapshotWriter& writer, const svg::Color& color) {
+    writer.Write<uint8_t>(static_cast<uint8_t>(color.index()));
+    if (holds_alternative<string>(color)) {
+        writer.WriteString(get<string>(color));
+    } else if (holds_alternative<svg::Rgb>(color)) {
+        const svg::Rgb& rgb = get<svg::Rgb>(color);
+        writer.Write(rgb.red);
+        writer.Write(rgb.green);
+        writer.Write(rgb.blue);
+    } else if (holds_alternative<svg::Rgba>(color)) {
+        const svg::Rgba& rgba = get<svg::Rgba>(color);
+        writer.Write(rgba.red);
+        writer.Write(rgba.green);
+        writer.Write(rgba.blue);
+        writer.Write(rgba.opacity);
+    }
+}
+
+svg::Color ReadColor(SnapshotReader& reader) {
+    switch (reader.Read<uint8_t>()) {
+        case 0: return svg::NoneColor;
+        case 1: return string(reader.ReadString());
+        case 2: {
+            svg::Rgb rgb;
+            rgb.red = reader.Read<uint8_t>();
+            rgb.green = reader.Read<uint8_t>();
+            rgb.blue = reader.Read<uint8_t>();
+            return rgb;
+        }
+        case 3: {
+            svg::Rgba rgba;
+            rgba.red = reader.Read<uint8_t>();
+            rgba.green = reader.Read<uint8_t>();
+            rgba.blue = reader.Read<uint8_t>();
+            rgba.opacity = reader.Read<double>();
+            return rgba;
+        }
+        default: throw SerializationError("Snapshot contains unknown color type");
+    }
+}
+
+void WriteRenderSettings(SnapshotWriter& writer, const map_renderer::RenderSettings& settings) {
+    writer.Write(settings.width);
+    writer.Write(settings.height);
+    writer.Write(settings.padding);
+    writer.Write(settings.line_width);
+    writer.Write(settings.stop_radius);
+    writer.Write<int32_t>(settings.bus_label_font_size);
+    writer.Write(settings.bus_label_offset.x);
+    writer.Write(settings.bus_label_offset.y);
+    writer.Write<int32_t>(settings.stop_label_font_size);
+    writer.Write(settings.stop_label_offset.x);
+    writer.Write(settings.stop_label_offset.y);
+    WriteColor(writer, settings.underlayer_color);
+    writer.Write(settings.underlayer_width);
+    writer.Write<uint64_t>(settings.color_palette.size());
+    for (const svg::Color& color : settings.color_palette) {
+        WriteColor(writer, color);
+    }
+    writer.Write<uint8_t>(settings.simplify_lines);
+}
+
+map_renderer::RenderSettings ReadRenderSettings(SnapshotReader& reader) {
+    map_renderer::RenderSettings settings;
+    settings.width = reader.Read<double>();
+    settings.height = reader.Read<double>();
+    settings.padding = reader.Read<double>();
+    settings.line_width = reader.Read<double>();
+    settings.stop_radius = reader.Read<double>();
+    settings.bus_label_font_size = reader.Read<int32_t>();
+    settings.bus_label_offset.x = reader.Read<double>();
+    settings.bus_label_offset.y = reader.Read<double>();
+    settings.stop_label_font_size = reader.Read<int32_t>();
+    settings.stop_label_offset.x = reader.Read<double>();
+    settings.stop_label_offset.y = reader.Read<double>();
+    settings.underlayer_color = ReadColor(reader);
+    settings.underlayer_width = reader.Read<double>();
+    const uint64_t palette_size = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < palette_size; ++i) {
+        settings.color_palette.push_back(ReadColor(reader));
+    }
+    settings.simplify_lines = reader.Read<uint8_t>() != 0;
+    return settings;
+}
+
+void WriteRoutingSettings(SnapshotWriter& writer, const transport_router::RoutingSettings& settings) {
+    writer.Write<int32_t>(settings.bus_wait_time);
+    writer.Write(settings.bus_velocity);
+    writer.Write<uint8_t>(settings.use_route_table);
+    WriteNames(writer, settings.route_table_stops);
+    writer.Write<uint8_t>(settings.use_contraction_hierarchy);
+}
+
+transport_router::RoutingSettings ReadRoutingSettings(SnapshotReader& reader) {
+    transport_router::RoutingSettings settings;
+    settings.bus_wait_time = reader.Read<int32_t>();
+    settings.bus_velocity = reader.Read<double>();
+    settings.use_route_table = reader.Read<uint8_t>() != 0;
+    for (string_view stop_name : ReadNames(reader)) {
+        settings.route_table_stops.emplace_back(stop_name);
+    }
+    settings.use_contraction_hierarchy = reader.Read<uint8_t>() != 0;
+    return settings;
+}
+
+void WriteGraphHeader(SnapshotWriter& writer, const transport_router::GraphHeader& header) {
+    writer.Write(header.stop_count);
+    writer.Write(header.vertex_count);
+    writer.Write(header.edge_count);
+    writer.Write<int32_t>(header.bus_wait_time);
+    writer.Write(header.bus_velocity);
+}
+
+transport_router::GraphHeader ReadGraphHeader(SnapshotReader& reader) {
+    transport_router::GraphHeader header;
+    header.stop_count = reader.Read<uint32_t>();
+    header.vertex_count = reader.Read<uint32_t>();
+    header.edge_count = reader.Read<uint32_t>();
+    header.bus_wait_time = reader.Read<int32_t>();
+    header.bus_velocity = reader.Read<double>();
+    return header;
+}
+
+// Проверяет, что таблица расстояний ссылается только на существующие остановки, а соседи каждой остановки упорядочены по номеру
+void CheckDistanceTable(const transport_catalogue::DistanceTable::Arrays& distances, size_t stop_count) {
+    const span<const uint32_t> offsets = distances.offsets;
+    if (offsets.size() != stop_count + 1 || offsets.front() != 0 || offsets.back() != distances.neighbours.size()
+        || distances.distances.size() != distances.neighbours.size()
+        || distances.is_explicit.size() != distances.neighbours.size()) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+    for (size_t from = 0; from < stop_count; ++from) {
+        if (offsets[from] > offsets[from + 1]) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+        for (uint32_t i = offsets[from]; i < offsets[from + 1]; ++i) {
+            const bool is_sorted = i == offsets[from] || distances.neighbours[i - 1] < distances.neighbours[i];
+            if (distances.neighbours[i] >= stop_count || !is_sorted) {
+                throw SerializationError("Snapshot is corrupted");
+            }
+        }
+    }
+}
+
+// Таблица маршрутов записывается как есть, чтобы загружаться без предрасчета
+void WriteRouteTable(SnapshotWriter& writer, const transport_router::RouteTable& route_table) {
+    WriteGraphHeader(writer, route_table.GetHeader());
+
+    const transport_router::RouteTable::Arrays& arrays = route_table.GetArrays();
+    writer.WriteArray(arrays.sources);
+    writer.WriteArray(arrays.times);
+    writer.WriteArray(arrays.boarding_edges);
+    writer.WriteArray(arrays.alighting_edges);
+}
+
+// Читает таблицу маршрутов, массивы которой указывают прямо в файл снимка
+transport_router::RouteTable ReadRouteTable(SnapshotReader& reader, shared_ptr<const void> file) {
+    const transport_router::GraphHeader header = ReadGraphHeader(reader);
+
+    transport_router::RouteTable::Arrays arrays;
+    arrays.sources = reader.ReadArray<domain::StopId>();
+    arrays.times = reader.ReadArray<double>();
+    arrays.boarding_edges = reader.ReadArray<graph::EdgeId>();
+    arrays.alighting_edges = reader.ReadArray<graph::EdgeId>();
+    const uint64_t cell_count = static_cast<uint64_t>(arrays.sources.size()) * header.stop_count;
+    if (arrays.times.size() != cell_count || arrays.boarding_edges.size() != cell_count || arrays.alighting_edges.size() != cell_count) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+    for (domain::StopId source : arrays.sources) {
+        if (source >= header.stop_count) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+    }
+
+    transport_router::RouteTable route_table;
+    route_table.Attach(header, arrays, move(file));
+    return route_table;
+}
+
+using Hierarchy = graph::ContractionHierarchy<double>;
+
+// Иерархия сжатия записывается как есть, чтобы загружаться без построения
+void WriteContractionHierarchy(SnapshotWriter& writer, const transport_router::RoutingHierarchy& hierarchy) {
+    WriteGraphHeader(writer, hierarchy.header);
+
+    const Hierarchy::Arrays& arrays = hierarchy.hierarchy.GetArrays();
+    writer.WriteArray(arrays.ranks);
+    writer.WriteArray(arrays.up_offsets);
+    writer.WriteArray(arrays.up_arcs);
+    writer.WriteArray(arrays.down_offsets);
+    writer.WriteArray(arrays.down_arcs);
+    writer.WriteArray(arrays.edges);
+}
+
+// Проверяет, что списки смежности иерархии ссылаются только на существующие вершины и ребра
+void CheckHierarchyArcs(span<const uint32_t> offsets, span<const Hierarchy::Arc> arcs, size_t vertex_count, size_t edge_count) {
+    if (offsets.size() != vertex_count + 1 || offsets.front() != 0 || offsets.back() != arcs.size()) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+    }
+    for (const Hierarchy::Arc& arc : arcs) {
+        if (arc.to >= vertex_count || arc.edge_id >= edge_count) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+    }
+}
+
+// Читает иерархию сжатия, массивы которой указывают прямо в файл снимка
+transport_router::RoutingHierarchy ReadContractionHierarchy(SnapshotReader& reader, shared_ptr<const void> file) {
+    transport_router::RoutingHierarchy hierarchy;
+    hierarchy.header = ReadGraphHeader(reader);
+
+    Hierarchy::Arrays arrays;
+    arrays.ranks = reader.ReadArray<graph::VertexId>();
+    arrays.up_offsets = reader.ReadArray<uint32_t>();
+    arrays.up_arcs = reader.ReadArray<Hierarchy::Arc>();
+    arrays.down_offsets = reader.ReadArray<uint32_t>();
+    arrays.down_arcs = reader.ReadArray<Hierarchy::Arc>();
+    arrays.edges = reader.ReadArray<Hierarchy::Edge>();
+
+    const size_t vertex_count = hierarchy.header.vertex_count;
+    if (arrays.ranks.size() != vertex_count) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+    for (graph::VertexId rank : arrays.ranks) {
+        if (rank >= vertex_count) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+    }
+    CheckHierarchyArcs(arrays.up_offsets, arrays.up_arcs, vertex_count, arrays.edges.size());
+    CheckHierarchyArcs(arrays.down_offsets, arrays.down_arcs, vertex_count, arrays.edges.size());
+    // Короткая связь всегда создается позже своих частей, поэтому раскрытие связей конечно
+    for (size_t id = 0; id < arrays.edges.size(); ++id) {
+        const Hierarchy::Edge& edge = arrays.edges[id];
+        const bool is_valid = edge.second == Hierarchy::kNoEdge
+            ? edge.first < hierarchy.header.edge_count
+            : edge.first < id && edge.second < id;
+        if (!is_valid) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+    }
+
+    hierarchy.hierarchy.Attach(arrays, move(file));
+    return hierarchy;
+}
+
+} // namespace
+
+/*
+ * Сохраняет построенный каталог в компактный версионированный бинарный файл (снимок).
+ * В снимок входят остановки, расстояния, маршруты вместе с их статистикой, заданные настройки рендера и маршрутизации
+ * и предрассчитанные таблица маршрутов и иерархия сжатия графа маршрутов.
+ * Таблица расстояний каталога должна быть построена (BuildDistanceTable)
+ */
+void SaveCatalogue(const filesystem::path& path,
+                   const transport_catalogue::TransportCatalogue& catalogue,
+                   const SnapshotData& data) {
+    SnapshotWriter writer;
+    for (char c : kMagic) {
+        writer.Write(c);
+    }
+    writer.Write(kVersion);
+    writer.Write(kByteOrderMark);
+    writer.Write<uint32_t>((data.render_settings ? kHasRenderSettings : 0)
+                           | (data.routing_settings ? kHasRoutingSettings : 0)
+                           | (data.route_table ? kHasRouteTable : 0)
+                           | (data.contraction_hierarchy ? kHasContractionHierarchy : 0));
+
+    // Остановки в порядке номеров, чтобы при загрузке номера сохранились
+    const size_t stop_count = catalogue.GetStopCount();
+    vector<string_view> stop_names;
+    vector<double> latitudes;
+    vector<double> longitudes;
+    vector<uint8_t> is_declared;
+    stop_names.reserve(stop_count);
+    latitudes.reserve(stop_count);
+    longitudes.reserve(stop_count);
+    is_declared.reserve(stop_count);
+    for (domain::StopId id = 0; id < stop_count; ++id) {
+        const domain::Stop* stop = catalogue.GetStop(id);
+        stop_names.push_back(stop->name);
+        latitudes.push_back(stop->coords.lat);
+        longitudes.push_back(stop->coords.lng);
+        is_declared.push_back(stop->is_declared);
+    }
+    WriteNames(writer, stop_names);
+    writer.WriteArray(span<const double>(latitudes));
+    writer.WriteArray(span<const double>(longitudes));
+    // Неописанные остановки сохраняют только номер, на который ссылаются расстояния и маршруты
+    writer.WriteArray(span<const uint8_t>(is_declared));
+
+    // Таблица расстояний записывается как есть, чтобы загружаться без перестроения
+    const transport_catalogue::DistanceTable::Arrays& distances = catalogue.GetDistanceTable().GetArrays();
+    writer.WriteArray(distances.offsets);
+    writer.WriteArray(distances.neighbours);
+    writer.WriteArray(distances.distances);
+    writer.WriteArray(distances.is_explicit);
+
+    // Маршруты в порядке номеров вместе с предрасчитанной статистикой
+    const size_t bus_count = catalogue.GetBusCount();
+    vector<string_view> bus_names;
+    vector<uint8_t> is_roundtrip;
+    vector<uint32_t> route_offsets{0};
+    vector<domain::StopId> routes;
+    vector<int32_t> stop_counts;
+    vector<int32_t> unique_stop_counts;
+    vector<double> route_lengths;
+    vector<double> curvatures;
+    for (domain::BusId id = 0; id < bus_count; ++id) {
+        const domain::Bus* bus = catalogue.GetBus(id);
+        bus_names.push_back(bus->name);
+        is_roundtrip.push_back(bus->is_roundtrip);
+        routes.insert(routes.end(), bus->stops.begin(), bus->stops.end());
+        route_offsets.push_back(static_cast<uint32_t>(routes.size()));
+
+        const domain::BusInfo info = bus->info ? *bus->info : catalogue.GetBusInfo(bus->name);
+        stop_counts.push_back(info.num_of_stops);
+        unique_stop_counts.push_back(info.num_of_unique_stops);
+        route_lengths.push_back(info.route_length);
+        curvatures.push_back(info.curvature);
+    }
+    WriteNames(writer, bus_names);
+    writer.WriteArray(span<const uint8_t>(is_roundtrip));
+    writer.WriteArray(span<const uint32_t>(route_offsets));
+    writer.WriteArray(span<const domain::StopId>(routes));
+    writer.WriteArray(span<const int32_t>(stop_counts));
+    writer.WriteArray(span<const int32_t>(unique_stop_counts));
+    writer.WriteArray(span<const double>(route_lengths));
+    writer.WriteArray(span<const double>(curvatures));
+
+    if (data.render_settings) {
+        WriteRenderSettings(writer, *data.render_settings);
+    }
+    if (data.routing_settings) {
+        WriteRoutingSettings(writer, *data.routing_settings);
+    }
+    if (data.route_table) {
+        WriteRouteTable(writer, *data.route_table);
+    }
+    if (data.contraction_hierarchy) {
+        WriteContractionHierarchy(writer, *data.contraction_hierarchy);
+    }
+
+    // Запись через временный файл, чтобы читатели никогда не увидели снимок частично записанным
+    filesystem::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        ofstream output(tmp_path, ios::binary | ios::trunc);
+        const string& buffer = writer.GetBuffer();
+        if (!output.write(buffer.data(), static_cast<streamsize>(buffer.size()))) {
+            throw SerializationError("Failed to write snapshot " + tmp_path.string());
+        }
+    }
+    filesystem::rename(tmp_path, path);
+}
+
+/*
+ * Загружает снимок каталога в пустой каталог.
+ * Файл отображается в память только для чтения (при недоступности mmap - считывается одним блоком),
+ * таблицы расстояний и маршрутов и иерархия сжатия используются прямо из отображенного файла без копирования,
+ * поэтому несколько процессов разделяют одну копию в страничном кэше.
+ * Возвращает данные, сохраненные в снимке вместе с каталогом
+ */
+SnapshotData LoadCatalogue(const filesystem::path& path, transport_catalogue::TransportCatalogue& catalogue) {
+    if (catalogue.GetStopCount() != 0 || catalogue.GetBusCount() != 0) {
+        throw SerializationError("Snapshot can be loaded only into an empty catalogue");
+    }
+
+    auto file = make_shared<const SnapshotFile>(path);
+    SnapshotReader reader(file->Data(), file->Size());
+
+    for (char c : kMagic) {
+        if (reader.Read<char>() != c) {
+            throw SerializationError("File is not a transport catalogue snapshot");
+        }
+    }
+    const uint32_t version = reader.Read<uint32_t>();
+    if (version != kVersion) {
+        throw SerializationError("Unsupported snapshot version " + to_string(version) + " (expected " + to_string(kVersion)
+                                 + "), rebuild the snapshot with make_base");
+    }
+    if (reader.Read<uint32_t>() != kByteOrderMark) {
+        throw SerializationError("Snapshot was written with a different byte order");
+    }
+    const uint32_t flags = reader.Read<uint32_t>();
+
+    const vector<string_view> stop_names = ReadNames(reader);
+    const span<const double> latitudes = reader.ReadArray<double>();
+    const span<const double> longitudes = reader.ReadArray<double>();
+    const span<const uint8_t> is_declared = reader.ReadArray<uint8_t>();
+    if (latitudes.size() != stop_names.size() || longitudes.size() != stop_names.size()
+        || is_declared.size() != stop_names.size()) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+    for (size_t i = 0; i < stop_names.size(); ++i) {
+        if (!is_declared[i]) {
+            catalogue.AddStopReference(stop_names[i]);
+        } else {
+            catalogue.AddStop(string(stop_names[i]), {latitudes[i], longitudes[i]});
+        }
+    }
+
+    transport_catalogue::DistanceTable::Arrays distances;
+    distances.offsets = reader.ReadArray<uint32_t>();
+    distances.neighbours = reader.ReadArray<domain::StopId>();
+    distances.distances = reader.ReadArray<int>();
+    distances.is_explicit = reader.ReadArray<uint8_t>();
+    CheckDistanceTable(distances, stop_names.size());
+    transport_catalogue::DistanceTable distance_table;
+    distance_table.Attach(distances, file);
+    catalogue.SetDistanceTable(move(distance_table));
+
+    const vector<string_view> bus_names = ReadNames(reader);
+    const span<const uint8_t> is_roundtrip = reader.ReadArray<uint8_t>();
+    const span<const uint32_t> route_offsets = reader.ReadArray<uint32_t>();
+    const span<const domain::StopId> routes = reader.ReadArray<domain::StopId>();
+    const span<const int32_t> stop_counts = reader.ReadArray<int32_t>();
+    const span<const int32_t> unique_stop_counts = reader.ReadArray<int32_t>();
+    const span<const double> route_lengths = reader.ReadArray<double>();
+    const span<const double> curvatures = reader.ReadArray<double>();
+    const size_t bus_count = bus_names.size();
+    if (is_roundtrip.size() != bus_count || route_offsets.size() != bus_count + 1
+        || stop_counts.size() != bus_count || unique_stop_counts.size() != bus_count
+        || route_lengths.size() != bus_count || curvatures.size() != bus_count) {
+        throw SerializationError("Snapshot is corrupted");
+    }
+
+    vector<domain::StopId> route;
+    for (size_t i = 0; i < bus_count; ++i) {
+        if (route_offsets[i] > route_offsets[i + 1] || route_offsets[i + 1] > routes.size()) {
+            throw SerializationError("Snapshot is corrupted");
+        }
+        route.assign(routes.begin() + route_offsets[i], routes.begin() + route_offsets[i + 1]);
+        const domain::BusInfo info{stop_counts[i], unique_stop_counts[i], route_lengths[i], curvatures[i]};
+        catalogue.AddBus(string(bus_names[i]), route, is_roundtrip[i] != 0, info);
+    }
+
+    SnapshotData data;
+    if (flags & kHasRenderSettings) {
+        data.render_settings = ReadRenderSettings(reader);
+    }
+    if (flags & kHasRoutingSettings) {
+        data.routing_settings = ReadRoutingSettings(reader);
+    }
+    if (flags & kHasRouteTable) {
+        data.route_table = ReadRouteTable(reader, file);
+    }
+    if (flags & kHasContractionHierarchy) {
+        data.contraction_hierarchy = ReadContractionHierarchy(reader, file);
+    }
+    return data;
+}
+
+} // namespace serialization
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace serialization {
+
+// Исключение, выбрасывающееся при ошибке чтения или записи снимка каталога
+class SerializationError : public std::runtime_error {
+public:
+    using runtime_error::runtime_error;
+};
+
+struct SerializationSettings {
+    std::filesystem::path file; // < путь к файлу снимка каталога
+};
+
+// Данные, сохраняемые в снимке вместе с каталогом
+struct SnapshotData {
+    std::optional<map_renderer::RenderSettings> render_settings; // < настройки рендера карты
+    std::optional<transport_router::RoutingSettings> routing_settings; // < настройки маршрутизации
+    std::optional<transport_router::RouteTable> route_table; // < предрассчитанная таблица маршрутов
+    std::optional<transport_router::RoutingHierarchy> contraction_hierarchy; // < иерархия сжатия графа маршрутов
+};
+
+/*
+ * Сохраняет построенный каталог в компактный версионированный бинарный файл (снимок).
+ * В снимок входят остановки, расстояния, маршруты вместе с их статистикой, заданные настройки рендера и маршрутизации
+ * и предрассчитанные таблица маршрутов и иерархия сжатия графа маршрутов.
+ * Таблица расстояний каталога должна быть построена (BuildDistanceTable)
+ */
+void SaveCatalogue(const std::filesystem::path& path,
+                   const transport_catalogue::TransportCatalogue& catalogue,
+                   const SnapshotData& data);
+
+/*
+ * Загружает снимок каталога в пустой каталог.
+ * Файл отображается в память только для чтения (при недоступности mmap - считывается одним блоком),
+ * таблицы расстояний и маршрутов и иерархия сжатия используются прямо из отображенного файла без копирования,
+ * поэтому несколько процессов разделяют одну копию в страничном кэше.
+ * Возвращает данные, сохраненные в снимке вместе с каталогом
+ */
+SnapshotData LoadCatalogue(const std::filesystem::path& path, transport_catalogue::TransportCatalogue& catalogue);
+
+} // namespace serialization
@@ -0,0 +1,279 @@
+#include "server.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "json.h"
+#include "json_reader.h"
+
+using namespace std;
+
+namespace server {
+
+namespace {
+
+constexpr size_t kPipelineDepth = 1024; // < наибольшее число запросов соединения, ожидающих вывода ответа
+constexpr size_t kMaxConnections = 128; // < наибольшее число одновременно обслуживаемых соединений на Unix-сокете
+
+// Буферизованное чтение строк из сокета
+class SocketLineReader {
+public:
+    explicit SocketLineReader(int fd)
+        : fd_(fd) {
+    }
+
+    // Читает очередную строку без символа перевода строки, возвращает false в конце ввода
+    bool ReadLine(string& line) {
+        line.clear();
+        while (true) {
+            const size_t end = buffer_.find('\n', begin_);
+            if (end != string::npos) {
+                line.append(buffer_, begin_, end - begin_);
+                begin_ = end + 1;
+                return true;
+            }
+            line.append(buffer_, begin_, string::npos);
+            buffer_.clear();
+            begin_ = 0;
+
+            char chunk[1 << 16];
+            const ssize_t size = recv(fd_, chunk, sizeof(chunk), 0);
+            if (size < 0 && errno == EINTR) {
+                continue;
+            }
+            if (size <= 0) {
+                // Последняя строка без перевода строки тоже считается запросом
+                return !line.empty();
+            }
+            buffer_.assign(chunk, static_cast<size_t>(size));
+        }
+    }
+
+private:
+    int fd_; // < дескриптор сокета
+    string buffer_; // < прочитанные, но еще не разобранные данные
+    size_t begin_ = 0; // < начало неразобранной части буфера
+};
+
+// Записывает данные в сокет целиком, возвращает false, если соединение закрыто
+bool WriteAll(int fd, string_view data) {
+    while (!data.empty()) {
+        // MSG_NOSIGNAL: закрытое клиентом соединение не должно завершать сервер сигналом SIGPIPE
+        const ssize_t size = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(size));
+    }
+    return true;
+}
+
+} // namespace
+
+Server::Server(const request_handler::RequestHandler& rh, const map_renderer::MapRenderer& mr)
+    : rh_(rh)
+    , mr_(mr)
+    , pool_(rh.GetWorkerPool()) {
+}
+
+// Закрывает открытые соединения на Unix-сокете и дожидается завершения их потоков
+Server::~Server() {
+    {
+        // Чтение из закрытого сокета завершается, и поток соединения доотвечает на уже принятые запросы
+        lock_guard guard(connections_mutex_);
+        for (const Connection& connection : connections_) {
+            if (connection.fd >= 0) {
+                shutdown(connection.fd, SHUT_RDWR);
+            }
+        }
+    }
+    for (Connection& connection : connections_) {
+        if (connection.thread.joinable()) {
+            connection.thread.join();
+        }
+    }
+}
+
+// Обслуживает запросы из потока ввода до его конца, выводя ответы в поток вывода
+void Server::Serve(istream& input, ostream& output) {
+    ServeConnection(
+        [&input](string& line) {
+            return static_cast<bool>(getline(input, line));
+        },
+        [&output](string_view response) {
+            output << response << endl;
+            return static_cast<bool>(output);
+        });
+}
+
+/* Принимает соединения на Unix-сокете по пути path и обслуживает каждое в отдельном потоке.
+   Возвращает управление только при ошибке сокета (выбрасывает std::system_error) */
+void Server::ServeUnixSocket(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument("Socket path is too long: "s + path);
+    }
+    path.copy(address.sun_path, path.size());
+
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        throw system_error(errno, system_category(), "socket"s);
+    }
+    // Файл сокета мог остаться от предыдущего запуска
+    unlink(path.c_str());
+    if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+        const int error = errno;
+        close(listener);
+        throw system_error(error, system_category(), "bind "s + path);
+    }
+
+    while (true) {
+        // Новое соединение принимается, только когда освобождается место, остальные ждут в очереди сокета
+        {
+            unique_lock lock(connections_mutex_);
+            connection_finished_.wait(lock, [this] {
+                ReapConnections();
+                return connections_.size() < kMaxConnections;
+            });
+        }
+
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            const int error = errno;
+            close(listener);
+            throw system_error(error, system_category(), "accept"s);
+        }
+
+        // Поток запускается под мьютексом, поэтому его нельзя присоединить раньше, чем он записан в соединение
+        lock_guard guard(connections_mutex_);
+        Connection& connection = connections_.emplace_back();
+        connection.fd = fd;
+        connection.thread = thread([this, &connection, fd] {
+            SocketLineReader reader(fd);
+            ServeConnection(
+                [&reader](string& line) {
+                    return reader.ReadLine(line);
+                },
+                [fd](string_view response) {
+                    return WriteAll(fd, response) && WriteAll(fd, "\n"sv);
+                });
+            lock_guard guard(connections_mutex_);
+            close(fd);
+            connection.fd = -1;
+            connection.is_finished = true;
+            connection_finished_.notify_one();
+        });
+    }
+}
+
+// Дожидается завершения потоков обслуженных соединений и удаляет их (вызывается под connections_mutex_)
+void Server::ReapConnections() {
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->is_finished) {
+            // Поток уже вышел из-под мьютекса и лишь завершается, поэтому присоединение не ждет других соединений
+            it->thread.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* Обслуживает одно соединение: read_line читает очередную строку (false - конец ввода),
+   write выводит строку ответа (false - вывод невозможен, остальные ответы отбрасываются) */
+void Server::ServeConnection(const function<bool(string&)>& read_line, const function<bool(string_view)>& write) {
+    // Ответ на запрос соединения, ожидающий вывода
+    struct PendingResponse {
+        string text; // < строка ответа
+        bool is_ready = false; // < флаг готовности ответа
+    };
+
+    mutex mutex;
+    condition_variable changed; // < сигнал о готовности ответа, выводе ответа или конце ввода
+    deque<shared_ptr<PendingResponse>> pending; // < ответы в порядке запросов
+    bool is_input_finished = false;
+
+    // Ответы выводятся отдельным потоком, пока чтение запросов продолжается
+    thread writer([&] {
+        bool can_write = true;
+        unique_lock lock(mutex);
+        while (true) {
+            changed.wait(lock, [&] {
+                return (!pending.empty() && pending.front()->is_ready) || (pending.empty() && is_input_finished);
+            });
+            if (pending.empty()) {
+                return;
+            }
+            const shared_ptr<PendingResponse> response = move(pending.front());
+            pending.pop_front();
+            changed.notify_all();
+            lock.unlock();
+            can_write = can_write && write(response->text);
+            lock.lock();
+        }
+    });
+
+    string line;
+    while (read_line(line)) {
+        if (line.find_first_not_of(" \t\r"sv) == string::npos) {
+            continue;
+        }
+        auto response = make_shared<PendingResponse>();
+        {
+            unique_lock lock(mutex);
+            changed.wait(lock, [&] {
+                return pending.size() < kPipelineDepth;
+            });
+            pending.push_back(response);
+        }
+        pool_.Submit([this, response, request = move(line), &mutex, &changed] {
+            string text = HandleLine(request);
+            // Уведомление под мьютексом: после вывода последнего ответа соединение завершается и сигнал разрушается
+            lock_guard guard(mutex);
+            response->text = move(text);
+            response->is_ready = true;
+            changed.notify_all();
+        });
+    }
+
+    {
+        lock_guard guard(mutex);
+        is_input_finished = true;
+        changed.notify_all();
+    }
+    writer.join();
+}
+
+// Выполняет запрос из строки и возвращает строку ответа
+string Server::HandleLine(string_view line) const {
+    ostringstream out;
+    try {
+        const json::arena::Document document = json::arena::Load(line);
+        const request_handler::StatRequest stat_request = json_reader::ParseStatRequest(document.GetRoot().AsMap());
+        json_reader::PrintStatResponse(out, rh_.ApplyStatRequest(stat_request, mr_));
+    } catch (const exception&) {
+        out.str({});
+        json::Writer(out).StartDict().Key("error_message"sv).Value("invalid request"sv).EndDict();
+    }
+    return move(out).str();
+}
+
+} // namespace server
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "map_renderer.h"
+#include "request_handler.h"
+#include "worker_pool.h"
+
+namespace server {
+
+/*
+ * Сервер запросов статистики в формате JSON Lines: каждая строка входа - один запрос статистики
+ * (как элемент stat_requests), каждая строка выхода - ответ на него.
+ * Запросы соединения выполняются пулом потоков обработчика параллельно, а ответы выводятся в порядке запросов,
+ * поэтому клиент может отправлять следующие запросы, не дожидаясь ответов на предыдущие.
+ * Запросы отвечаются по опубликованной версии каталога
+ */
+class Server {
+public:
+    Server(const request_handler::RequestHandler& rh, const map_renderer::MapRenderer& mr);
+
+    // Закрывает открытые соединения на Unix-сокете и дожидается завершения их потоков
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Обслуживает запросы из потока ввода до его конца, выводя ответы в поток вывода
+    void Serve(std::istream& input, std::ostream& output);
+
+    /* Принимает соединения на Unix-сокете по пути path и обслуживает каждое в отдельном потоке.
+       Одновременно обслуживается ограниченное число соединений, остальные ждут в очереди сокета.
+       Возвращает управление только при ошибке сокета (выбрасывает std::system_error) */
+    void ServeUnixSocket(const std::string& path);
+
+private:
+    // Соединение на Unix-сокете, обслуживаемое отдельным потоком
+    struct Connection {
+        int fd = -1; // < дескриптор сокета соединения (-1 после закрытия)
+        std::thread thread; // < поток, обслуживающий соединение
+        bool is_finished = false; // < флаг завершения обслуживания
+    };
+
+    // Дожидается завершения потоков обслуженных соединений и удаляет их (вызывается под connections_mutex_)
+    void ReapConnections();
+
+    /* Обслуживает одно соединение: read_line читает очередную строку (false - конец ввода),
+       write выводит строку ответа (false - вывод невозможен, остальные ответы отбрасываются) */
+    void ServeConnection(const std::function<bool(std::string&)>& read_line, const std::function<bool(std::string_view)>& write);
+
+    // Выполняет запрос из строки и возвращает строку ответа
+    std::string HandleLine(std::string_view line) const;
+
+    const request_handler::RequestHandler& rh_;
+    const map_renderer::MapRenderer& mr_;
+    worker_pool::WorkerPool& pool_; // < пул потоков обработчика, общий для запросов всех соединений
+
+    std::mutex connections_mutex_; // < мьютекс, защищающий список соединений
+    std::condition_variable connection_finished_; // < сигнал о завершении обслуживания соединения
+    std::list<Connection> connections_; // < соединения на Unix-сокете, потоки которых еще не присоединены
+};
+
+} // namespace server
@@ -0,0 +1,294 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace spatial_index {
+
+namespace {
+
+constexpr double kEarthRadius = 6371000; // < радиус Земли в метрах (тот же, что в geo::ComputeDistance)
+constexpr double kDegree = M_PI / 180.0; // < градус в радианах
+
+constexpr double kRoundingSlack = 1; // < запас в метрах на погрешность округления при сравнении оценки с точным расстоянием
+
+double GetAxis(double lat, double lng, int axis) {
+    return axis == 0 ? lat : lng;
+}
+
+} // namespace
+
+/*
+ * Состояние поиска ближайших остановок.
+ * Нижняя оценка расстояния берется в равнопромежуточной проекции, где долгота сжата косинусом широты,
+ * ближайшей к полюсу в ограничивающем прямоугольнике круга поиска. Кратчайшая дуга от точки запроса
+ * до остановки внутри круга не выходит из круга, а на ней метр по долготе не короче этого косинуса,
+ * поэтому оценка не превышает точного расстояния и по ней можно отбрасывать остановки и поддеревья
+ */
+struct StopIndex::NearbySearch {
+    geo::Coordinates point; // < точка запроса
+    geo::PreparedCoordinates prepared_point; // < точка запроса, подготовленная для точного расчета
+    double lng_scale; // < косинус широты, ближайшей к полюсу в прямоугольнике поиска
+    double lng_shift; // < сдвиг долгот обходимого прямоугольника, убирающий переход через 180-й меридиан
+    double radius; // < радиус поиска в метрах
+    size_t count; // < наибольшее число остановок в ответе
+    NearbyStops heap; // < найденные остановки - куча с самой дальней наверху
+
+    // Нижняя оценка расстояния в метрах по отступам в градусах по широте и долготе
+    double GetLowerBound(double lat_delta, double lng_delta) const {
+        const double x = lng_delta * lng_scale;
+        return sqrt(x * x + lat_delta * lat_delta) * kDegree * kEarthRadius;
+    }
+
+    // Нижняя оценка расстояния до прямоугольника в координатах обходимого прямоугольника
+    double GetLowerBound(const Box& box) const {
+        const double lat_delta = max({0.0, box.min.lat - point.lat, point.lat - box.max.lat});
+        const double lng_delta = max({0.0, box.min.lng + lng_shift - point.lng, point.lng - box.max.lng - lng_shift});
+        return GetLowerBound(lat_delta, lng_delta);
+    }
+
+    // Расстояние, дальше которого остановки уже не попадут в ответ
+    double GetWorstDistance() const {
+        return heap.size() < count ? radius : heap.front().distance;
+    }
+};
+
+StopIndex::StopIndex(const transport_catalogue::TransportCatalogue& catalogue)
+    : catalogue_(catalogue) {
+    Build();
+}
+
+/* Создает индекс по новой версии каталога, разделяя дерево с индексом previous ее предыдущей версии.
+   Остановки changed_stops (добавленные или перемещенные) перебираются вне дерева, а их прежние точки в дереве пропускаются */
+StopIndex::StopIndex(const transport_catalogue::TransportCatalogue& catalogue, const StopIndex& previous, span<const domain::StopId> changed_stops)
+    : catalogue_(catalogue)
+    , points_(previous.points_)
+    , added_points_(previous.added_points_) {
+    for (domain::StopId id : changed_stops) {
+        const domain::Stop* stop = catalogue.GetStop(id);
+        if (!stop->is_declared) {
+            continue;
+        }
+        const Point point{stop->coords.lat, stop->coords.lng, id};
+        const auto it = lower_bound(added_points_.begin(), added_points_.end(), id, [](const Point& lhs, domain::StopId rhs) {
+            return lhs.id < rhs;
+        });
+        if (it != added_points_.end() && it->id == id) {
+            *it = point;
+        } else {
+            added_points_.insert(it, point);
+        }
+    }
+    if (added_points_.size() > kMaxAddedPoints) {
+        Build();
+    }
+}
+
+// Строит дерево по всем описанным остановкам каталога
+void StopIndex::Build() {
+    vector<Point> points;
+    points.reserve(catalogue_.GetStopCount());
+    for (domain::StopId id = 0; id < catalogue_.GetStopCount(); ++id) {
+        // Остановка, которая пока только упоминается, не имеет координат
+        const domain::Stop* stop = catalogue_.GetStop(id);
+        if (stop->is_declared) {
+            points.push_back({stop->coords.lat, stop->coords.lng, id});
+        }
+    }
+    Build(points, 0, points.size(), 0);
+    points_ = make_shared<const vector<Point>>(move(points));
+    added_points_.clear();
+}
+
+// Строит поддерево на диапазоне точек [begin, end), разделяя его по оси axis (0 - широта, 1 - долгота)
+void StopIndex::Build(vector<Point>& points, size_t begin, size_t end, int axis) {
+    if (end - begin <= 1) {
+        return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    nth_element(points.begin() + begin, points.begin() + middle, points.begin() + end, [axis](const Point& lhs, const Point& rhs) {
+        return GetAxis(lhs.lat, lhs.lng, axis) < GetAxis(rhs.lat, rhs.lng, axis);
+    });
+    Build(points, begin, middle, 1 - axis);
+    Build(points, middle + 1, end, 1 - axis);
+}
+
+// Проверяет, что точка дерева устарела: остановка перемещена после его построения
+bool StopIndex::IsReplaced(domain::StopId id) const {
+    return !added_points_.empty() && binary_search(added_points_.begin(), added_points_.end(), Point{0, 0, id}, [](const Point& lhs, const Point& rhs) {
+        return lhs.id < rhs.id;
+    });
+}
+
+// Передает обработчику номера остановок поддерева [begin, end), лежащие в прямоугольнике
+template <typename Visitor>
+void StopIndex::VisitBox(size_t begin, size_t end, int axis, const Box& box, Visitor& visitor) const {
+    const vector<Point>& points = *points_;
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const Point& point = points[middle];
+        if (box.Contains(point) && !IsReplaced(point.id)) {
+            visitor(point.id);
+        }
+
+        // Левое поддерево обходится рекурсивно, правое - в цикле
+        const double value = GetAxis(point.lat, point.lng, axis);
+        if (GetAxis(box.min.lat, box.min.lng, axis) <= value) {
+            VisitBox(begin, middle, 1 - axis, box, visitor);
+        }
+        if (GetAxis(box.max.lat, box.max.lng, axis) < value) {
+            return;
+        }
+        begin = middle + 1;
+        axis = 1 - axis;
+    }
+}
+
+// Передает обработчику номера остановок в прямоугольнике с учетом пересечения 180-го меридиана
+template <typename Visitor>
+void StopIndex::VisitBox(geo::Coordinates min, geo::Coordinates max, Visitor& visitor) const {
+    const auto visit = [&](const Box& box) {
+        VisitBox(0, points_->size(), 0, box, visitor);
+        for (const Point& point : added_points_) {
+            if (box.Contains(point)) {
+                visitor(point.id);
+            }
+        }
+    };
+    if (min.lng <= max.lng) {
+        visit(Box{min, max});
+    } else {
+        visit(Box{min, {max.lat, 180}});
+        visit(Box{{min.lat, -180}, max});
+    }
+}
+
+// Сравнивает найденные остановки: ближние первыми, при равном расстоянии - по имени
+bool IsCloser(const StopDistance& lhs, const StopDistance& rhs) {
+    return lhs.distance != rhs.distance ? lhs.distance < rhs.distance : lhs.stop->name < rhs.stop->name;
+}
+
+/* Обходит поддерево [begin, end), точки которого лежат в прямоугольнике region, и добавляет в кучу остановки из круга поиска.
+   Сначала обходится половина, в которой лежит точка запроса, а поддеревья, нижняя оценка расстояния до которых
+   больше расстояния до самой дальней из уже найденных остановок, пропускаются */
+void StopIndex::VisitNearby(size_t begin, size_t end, int axis, const Box& region, NearbySearch& search) const {
+    if (begin >= end || region.min.lat > region.max.lat || region.min.lng > region.max.lng
+        || search.GetLowerBound(region) > search.GetWorstDistance() + kRoundingSlack) {
+        return;
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    const Point& point = (*points_)[middle];
+    if (region.Contains(point) && !IsReplaced(point.id)) {
+        VisitNearby(point, search);
+    }
+
+    // Левая половина содержит значения не больше разделяющего, правая - не меньше
+    Box lower = region;
+    Box upper = region;
+    if (axis == 0) {
+        lower.max.lat = min(region.max.lat, point.lat);
+        upper.min.lat = max(region.min.lat, point.lat);
+    } else {
+        lower.max.lng = min(region.max.lng, point.lng);
+        upper.min.lng = max(region.min.lng, point.lng);
+    }
+    const double value = GetAxis(point.lat, point.lng + search.lng_shift, axis);
+    if (GetAxis(search.point.lat, search.point.lng, axis) < value) {
+        VisitNearby(begin, middle, 1 - axis, lower, search);
+        VisitNearby(middle + 1, end, 1 - axis, upper, search);
+    } else {
+        VisitNearby(middle + 1, end, 1 - axis, upper, search);
+        VisitNearby(begin, middle, 1 - axis, lower, search);
+    }
+}
+
+// Добавляет остановку в поиск ближайших, если она может оказаться среди них
+void StopIndex::VisitNearby(const Point& point, NearbySearch& search) const {
+    const double lower_bound = search.GetLowerBound(abs(point.lat - search.point.lat), abs(point.lng + search.lng_shift - search.point.lng));
+    if (lower_bound > search.GetWorstDistance() + kRoundingSlack) {
+        return;
+    }
+    double distance = geo::ComputeDistance(search.prepared_point, catalogue_.GetPreparedCoordinates(point.id));
+    if (isnan(distance)) {
+        distance = 0; // acos от значения, чуть большего 1 из-за округления, для совпадающих точек
+    }
+    const StopDistance candidate{catalogue_.GetStop(point.id), distance};
+    if (distance <= search.radius && (search.heap.size() < search.count || IsCloser(candidate, search.heap.front()))) {
+        if (search.heap.size() == search.count) {
+            pop_heap(search.heap.begin(), search.heap.end(), IsCloser);
+            search.heap.pop_back();
+        }
+        search.heap.push_back(candidate);
+        push_heap(search.heap.begin(), search.heap.end(), IsCloser);
+    }
+}
+
+/* Возвращает не более count остановок на расстоянии не больше radius метров от точки, ближайшие первыми.
+   Остановки и поддеревья сначала отсеиваются по нижней оценке расстояния в равнопромежуточной проекции
+   (в том числе по расстоянию до самой дальней из уже найденных count остановок),
+   и только оставшиеся остановки проверяются точным расчетом расстояния */
+NearbyStops StopIndex::FindNearby(geo::Coordinates point, double radius, size_t count) const {
+    if (count == 0 || radius < 0) {
+        return {};
+    }
+
+    // Ограничивающий прямоугольник круга: по широте - угловой радиус, по долготе - с учетом сближения меридианов
+    const double angular_radius = radius / kEarthRadius;
+    const double lat_delta = angular_radius / kDegree;
+    geo::Coordinates min{point.lat - lat_delta, -180};
+    geo::Coordinates max{point.lat + lat_delta, 180};
+    if (min.lat > -90 && max.lat < 90 && angular_radius < M_PI / 2) {
+        const double lng_delta = asin(sin(angular_radius) / cos(point.lat * kDegree)) / kDegree;
+        if (lng_delta < 180) {
+            min.lng = point.lng - lng_delta;
+            max.lng = point.lng + lng_delta;
+            if (min.lng < -180) {
+                min.lng += 360;
+            }
+            if (max.lng > 180) {
+                max.lng -= 360;
+            }
+        }
+    }
+
+    // У прямоугольника, касающегося полюса, долгота не дает оценки расстояния
+    const double pole_lat = std::min(90.0, std::max(abs(min.lat), abs(max.lat)));
+    NearbySearch search{point, geo::Prepare(point), std::max(0.0, cos(pole_lat * kDegree)), 0, radius, count, {}};
+    const auto visit = [&](const Box& box) {
+        // Долготы прямоугольника по другую сторону 180-го меридиана сдвигаются к точке запроса
+        search.lng_shift = box.min.lng > point.lng + 180 ? -360 : box.max.lng < point.lng - 180 ? 360 : 0;
+        VisitNearby(0, points_->size(), 0, box, search);
+        for (const Point& added_point : added_points_) {
+            if (box.Contains(added_point)) {
+                VisitNearby(added_point, search);
+            }
+        }
+    };
+    if (min.lng <= max.lng) {
+        visit(Box{min, max});
+    } else {
+        visit(Box{min, {max.lat, 180}});
+        visit(Box{{min.lat, -180}, max});
+    }
+
+    sort_heap(search.heap.begin(), search.heap.end(), IsCloser);
+    return move(search.heap);
+}
+
+/* Возвращает остановки в прямоугольнике между углами min и max (включительно).
+   Если min.lng > max.lng, прямоугольник пересекает 180-й меридиан */
+StopsInBox StopIndex::FindInBox(geo::Coordinates min, geo::Coordinates max) const {
+    StopsInBox result;
+    auto visitor = [&](domain::StopId id) {
+        result.push_back(catalogue_.GetStop(id));
+    };
+    VisitBox(min, max, visitor);
+    sort(result.begin(), result.end(), domain::StopPointerComparator{});
+    return result;
+}
+
+} // namespace spatial_index
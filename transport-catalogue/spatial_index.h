@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "domain.h"
+#include "geo.h"
+#include "transport_catalogue.h"
+
+namespace spatial_index {
+
+struct StopDistance {
+    const domain::Stop* stop; // < остановка
+    double distance; // < расстояние до точки запроса в метрах
+};
+
+using NearbyStops = std::vector<StopDistance>; // < ближайшие остановки в порядке возрастания расстояния
+using StopsInBox = std::vector<const domain::Stop*>; // < остановки в прямоугольнике в порядке возрастания имени
+
+/*
+ * Пространственный индекс остановок - k-d дерево по широте и долготе.
+ * Дерево хранится неявно в одном массиве точек: медиана диапазона лежит в его середине,
+ * а левая и правая половины - поддеревья, разделенные поочередно по широте и долготе.
+ * Индекс строится по описанным остановкам каталога и после этого только читается. Индекс следующей версии
+ * каталога разделяет дерево с предыдущим, а добавленные и перемещенные остановки перебирает отдельно
+ */
+class StopIndex {
+public:
+    explicit StopIndex(const transport_catalogue::TransportCatalogue& catalogue);
+
+    /* Создает индекс по новой версии каталога, разделяя дерево с индексом previous ее предыдущей версии.
+       Остановки changed_stops (добавленные или перемещенные) перебираются вне дерева, а их прежние точки в дереве пропускаются.
+       Когда таких остановок становится больше kMaxAddedPoints, дерево перестраивается целиком */
+    StopIndex(const transport_catalogue::TransportCatalogue& catalogue, const StopIndex& previous, std::span<const domain::StopId> changed_stops);
+
+    /* Возвращает не более count остановок на расстоянии не больше radius метров от точки, ближайшие первыми.
+       Остановки и поддеревья сначала отсеиваются по нижней оценке расстояния в равнопромежуточной проекции
+       (в том числе по расстоянию до самой дальней из уже найденных count остановок),
+       и только оставшиеся остановки проверяются точным расчетом расстояния */
+    NearbyStops FindNearby(geo::Coordinates point, double radius, size_t count) const;
+
+    /* Возвращает остановки в прямоугольнике между углами min и max (включительно).
+       Если min.lng > max.lng, прямоугольник пересекает 180-й меридиан */
+    StopsInBox FindInBox(geo::Coordinates min, geo::Coordinates max) const;
+
+    static constexpr size_t kMaxAddedPoints = 256; // < наибольшее число остановок вне дерева, после которого оно перестраивается
+
+private:
+    struct Point {
+        double lat; // < широта остановки
+        double lng; // < долгота остановки
+        domain::StopId id; // < номер остановки
+    };
+
+    // Прямоугольник в координатах широты и долготы, не пересекающий 180-й меридиан
+    struct Box {
+        geo::Coordinates min; // < угол с наименьшими широтой и долготой
+        geo::Coordinates max; // < угол с наибольшими широтой и долготой
+
+        // Проверяет, что точка лежит в прямоугольнике (включая границу)
+        bool Contains(const Point& point) const {
+            return point.lat >= min.lat && point.lat <= max.lat && point.lng >= min.lng && point.lng <= max.lng;
+        }
+    };
+
+    // Строит дерево по всем описанным остановкам каталога
+    void Build();
+
+    // Строит поддерево на диапазоне точек [begin, end), разделяя его по оси axis (0 - широта, 1 - долгота)
+    static void Build(std::vector<Point>& points, size_t begin, size_t end, int axis);
+
+    // Проверяет, что точка дерева устарела: остановка перемещена после его построения
+    bool IsReplaced(domain::StopId id) const;
+
+    // Передает обработчику номера остановок поддерева [begin, end), лежащие в прямоугольнике
+    template <typename Visitor>
+    void VisitBox(size_t begin, size_t end, int axis, const Box& box, Visitor& visitor) const;
+
+    // Передает обработчику номера остановок в прямоугольнике с учетом пересечения 180-го меридиана
+    template <typename Visitor>
+    void VisitBox(geo::Coordinates min, geo::Coordinates max, Visitor& visitor) const;
+
+    struct NearbySearch;
+
+    // Добавляет в поиск ближайших остановок остановки поддерева [begin, end), лежащие в прямоугольнике region
+    void VisitNearby(size_t begin, size_t end, int axis, const Box& region, NearbySearch& search) const;
+
+    // Добавляет остановку в поиск ближайших, если она может оказаться среди них
+    void VisitNearby(const Point& point, NearbySearch& search) const;
+
+    const transport_catalogue::TransportCatalogue& catalogue_; // < каталог, по которому построен индекс
+    std::shared_ptr<const std::vector<Point>> points_; // < точки неявного k-d дерева (разделяются с индексами следующих версий)
+    std::vector<Point> added_points_; // < остановки, добавленные или перемещенные после построения дерева, по возрастанию номера
+};
+
+} // namespace spatial_index
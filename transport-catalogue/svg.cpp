@@ -1,3 +1,4 @@
+#include <array>
 #include <utility>
 
 #include "svg.h"
@@ -6,50 +7,167 @@ namespace svg {
 
 using namespace std::literals;
 
-std::ostream& operator<< (std::ostream& out, Rgb color) {
+namespace {
+
+// Ссылки XML для экранируемых символов текста (пустая строка - символ выводится как есть)
+constexpr std::array<std::string_view, 256> MakeEscapeTable() {
+    std::array<std::string_view, 256> table{};
+    table[static_cast<unsigned char>('"')] = "&quot;"sv;
+    table[static_cast<unsigned char>('\'')] = "&apos;"sv;
+    table[static_cast<unsigned char>('<')] = "&lt;"sv;
+    table[static_cast<unsigned char>('>')] = "&gt;"sv;
+    table[static_cast<unsigned char>('&')] = "&amp;"sv;
+    return table;
+}
+
+constexpr std::array<std::string_view, 256> kEscapeTable = MakeEscapeTable();
+
+// Выводит значение в поток через буфер, сохраняя точность потока
+template <typename Value>
+std::ostream& PrintToStream(std::ostream& out, const Value& value) {
+    OutputBuffer buffer(static_cast<int>(out.precision()));
+    buffer << value;
+    const std::string_view text = buffer.View();
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return out;
+}
+
+// Выводит тег круга без отступа и перевода строки
+void RenderCircleTag(OutputBuffer& out, Point center, double radius, const PathStyle& style) {
+    out << "<circle cx=\""sv << center.x << "\" cy=\""sv << center.y << "\" "sv;
+    out << "r=\""sv << radius << "\" "sv;
+    RenderPathStyle(out, style);
+    out << "/>"sv;
+}
+
+// Выводит тег ломаной без отступа и перевода строки
+void RenderPolylineTag(OutputBuffer& out, const Point* points, size_t count, const PathStyle& style) {
+    out << "<polyline points=\""sv;
+    for (size_t i = 0; i < count; ++i) {
+        if (i != 0) {
+            out << " "sv;
+        }
+        out << points[i].x << ","sv << points[i].y;
+    }
+    out << "\" "sv;
+    RenderPathStyle(out, style);
+    out << "/>"sv;
+}
+
+// Выводит тег текста без отступа и перевода строки (пустые шрифт и толщина не выводятся)
+void RenderTextTag(OutputBuffer& out, Point position, Point offset, uint32_t font_size,
+                   std::string_view font_family, std::string_view font_weight, std::string_view data,
+                   const PathStyle& style) {
+    out << "<text x=\""sv << position.x << "\" y=\""sv << position.y << "\" "sv;
+    out << "dx=\""sv << offset.x << "\" dy=\""sv << offset.y << "\" "sv;
+    out << "font-size=\""sv << font_size << "\" "sv;
+    if (!font_family.empty()) {
+        out << "font-family=\""sv << font_family << "\" "sv;
+    }
+    if (!font_weight.empty()) {
+        out << "font-weight=\""sv << font_weight << "\" "sv;
+    }
+    RenderPathStyle(out, style);
+    out << ">"sv;
+    out.AppendEscaped(data);
+    out << "</text>"sv;
+}
+
+} // namespace
+
+// ---------- OutputBuffer ------------------
+
+OutputBuffer& OutputBuffer::operator<< (double value) {
+    // Общий формат to_chars с точностью совпадает с %g, которым поток выводит числа по умолчанию
+    char buffer[64];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, precision_);
+    data_.append(buffer, result.ptr);
+    return *this;
+}
+
+void OutputBuffer::AppendEscaped(std::string_view text) {
+    // Участки без экранируемых символов копируются целиком
+    size_t begin = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const std::string_view escaped = kEscapeTable[static_cast<unsigned char>(text[i])];
+        if (!escaped.empty()) {
+            data_.append(text, begin, i - begin);
+            data_.append(escaped);
+            begin = i + 1;
+        }
+    }
+    data_.append(text, begin, std::string_view::npos);
+}
+
+// ---------- Colors and line styles ------------------
+
+OutputBuffer& operator<< (OutputBuffer& out, Rgb color) {
     out << "rgb("sv << static_cast<int>(color.red) << ","sv << static_cast<int>(color.green) << ","sv << static_cast<int>(color.blue) << ")"sv;
     return out;
 }
 
-std::ostream& operator<< (std::ostream& out, Rgba color) {
+OutputBuffer& operator<< (OutputBuffer& out, Rgba color) {
     out << "rgba("sv << static_cast<int>(color.red) << ","sv << static_cast<int>(color.green) << ","sv << static_cast<int>(color.blue) << ","sv << color.opacity << ")"sv;
     return out;
 }
 
+std::ostream& operator<< (std::ostream& out, Rgb color) {
+    return PrintToStream(out, color);
+}
+
+std::ostream& operator<< (std::ostream& out, Rgba color) {
+    return PrintToStream(out, color);
+}
+
 std::ostream& operator<< (std::ostream& out, Color color) {
-    std::visit(ColorPrinter(out), color);
+    OutputBuffer buffer(static_cast<int>(out.precision()));
+    std::visit(ColorPrinter{buffer}, color);
+    const std::string_view text = buffer.View();
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
     return out;
 }
 
-std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap) {
-    static const std::unordered_map<StrokeLineCap, std::string_view> line_cap_map = {
-        {StrokeLineCap::BUTT, "butt"},
-        {StrokeLineCap::ROUND, "round"},
-        {StrokeLineCap::SQUARE, "square"},
-    };
+OutputBuffer& operator<<(OutputBuffer& out, const StrokeLineCap line_cap) {
+    switch (line_cap) {
+    case StrokeLineCap::BUTT:
+        return out << "butt"sv;
+    case StrokeLineCap::ROUND:
+        return out << "round"sv;
+    case StrokeLineCap::SQUARE:
+        return out << "square"sv;
+    }
+    return out;
+}
 
-    out << line_cap_map.at(line_cap);
+OutputBuffer& operator<<(OutputBuffer& out, const StrokeLineJoin line_join) {
+    switch (line_join) {
+    case StrokeLineJoin::ARCS:
+        return out << "arcs"sv;
+    case StrokeLineJoin::BEVEL:
+        return out << "bevel"sv;
+    case StrokeLineJoin::MITER:
+        return out << "miter"sv;
+    case StrokeLineJoin::MITER_CLIP:
+        return out << "miter-clip"sv;
+    case StrokeLineJoin::ROUND:
+        return out << "round"sv;
+    }
     return out;
 }
 
+std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap) {
+    return PrintToStream(out, line_cap);
+}
+
 std::ostream& operator<<(std::ostream& out, const StrokeLineJoin line_join) {
-    static const std::unordered_map<StrokeLineJoin, std::string_view> line_join_map = {
-        {StrokeLineJoin::ARCS, "arcs"},
-        {StrokeLineJoin::BEVEL, "bevel"},
-        {StrokeLineJoin::MITER, "miter"},
-        {StrokeLineJoin::MITER_CLIP, "miter-clip"},
-        {StrokeLineJoin::ROUND, "round"}
-    };
-
-    out << line_join_map.at(line_join);
-    return out;
+    return PrintToStream(out, line_join);
 }
 
 void ColorPrinter::operator() (std::monostate) const {
     out << "none"sv;
 }
 
-void ColorPrinter::operator() (std::string color) const {
+void ColorPrinter::operator() (const std::string& color) const {
     out << color;
 }
 
@@ -61,13 +179,35 @@ void ColorPrinter::operator() (Rgba color) const {
     out << color;
 }
 
+void RenderPathStyle(OutputBuffer& out, const PathStyle& style) {
+    if (style.fill_color) {
+        out << "fill=\""sv;
+        std::visit(ColorPrinter{out}, *style.fill_color);
+        out << "\" "sv;
+    }
+    if (style.stroke_color) {
+        out << "stroke=\""sv;
+        std::visit(ColorPrinter{out}, *style.stroke_color);
+        out << "\" "sv;
+    }
+    if (style.width) {
+        out << "stroke-width=\""sv << *style.width << "\" "sv;
+    }
+    if (style.line_cap) {
+        out << "stroke-linecap=\""sv << *style.line_cap << "\" "sv;
+    }
+    if (style.line_join) {
+        out << "stroke-linejoin=\""sv << *style.line_join << "\" "sv;
+    }
+}
+
 void Object::Render(const RenderContext& context) const {
     context.RenderIndent();
 
     // Делегируем вывод тега своим подклассам
     RenderObject(context);
 
-    context.out << std::endl;
+    context.out << '\n';
 }
 
 // ---------- Circle ------------------
@@ -83,11 +223,7 @@ Circle& Circle::SetRadius(double radius)  {
 }
 
 void Circle::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-    out << "r=\""sv << radius_ << "\" "sv;
-    RenderAttrs(context.out);
-    out << "/>"sv;
+    RenderCircleTag(context.out, center_, radius_, GetStyle());
 }
 
 // -------- PolyLine ---------------
@@ -98,19 +234,7 @@ Polyline& Polyline::AddPoint(Point point) {
 }
 
 void Polyline::RenderObject(const RenderContext& context) const {
-    auto& out = context.out;
-    out << "<polyline points=\""sv;
-    bool is_first_point = true;
-    for (Point point : points_) {
-        if (!is_first_point) {
-            out << " "sv;
-        }
-        out << point.x << ","sv << point.y;
-        is_first_point = false;
-    }
-    out << "\" "sv;
-    RenderAttrs(context.out);
-    out << "/>"sv;
+    RenderPolylineTag(context.out, points_.data(), points_.size(), GetStyle());
 }
 
 // -------- Text -----------------
@@ -146,46 +270,134 @@ Text& Text::SetData(std::string data) {
 }
 
 void Text::RenderObject(const RenderContext& context) const {
-    static const std::unordered_map<char, std::string_view> chars_map = {
-        {'\"', "&quot;"},
-        {'\'', "&apos;"},
-        {'<', "&lt;"},
-        {'>', "&gt;"},
-        {'&', "&amp;"}
-    };
-
-    auto& out = context.out;
-    out << "<text x=\""sv << position_.x << "\" y=\""sv << position_.y << "\" "sv;
-    out << "dx=\""sv << offset_.x << "\" dy=\""sv << offset_.y << "\" "sv;
-    out << "font-size=\""sv << font_size_ << "\" "sv;
-    if (!font_family_.empty()) {
-        out << "font-family=\""sv << font_family_ << "\" "sv;
-    }
-    if (!font_weight_.empty()) {
-        out << "font-weight=\""sv << font_weight_ << "\" "sv;
-    }
-    RenderAttrs(context.out);
-    out << ">"sv;
-    for (char c : data_) {
-        auto it = chars_map.find(c);
-        if (it != chars_map.end()) {
-            out << it->second;
-        } else {
-            out << c;
+    RenderTextTag(context.out, position_, offset_, font_size_, font_family_, font_weight_, data_, GetStyle());
+}
+
+// ------------- Document -------------
+
+void Document::Add(const Circle& circle) {
+    AddCircle(circle.center_, circle.radius_, AddStyle(circle.GetStyle()));
+}
+
+void Document::Add(const Polyline& polyline) {
+    AddPolyline(polyline.points_.data(), polyline.points_.size(), AddStyle(polyline.GetStyle()));
+}
+
+void Document::Add(const Text& text) {
+    TextElement element;
+    element.position = text.position_;
+    element.offset = text.offset_;
+    element.font_size = text.font_size_;
+    element.font_family = AddString(text.font_family_);
+    element.font_weight = AddString(text.font_weight_);
+    element.data = AddString(text.data_);
+    element.style = AddStyle(text.GetStyle());
+    AddText(element);
+}
+
+void Document::AddPtr(std::unique_ptr<Object>&& object) {
+    elements_.push_back(CustomElement{objects_.size()});
+    objects_.push_back(std::move(object));
+}
+
+StyleId Document::AddStyle(const PathStyle& style) {
+    // Различных стилей в документе единицы (цвета палитры), поэтому достаточно линейного поиска
+    for (size_t i = styles_.size(); i > 0; --i) {
+        if (styles_[i - 1] == style) {
+            return static_cast<StyleId>(i - 1);
         }
     }
-    out << "</text>"sv;
+    styles_.push_back(style);
+    return static_cast<StyleId>(styles_.size() - 1);
 }
 
-// ------------- Document -------------
+StringRef Document::AddString(std::string_view text) {
+    StringRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(text.size())};
+    strings_.append(text);
+    return ref;
+}
+
+void Document::AddCircle(Point center, double radius, StyleId style) {
+    elements_.push_back(CircleElement{center, radius, style});
+}
+
+void Document::AddPolyline(const Point* points, size_t count, StyleId style) {
+    elements_.push_back(PolylineElement{points_.size(), count, style});
+    points_.insert(points_.end(), points, points + count);
+}
+
+void Document::AddText(const TextElement& text) {
+    elements_.push_back(text);
+}
+
+void Document::Reserve(size_t element_count, size_t point_count) {
+    elements_.reserve(element_count);
+    points_.reserve(point_count);
+}
+
+void Document::SetViewBox(Point min, double width, double height) {
+    view_box_ = ViewBox{min, width, height};
+}
+
+std::string_view Document::GetString(StringRef ref) const {
+    return std::string_view(strings_).substr(ref.offset, ref.size);
+}
+
+void Document::RenderElement(const RenderContext& context, const Element& element) const {
+    OutputBuffer& out = context.out;
+    if (const auto* custom = std::get_if<CustomElement>(&element)) {
+        objects_[custom->index]->Render(context);
+        return;
+    }
+
+    context.RenderIndent();
+    if (const auto* circle = std::get_if<CircleElement>(&element)) {
+        RenderCircleTag(out, circle->center, circle->radius, styles_[circle->style]);
+    } else if (const auto* polyline = std::get_if<PolylineElement>(&element)) {
+        RenderPolylineTag(out, points_.data() + polyline->first_point, polyline->point_count, styles_[polyline->style]);
+    } else {
+        const auto& text = std::get<TextElement>(element);
+        RenderTextTag(out, text.position, text.offset, text.font_size,
+                      GetString(text.font_family), GetString(text.font_weight), GetString(text.data),
+                      styles_[text.style]);
+    }
+    out << '\n';
+}
 
 void Document::Render(std::ostream& out) const {
+    OutputBuffer buffer(static_cast<int>(out.precision()));
+    Render(buffer);
+    const std::string_view text = buffer.View();
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void Document::Render(OutputBuffer& out) const {
+    // Типичный элемент карты занимает около сотни байт
+    out.Reserve(out.View().size() + 128 * elements_.size() + 16 * points_.size() + 128);
+    RenderHeader(out);
+    RenderElements(out);
+    RenderFooter(out);
+}
+
+void Document::RenderHeader(OutputBuffer& out) const {
     out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
-    for (const auto& object : objects_) {
-        object->Render({out, 1, 2});
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\""sv;
+    if (view_box_) {
+        out << " viewBox=\""sv << view_box_->min.x << " "sv << view_box_->min.y << " "sv
+            << view_box_->width << " "sv << view_box_->height << "\""sv;
+    }
+    out << ">\n"sv;
+}
+
+void Document::RenderElements(OutputBuffer& out) const {
+    const RenderContext context{out, 1, 2};
+    for (const Element& element : elements_) {
+        RenderElement(context, element);
     }
-    out << "</svg>";
+}
+
+void Document::RenderFooter(OutputBuffer& out) const {
+    out << "</svg>"sv;
 }
 
 }  // namespace svg
\ No newline at end of file
@@ -1,43 +1,116 @@
 #pragma once
 
+#include <charconv>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
 namespace svg {
 
+/*
+ * Растущий буфер для вывода SVG-разметки.
+ * Числа с плавающей точкой форматируются std::to_chars в общем формате с заданной точностью,
+ * что совпадает с выводом в std::ostream с форматом по умолчанию, но без обращения к локали
+ */
+class OutputBuffer {
+public:
+    // Точность по умолчанию совпадает с точностью потока вывода по умолчанию
+    explicit OutputBuffer(int precision = 6)
+        : precision_(precision) {
+    }
+
+    OutputBuffer& operator<< (std::string_view text) {
+        data_.append(text);
+        return *this;
+    }
+
+    OutputBuffer& operator<< (char c) {
+        data_.push_back(c);
+        return *this;
+    }
+
+    OutputBuffer& operator<< (double value);
+
+    template <typename Integer, std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, char> && !std::is_same_v<Integer, bool>, int> = 0>
+    OutputBuffer& operator<< (Integer value) {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        data_.append(buffer, result.ptr);
+        return *this;
+    }
+
+    // Выводит текст, заменяя символы " ' < > & на ссылки XML
+    void AppendEscaped(std::string_view text);
+
+    // Добавляет count пробелов
+    void AppendSpaces(size_t count) {
+        data_.append(count, ' ');
+    }
+
+    // Резервирует место под size байт разметки
+    void Reserve(size_t size) {
+        data_.reserve(size);
+    }
+
+    // Возвращает число значащих цифр чисел с плавающей точкой
+    int GetPrecision() const {
+        return precision_;
+    }
+
+    // Возвращает накопленную разметку
+    std::string_view View() const {
+        return data_;
+    }
+
+    // Возвращает накопленную разметку, освобождая буфер
+    std::string Extract() {
+        return std::move(data_);
+    }
+
+private:
+    std::string data_; // < накопленная разметка
+    int precision_; // < число значащих цифр чисел с плавающей точкой
+};
+
 struct Rgb {
     uint8_t red = 0;
     uint8_t green = 0;
     uint8_t blue = 0;
+
+    bool operator== (const Rgb& other) const = default;
 };
 
 std::ostream& operator<< (std::ostream& out, Rgb color);
+OutputBuffer& operator<< (OutputBuffer& out, Rgb color);
 
 struct Rgba {
     uint8_t red = 0;
     uint8_t green = 0;
     uint8_t blue = 0;
     double opacity = 1.0;
+
+    bool operator== (const Rgba& other) const = default;
 };
 
 std::ostream& operator<< (std::ostream& out, Rgba color);
+OutputBuffer& operator<< (OutputBuffer& out, Rgba color);
 
 using Color = std::variant<std::monostate, std::string, Rgb, Rgba>;
 inline const Color NoneColor{};
 std::ostream& operator<< (std::ostream& out, Color color);
 
 struct ColorPrinter {
-    std::ostream& out;
+    OutputBuffer& out;
 
     void operator() (std::monostate) const;
 
-    void operator() (std::string color) const;
+    void operator() (const std::string& color) const;
 
     void operator() (Rgb color) const;
 
@@ -51,6 +124,7 @@ enum class StrokeLineCap {
 };
 
 std::ostream& operator<<(std::ostream& out, const StrokeLineCap line_cap);
+OutputBuffer& operator<<(OutputBuffer& out, const StrokeLineCap line_cap);
 
 enum class StrokeLineJoin {
     ARCS,
@@ -61,6 +135,7 @@ enum class StrokeLineJoin {
 };
 
 std::ostream& operator<<(std::ostream& out, const StrokeLineJoin line_join);
+OutputBuffer& operator<<(OutputBuffer& out, const StrokeLineJoin line_join);
 
 struct Point {
     Point() = default;
@@ -72,60 +147,59 @@ struct Point {
     double y = 0;
 };
 
+// Общие для всех путей атрибуты fill и stroke (незаданные атрибуты не выводятся)
+struct PathStyle {
+    std::optional<Color> fill_color;
+    std::optional<Color> stroke_color;
+    std::optional<double> width;
+    std::optional<StrokeLineCap> line_cap;
+    std::optional<StrokeLineJoin> line_join;
+
+    bool operator== (const PathStyle& other) const = default;
+};
+
+// Выводит в буфер заданные атрибуты стиля пути
+void RenderPathStyle(OutputBuffer& out, const PathStyle& style);
+
 template <typename Owner>
 class PathProps {
 public:
     Owner& SetFillColor(Color color) {
-        fill_color_ = std::move(color);
+        style_.fill_color = std::move(color);
         return AsOwner();
     }
 
     Owner& SetStrokeColor(Color color) {
-        stroke_color_ = std::move(color);
+        style_.stroke_color = std::move(color);
         return AsOwner();
     }
 
     Owner& SetStrokeWidth(double width) {
-        width_ = width;
+        style_.width = width;
         return AsOwner();
     }
 
     Owner& SetStrokeLineCap(StrokeLineCap line_cap) {
-        line_cap_ = line_cap;
+        style_.line_cap = line_cap;
         return AsOwner();
     }
 
     Owner& SetStrokeLineJoin(StrokeLineJoin line_join) {
-        line_join_ = line_join;
+        style_.line_join = line_join;
         return AsOwner();
     }
 
+    // Возвращает заданные атрибуты стиля
+    const PathStyle& GetStyle() const {
+        return style_;
+    }
+
 protected:
     ~PathProps() = default;
 
-    // Метод RenderAttrs выводит в поток общие для всех путей атрибуты fill и stroke
-    void RenderAttrs(std::ostream& out) const {
-        using namespace std::literals;
-
-        if (fill_color_) {
-            out << "fill=\""sv;
-            std::visit(ColorPrinter(out), *fill_color_);
-            out << "\" "sv;
-        }
-        if (stroke_color_) {
-            out << "stroke=\""sv;
-            std::visit(ColorPrinter(out), *stroke_color_);
-            out << "\" "sv;
-        }
-        if (width_) {
-            out << "stroke-width=\""sv << *width_ << "\" "sv;
-        }
-        if (line_cap_) {
-            out << "stroke-linecap=\""sv << *line_cap_ << "\" "sv;
-        }
-        if (line_join_) {
-            out << "stroke-linejoin=\""sv << *line_join_ << "\" "sv;
-        }
+    // Метод RenderAttrs выводит в буфер общие для всех путей атрибуты fill и stroke
+    void RenderAttrs(OutputBuffer& out) const {
+        RenderPathStyle(out, style_);
     }
 
 private:
@@ -135,23 +209,19 @@ private:
         return static_cast<Owner&>(*this);
     }
 
-    std::optional<Color> fill_color_;
-    std::optional<Color> stroke_color_;
-    std::optional<double> width_;
-    std::optional<StrokeLineCap> line_cap_;
-    std::optional<StrokeLineJoin> line_join_;
+    PathStyle style_;
 };
 
 /*
  * Вспомогательная структура, хранящая контекст для вывода SVG-документа с отступами.
- * Хранит ссылку на поток вывода, текущее значение и шаг отступа при выводе элемента
+ * Хранит ссылку на буфер вывода, текущее значение и шаг отступа при выводе элемента
  */
 struct RenderContext {
-    RenderContext(std::ostream& out)
+    RenderContext(OutputBuffer& out)
         : out(out) {
     }
 
-    RenderContext(std::ostream& out, int indent_step, int indent = 0)
+    RenderContext(OutputBuffer& out, int indent_step, int indent = 0)
         : out(out)
         , indent_step(indent_step)
         , indent(indent) {
@@ -162,12 +232,10 @@ struct RenderContext {
     }
 
     void RenderIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
-        }
+        out.AppendSpaces(static_cast<size_t>(indent));
     }
 
-    std::ostream& out;
+    OutputBuffer& out;
     int indent_step = 0;
     int indent = 0;
 };
@@ -193,6 +261,8 @@ private:
  */
 class Circle final : public Object, public PathProps<Circle> {
 public:
+    friend class Document;
+
     Circle& SetCenter(Point center);
     Circle& SetRadius(double radius);
 
@@ -209,6 +279,8 @@ private:
  */
 class Polyline final : public Object, public PathProps<Polyline> {
 public:
+    friend class Document;
+
     // Добавляет очередную вершину к ломаной линии
     Polyline& AddPoint(Point point);
 
@@ -224,6 +296,8 @@ private:
  */
 class Text final : public Object, public PathProps<Text> {
 public:
+    friend class Document;
+
     // Задаёт координаты опорной точки (атрибуты x и y)
     Text& SetPosition(Point pos);
 
@@ -276,18 +350,122 @@ public:
     virtual ~Drawable() = default;
 };
 
+// Номер стиля пути в документе
+using StyleId = uint32_t;
+
+// Ссылка на строку в пуле строк документа (пустая ссылка - строка не задана)
+struct StringRef {
+    uint32_t offset = 0; // < начало строки в пуле
+    uint32_t size = 0; // < длина строки
+
+    bool IsEmpty() const {
+        return size == 0;
+    }
+};
+
+// Текстовый элемент документа: строки и стиль задаются ссылками на общие данные документа
+struct TextElement {
+    Point position; // < опорная точка (атрибуты x и y)
+    Point offset; // < смещение относительно опорной точки (атрибуты dx и dy)
+    uint32_t font_size = 1; // < размер шрифта
+    StringRef font_family; // < название шрифта (не выводится, если не задано)
+    StringRef font_weight; // < толщина шрифта (не выводится, если не задана)
+    StringRef data; // < текстовое содержимое
+    StyleId style = 0; // < стиль пути
+};
+
+/*
+ * SVG-документ. Элементы хранятся по значению в одном непрерывном массиве в порядке добавления,
+ * вершины ломаных - в общем массиве вершин, строки - в общем пуле, а одинаковые стили путей - один раз,
+ * поэтому документ из сотен тысяч элементов обходится несколькими выделениями памяти.
+ * Объекты Circle, Polyline и Text при добавлении переводятся в это представление;
+ * прочие наследники Object хранятся в куче и выводятся через свой RenderObject
+ */
 class Document final : public ObjectContainer {
 public:
+    using ObjectContainer::Add;
+
+    // Добавляет в документ круг, ломаную или текст, переводя их в компактное представление
+    void Add(const Circle& circle);
+    void Add(const Polyline& polyline);
+    void Add(const Text& text);
+
     // Добавляет в svg-документ объект-наследник svg::Object
-    void AddPtr(std::unique_ptr<Object>&& object) {
-        objects_.emplace_back(std::move(object));
-    }
+    void AddPtr(std::unique_ptr<Object>&& object) override;
+
+    // Возвращает номер стиля пути, добавляя стиль, если такого еще нет
+    StyleId AddStyle(const PathStyle& style);
+
+    // Копирует строку в пул строк документа
+    StringRef AddString(std::string_view text);
 
-    // Выводит в ostream svg-представление документа
+    // Добавляет круг с центром center и радиусом radius
+    void AddCircle(Point center, double radius, StyleId style);
+
+    // Добавляет ломаную с вершинами из массива points
+    void AddPolyline(const Point* points, size_t count, StyleId style);
+
+    // Добавляет текст
+    void AddText(const TextElement& text);
+
+    // Резервирует место под заданное число элементов и вершин ломаных
+    void Reserve(size_t element_count, size_t point_count);
+
+    // Задает видимую область изображения (атрибут viewBox корневого элемента)
+    void SetViewBox(Point min, double width, double height);
+
+    /* Выводит в ostream svg-представление документа.
+       Разметка собирается в буфере (числа - с точностью потока) и записывается в поток одним вызовом */
     void Render(std::ostream& out) const;
 
+    // Выводит svg-представление документа в буфер
+    void Render(OutputBuffer& out) const;
+
+    /* Части svg-представления документа: заголовок с открывающим тегом svg, элементы и закрывающий тег.
+       Позволяют собрать документ из элементов нескольких документов, выведенных независимо */
+    void RenderHeader(OutputBuffer& out) const;
+    void RenderElements(OutputBuffer& out) const;
+    void RenderFooter(OutputBuffer& out) const;
+
 private:
-    std::vector<std::unique_ptr<Object>> objects_;
+    // Видимая область изображения
+    struct ViewBox {
+        Point min; // < левый верхний угол
+        double width = 0; // < ширина
+        double height = 0; // < высота
+    };
+
+    struct CircleElement {
+        Point center;
+        double radius = 1.0;
+        StyleId style = 0;
+    };
+
+    struct PolylineElement {
+        size_t first_point = 0; // < первая вершина в массиве вершин документа
+        size_t point_count = 0; // < число вершин
+        StyleId style = 0;
+    };
+
+    // Произвольный объект-наследник Object
+    struct CustomElement {
+        size_t index = 0; // < номер объекта в массиве объектов документа
+    };
+
+    using Element = std::variant<CircleElement, PolylineElement, TextElement, CustomElement>;
+
+    // Возвращает строку пула по ссылке
+    std::string_view GetString(StringRef ref) const;
+
+    // Выводит один элемент с отступом и переводом строки
+    void RenderElement(const RenderContext& context, const Element& element) const;
+
+    std::vector<Element> elements_; // < элементы в порядке добавления
+    std::vector<Point> points_; // < вершины всех ломаных
+    std::vector<PathStyle> styles_; // < различные стили путей
+    std::string strings_; // < пул строк
+    std::vector<std::unique_ptr<Object>> objects_; // < произвольные объекты-наследники Object
+    std::optional<ViewBox> view_box_; // < видимая область (не выводится, если не задана)
 };
 
 }  // namespace svg
\ No newline at end of file
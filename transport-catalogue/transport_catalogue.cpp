@@ -1,7 +1,8 @@
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <string_view>
-#include <unordered_set>
 #include <utility>
 
 #include "transport_catalogue.h"
@@ -10,21 +11,214 @@ using namespace std;
 
 namespace transport_catalogue {
 
-// Возвращает множество всех автобусных маршрутов, отсортированных в лексикографическом порядке
-const std::set<const domain::Bus*, domain::BusPointerComparator>& TransportCatalogue::GetAllBuses() const {
-    return sorted_buses_;
+namespace {
+
+// Возвращает ключ упорядоченной пары остановок
+uint64_t MakeStopsKey(domain::StopId from, domain::StopId to) {
+    return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+// Возвращает номера остановок маршрута без повторов в порядке возрастания
+vector<domain::StopId> GetUniqueStops(const domain::Bus& bus) {
+    vector<domain::StopId> unique_stops(bus.stops.begin(), bus.stops.end());
+    sort(unique_stops.begin(), unique_stops.end());
+    unique_stops.erase(unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
+    return unique_stops;
+}
+
+} // namespace
+
+// Реализация таблицы расстояний в формате CSR
+
+// Строит таблицу по явно заданным расстояниям (при повторах пары используется последнее значение)
+void DistanceTable::Build(size_t stop_count, const vector<DistanceRecord>& records) {
+    struct Item {
+        domain::StopId from;
+        domain::StopId to;
+        bool is_explicit;
+        size_t order; // < порядковый номер записи для выбора последнего из повторов
+        int distance;
+    };
+
+    // Каждая запись дает прямое направление и запасное обратное
+    vector<Item> items;
+    items.reserve(2 * records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        const DistanceRecord& record = records[i];
+        items.push_back({record.from, record.to, true, i, record.distance});
+        items.push_back({record.to, record.from, false, i, record.distance});
+    }
+
+    // Для каждой пары первым оказывается последнее явно заданное значение
+    sort(items.begin(), items.end(), [](const Item& lhs, const Item& rhs) {
+        if (lhs.from != rhs.from) return lhs.from < rhs.from;
+        if (lhs.to != rhs.to) return lhs.to < rhs.to;
+        if (lhs.is_explicit != rhs.is_explicit) return lhs.is_explicit;
+        return lhs.order > rhs.order;
+    });
+    items.erase(unique(items.begin(), items.end(), [](const Item& lhs, const Item& rhs) {
+        return lhs.from == rhs.from && lhs.to == rhs.to;
+    }), items.end());
+
+    // Собственная память таблицы
+    struct Storage {
+        vector<uint32_t> offsets;
+        vector<domain::StopId> neighbours;
+        vector<int> distances;
+        vector<uint8_t> is_explicit;
+    };
+    auto storage = make_shared<Storage>();
+
+    storage->offsets.assign(stop_count + 1, 0);
+    storage->neighbours.resize(items.size());
+    storage->distances.resize(items.size());
+    storage->is_explicit.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        ++storage->offsets[items[i].from + 1];
+        storage->neighbours[i] = items[i].to;
+        storage->distances[i] = items[i].distance;
+        storage->is_explicit[i] = items[i].is_explicit;
+    }
+    for (size_t i = 1; i < storage->offsets.size(); ++i) {
+        storage->offsets[i] += storage->offsets[i - 1];
+    }
+
+    arrays_ = {storage->offsets, storage->neighbours, storage->distances, storage->is_explicit};
+    storage_ = move(storage);
 }
 
-// Возвращает указатель на остановку по ее имени
+// Возвращает расстояние от одной остановки до другой, если оно известно
+optional<DistanceTable::Entry> DistanceTable::Find(domain::StopId from, domain::StopId to) const {
+    const auto& offsets = arrays_.offsets;
+    if (static_cast<size_t>(from) + 1 >= offsets.size()) {
+        return nullopt;
+    }
+
+    const auto begin = arrays_.neighbours.begin() + offsets[from];
+    const auto end = arrays_.neighbours.begin() + offsets[from + 1];
+    const auto it = lower_bound(begin, end, to);
+    if (it == end || *it != to) {
+        return nullopt;
+    }
+
+    const size_t index = it - arrays_.neighbours.begin();
+    return Entry{arrays_.distances[index], arrays_.is_explicit[index] != 0};
+}
+
+// Возвращает все явно заданные расстояния
+vector<DistanceRecord> DistanceTable::GetExplicitRecords() const {
+    vector<DistanceRecord> records;
+    const auto& offsets = arrays_.offsets;
+    for (size_t from = 0; from + 1 < offsets.size(); ++from) {
+        for (uint32_t i = offsets[from]; i < offsets[from + 1]; ++i) {
+            if (arrays_.is_explicit[i]) {
+                records.push_back({static_cast<domain::StopId>(from), arrays_.neighbours[i], arrays_.distances[i]});
+            }
+        }
+    }
+    return records;
+}
+
+// Возвращает массивы таблицы
+const DistanceTable::Arrays& DistanceTable::GetArrays() const {
+    return arrays_;
+}
+
+// Возвращает количество записей таблицы (вместе с подставленными обратными направлениями)
+size_t DistanceTable::GetSize() const {
+    return arrays_.neighbours.size();
+}
+
+/* Использует готовые массивы без копирования.
+   owner продлевает время жизни памяти, на которую указывают массивы */
+void DistanceTable::Attach(const Arrays& arrays, shared_ptr<const void> owner) {
+    arrays_ = arrays;
+    storage_ = move(owner);
+}
+
+// Конец реализации таблицы расстояний в формате CSR
+
+// Реализация таблицы маршрутов на остановках в формате CSR
+
+/* Строит таблицу по парам (номер остановки, номер маршрута), перечисленным в порядке имен маршрутов.
+   Каждая пара должна встречаться один раз */
+void StopBusTable::Build(size_t stop_count, const vector<pair<domain::StopId, domain::BusId>>& entries) {
+    auto storage = make_shared<Storage>();
+
+    // Раскладка подсчетом сохраняет порядок пар, поэтому маршруты каждой остановки остаются упорядоченными по имени
+    storage->offsets.assign(stop_count + 1, 0);
+    for (const auto& [stop_id, bus_id] : entries) {
+        ++storage->offsets[stop_id + 1];
+    }
+    for (size_t i = 1; i < storage->offsets.size(); ++i) {
+        storage->offsets[i] += storage->offsets[i - 1];
+    }
+    storage->buses.resize(entries.size());
+    vector<uint32_t> positions(storage->offsets.begin(), storage->offsets.end() - 1);
+    for (const auto& [stop_id, bus_id] : entries) {
+        storage->buses[positions[stop_id]++] = bus_id;
+    }
+
+    storage_ = move(storage);
+}
+
+// Возвращает номера маршрутов, проходящих через остановку (пусто для остановок, добавленных после построения)
+span<const domain::BusId> StopBusTable::Find(domain::StopId stop_id) const {
+    if (!storage_ || static_cast<size_t>(stop_id) + 1 >= storage_->offsets.size()) {
+        return {};
+    }
+    const uint32_t begin = storage_->offsets[stop_id];
+    return span<const domain::BusId>(storage_->buses).subspan(begin, storage_->offsets[stop_id + 1] - begin);
+}
+
+// Возвращает количество остановок, для которых построена таблица
+size_t StopBusTable::GetStopCount() const {
+    return storage_ ? storage_->offsets.size() - 1 : 0;
+}
+
+// Конец реализации таблицы маршрутов на остановках в формате CSR
+
+// Возвращает номера всех автобусных маршрутов в лексикографическом порядке их имен
+const vector<domain::BusId>& TransportCatalogue::GetAllBuses() const {
+    return *sorted_buses_;
+}
+
+// Возвращает указатель на описанную остановку по ее имени (nullptr, если остановка не описана)
 const domain::Stop* TransportCatalogue::GetStop(string_view stop_name) const {
-    auto it = stop_by_name_.find(stop_name);
-    return it != stop_by_name_.end() ? it->second : nullptr;
+    const domain::StopId* stop_id = stop_by_name_.Find(stop_name);
+    return stop_id && stops_.Get(*stop_id).is_declared ? &stops_.Get(*stop_id) : nullptr;
+}
+
+/* Возвращает указатель на остановку по ее порядковому номеру.
+   Номера есть и у остановок, которые пока только упоминаются в расстояниях или маршрутах (is_declared == false) */
+const domain::Stop* TransportCatalogue::GetStop(domain::StopId stop_id) const {
+    return stop_id < stops_.Size() ? &stops_.Get(stop_id) : nullptr;
 }
 
 // Возвращает указатель на автобусный маршрут по его имени
 const domain::Bus* TransportCatalogue::GetBus(string_view bus_name) const {
-    auto it = bus_by_name_.find(bus_name);
-    return it != bus_by_name_.end() ? it->second : nullptr;
+    const domain::BusId* bus_id = bus_by_name_.Find(bus_name);
+    return bus_id ? &buses_.Get(*bus_id) : nullptr;
+}
+
+// Возвращает указатель на автобусный маршрут по его порядковому номеру
+const domain::Bus* TransportCatalogue::GetBus(domain::BusId bus_id) const {
+    return bus_id < buses_.Size() ? &buses_.Get(bus_id) : nullptr;
+}
+
+// Возвращает количество автобусных маршрутов в каталоге
+size_t TransportCatalogue::GetBusCount() const {
+    return buses_.Size();
+}
+
+// Возвращает поколение каталога - счетчик, увеличивающийся при каждом изменении данных
+uint64_t TransportCatalogue::GetGeneration() const {
+    return generation_;
+}
+
+// Возвращает количество остановок в каталоге
+size_t TransportCatalogue::GetStopCount() const {
+    return stops_.Size();
 }
 
 // Возвращает информацию об автобусном маршруте по его имени
@@ -33,66 +227,306 @@ const domain::BusInfo TransportCatalogue::GetBusInfo(string_view bus_name) const
     if (!bus) {
         return {0, 0, 0, 0};
     }
-    
-    unordered_set<const domain::Stop*> unique_stops; // Создает набор уникальных указателей на остановки, через которые проходит маршрут
-    double route_length = 0;
-    double geo_length = 0;
-    for (size_t i = 0; i < bus->stops.size(); ++i) {
-        if (i != 0) {
-            geo_length += geo::ComputeDistance((*bus).stops[i - 1]->coords, (*bus).stops[i]->coords);
-            auto it = stop_to_stop_.find({(*bus).stops[i - 1], (*bus).stops[i]});
-            route_length += it != stop_to_stop_.end() ? it->second : stop_to_stop_.at({(*bus).stops[i], (*bus).stops[i - 1]});
+
+    // Статистика рассчитывается заранее в UpdateBusesInfo, пересчет нужен только для еще не обработанных маршрутов
+    return bus->info ? *bus->info : ComputeBusInfo(*bus);
+}
+
+/* Возвращает номера автобусных маршрутов, проходящих через остановку, по имени остановки
+   (пусто, если остановка неизвестна или не описана) */
+optional<domain::StopInfo> TransportCatalogue::GetStopInfo(string_view stop_name) const {
+    const domain::Stop* stop = GetStop(stop_name);
+    if (!stop) {
+        return nullopt;
+    }
+    return GetStopBuses(stop->id);
+}
+
+// Проверяет, проходят ли через остановку маршруты (в том числе через остановку, которая пока только упоминается)
+bool TransportCatalogue::IsStopServed(string_view stop_name) const {
+    const domain::StopId* stop_id = stop_by_name_.Find(stop_name);
+    return stop_id && !GetStopBuses(*stop_id).empty();
+}
+
+/* Возвращает расстояние по дорогам от одной остановки до другой.
+   Если расстояние в прямом направлении не задано, используется обратное */
+int TransportCatalogue::GetDistance(domain::StopId from, domain::StopId to) const {
+    const optional<DistanceTable::Entry> entry = distances_.Find(from, to);
+    if (pending_distances_.Empty()) {
+        if (entry) {
+            return entry->distance;
+        }
+    } else {
+        // Расстояния, добавленные после построения таблицы, имеют приоритет над ней
+        if (const int* distance = pending_distances_.Find(MakeStopsKey(from, to))) {
+            return *distance;
+        }
+        if (entry && entry->is_explicit) {
+            return entry->distance;
+        }
+        if (const int* distance = pending_distances_.Find(MakeStopsKey(to, from))) {
+            return *distance;
+        }
+        if (entry) {
+            return entry->distance;
         }
-        unique_stops.insert((*bus).stops[i]);
     }
+    throw out_of_range("Distance between stops "s + stops_.Get(from).name + " and "s + stops_.Get(to).name + " is not set"s);
+}
 
-    return {static_cast<int>((*bus).stops.size()), static_cast<int>(unique_stops.size()), route_length, route_length / geo_length};
+/* Возвращает расстояние по прямой между остановками.
+   Использует предрасчитанную тригонометрию координат остановок: один косинус и один арккосинус на пару */
+double TransportCatalogue::GetGeoDistance(domain::StopId from, domain::StopId to) const {
+    return geo::ComputeDistance(stop_coords_.Get(from), stop_coords_.Get(to));
 }
 
-/* Возвращает константную ссылку на множество наименований автобусных маршрутов, 
-   проходящих через остановку, по имени остановки */
-const domain::StopInfo& TransportCatalogue::GetStopInfo(string_view stop_name) const {
-    static const domain::StopInfo empty_set;
-    auto it = buses_on_stop_.find(stop_name);
-    return it != buses_on_stop_.end() ? it->second : empty_set;
+// Возвращает координаты остановки с предрасчитанной тригонометрией
+const geo::PreparedCoordinates& TransportCatalogue::GetPreparedCoordinates(domain::StopId stop_id) const {
+    return stop_coords_.Get(stop_id);
 }
 
-// Добавляет новую остановку в транспортный справочник
+// Возвращает таблицу расстояний (без учета расстояний, добавленных после последнего BuildDistanceTable)
+const DistanceTable& TransportCatalogue::GetDistanceTable() const {
+    return distances_;
+}
+
+/* Добавляет новую остановку в транспортный справочник.
+   Если остановка уже упоминалась в расстояниях или маршрутах, задает ее координаты */
 void TransportCatalogue::AddStop(const string& name, geo::Coordinates coords) {
-    stops_.push_back({name, coords}); // Создает новую остановку
-    const domain::Stop* stop_ptr = &stops_.back(); // Создает указатель на остановку
-    stop_by_name_[stop_ptr->name] = stop_ptr;
-    buses_on_stop_[stop_ptr->name];    
+    const domain::StopId stop_id = GetOrAddStop(name);
+    domain::Stop& stop = stops_.GetMutable(stop_id);
+    stop.coords = coords;
+    stop.is_declared = true;
+    stop_coords_.GetMutable(stop_id) = geo::Prepare(coords);
+    ++generation_;
+    // Координаты влияют на географическую длину маршрутов, проходящих через остановку
+    InvalidateBusesInfo(stop_id);
+}
+
+/* Добавляет остановку, которая пока только упоминается (например, при загрузке снимка каталога).
+   Такая остановка получает номер, но не описана, пока для нее не будет вызван AddStop */
+void TransportCatalogue::AddStopReference(string_view name) {
+    GetOrAddStop(name);
+    ++generation_;
 }
 
 // Добавляет расстояние между двумя остановками в справочник
 void TransportCatalogue::SetStopDistances(string_view from_stop, string_view to_stop, int distance) {
-    stop_to_stop_[{GetStop(from_stop), GetStop(to_stop)}] = distance;
+    const domain::StopId from = GetOrAddStop(from_stop);
+    const domain::StopId to = GetOrAddStop(to_stop);
+    pending_distances_.Set(MakeStopsKey(from, to), distance);
+    ++generation_;
+
+    // Расстояние могло использоваться как в прямом, так и в обратном направлении
+    InvalidateBusesInfo(from);
+    InvalidateBusesInfo(to);
 }
 
-// Добавляет новый автобусный маршрут в транспортный справочник
+/* Добавляет новый автобусный маршрут в транспортный справочник.
+   Маршрут с уже известным именем заменяется на месте и сохраняет свой номер */
 void TransportCatalogue::AddBus(const string& name, const vector<string>& stops_names, bool is_roundtrip) {
-    vector<const domain::Stop*> stops; // Создает набор указателей на остановки, через которые проходит маршрут
-    stops.reserve(stops_names.size());
+    vector<domain::StopId> stops; // Создает набор номеров остановок, через которые проходит маршрут
+    stops.reserve(is_roundtrip ? stops_names.size() : 2 * stops_names.size());
 
     for (int i = 0; i < static_cast<int>(stops_names.size()); ++i) {
-        stops.push_back(GetStop(stops_names[i]));
+        stops.push_back(GetOrAddStop(stops_names[i]));
     }
     // Если маршрут некольцевой, то добавляем остановки в обратном порядке
     if (!is_roundtrip) {
-        for (int i = static_cast<int>(stops_names.size() - 2); i >= 0; --i) {
-            stops.push_back(GetStop(stops_names[i]));
+        for (int i = static_cast<int>(stops.size() - 2); i >= 0; --i) {
+            stops.push_back(stops[i]);
         }
     }
 
-    buses_.push_back({name, move(stops), is_roundtrip}); // Создает новый маршрут
-    const domain::Bus* bus_ptr = &buses_.back(); // Создает указатель на этот маршрут
-    
-    bus_by_name_[bus_ptr->name] = bus_ptr;
-    for (const domain::Stop* stop : bus_ptr->stops) {
-        buses_on_stop_[stop->name].insert(bus_ptr);
+    if (const domain::BusId* bus_id = bus_by_name_.Find(name)) {
+        ReplaceBus(*bus_id, move(stops), is_roundtrip);
+        return;
+    }
+    const domain::BusId bus_id = static_cast<domain::BusId>(buses_.Size());
+    buses_.Add({bus_id, name, move(stops), is_roundtrip, nullopt}); // Создает новый маршрут
+    IndexBus(bus_id);
+}
+
+/* Добавляет автобусный маршрут по готовому списку номеров остановок (для некольцевого маршрута - вместе с обратным ходом).
+   Если статистика маршрута известна заранее (например, при загрузке снимка каталога), повторно она не рассчитывается */
+void TransportCatalogue::AddBus(const string& name, const vector<domain::StopId>& route, bool is_roundtrip, optional<domain::BusInfo> info) {
+    for (domain::StopId stop_id : route) {
+        if (stop_id >= stops_.Size()) {
+            throw out_of_range("Bus "s + name + " refers to an unknown stop"s);
+        }
+    }
+
+    const domain::BusId bus_id = static_cast<domain::BusId>(buses_.Size());
+    buses_.Add({bus_id, name, route, is_roundtrip, info});
+    IndexBus(bus_id);
+}
+
+// Регистрирует добавленный маршрут во внутренних таблицах каталога
+void TransportCatalogue::IndexBus(domain::BusId bus_id) {
+    const domain::Bus& bus = buses_.Get(bus_id);
+    bus_by_name_.Set(bus.name, bus_id);
+    for (domain::StopId stop_id : GetUniqueStops(bus)) {
+        InsertBusByName(GetMutableStopBuses(stop_id), bus_id);
+    }
+    InsertBusByName(GetMutableSortedBuses(), bus_id);
+    if (!bus.info) {
+        outdated_buses_.push_back(bus_id);
+    }
+    ++generation_;
+}
+
+// Заменяет остановки существующего маршрута, обновляя наборы маршрутов на затронутых остановках
+void TransportCatalogue::ReplaceBus(domain::BusId bus_id, vector<domain::StopId> stops, bool is_roundtrip) {
+    for (domain::StopId stop_id : GetUniqueStops(buses_.Get(bus_id))) {
+        vector<domain::BusId>& stop_buses = GetMutableStopBuses(stop_id);
+        stop_buses.erase(find(stop_buses.begin(), stop_buses.end(), bus_id));
+    }
+    domain::Bus& bus = buses_.GetMutable(bus_id);
+    bus.stops = move(stops);
+    bus.is_roundtrip = is_roundtrip;
+    for (domain::StopId stop_id : GetUniqueStops(bus)) {
+        InsertBusByName(GetMutableStopBuses(stop_id), bus_id);
+    }
+    if (bus.info) {
+        bus.info.reset();
+        outdated_buses_.push_back(bus_id);
+    }
+    ++generation_;
+}
+
+// Перестраивает таблицу расстояний с учетом расстояний, добавленных после предыдущего построения
+void TransportCatalogue::BuildDistanceTable() {
+    if (pending_distances_.Empty()) {
+        return;
+    }
+
+    vector<DistanceRecord> records = distances_.GetExplicitRecords();
+    records.reserve(records.size() + pending_distances_.Size());
+    pending_distances_.ForEach([&records](uint64_t key, int distance) {
+        records.push_back({static_cast<domain::StopId>(key >> 32), static_cast<domain::StopId>(key), distance});
+    });
+    pending_distances_.Clear();
+
+    distances_.Build(stops_.Size(), records);
+}
+
+// Заменяет таблицу расстояний готовой (например, загруженной из снимка каталога)
+void TransportCatalogue::SetDistanceTable(DistanceTable distances) {
+    distances_ = move(distances);
+    pending_distances_.Clear();
+    // Расстояния влияют на статистику всех маршрутов
+    for (domain::BusId bus_id = 0; bus_id < buses_.Size(); ++bus_id) {
+        if (buses_.Get(bus_id).info) {
+            buses_.GetMutable(bus_id).info.reset();
+            outdated_buses_.push_back(bus_id);
+        }
+    }
+    ++generation_;
+}
+
+// Перестраивает таблицу маршрутов на остановках с учетом маршрутов, добавленных или замененных после предыдущего построения
+void TransportCatalogue::BuildStopBusTable() {
+    if (pending_stop_buses_.Empty()) {
+        return;
+    }
+
+    // Маршруты перебираются в порядке имен, поэтому и в каждой остановке они окажутся упорядоченными
+    vector<pair<domain::StopId, domain::BusId>> entries;
+    for (domain::BusId bus_id : *sorted_buses_) {
+        for (domain::StopId stop_id : GetUniqueStops(buses_.Get(bus_id))) {
+            entries.emplace_back(stop_id, bus_id);
+        }
+    }
+    stop_buses_.Build(stops_.Size(), entries);
+    pending_stop_buses_.Clear();
+}
+
+/* Перестраивает таблицы расстояний и маршрутов на остановках, только если изменений после их построения накопилось
+   больше 1/kCompactionRatio размера таблицы */
+void TransportCatalogue::CompactChanges() {
+    if (pending_distances_.Size() * kCompactionRatio > distances_.GetSize()) {
+        BuildDistanceTable();
+    }
+    if (pending_stop_buses_.Size() * kCompactionRatio > stop_buses_.GetStopCount()) {
+        BuildStopBusTable();
+    }
+}
+
+// Рассчитывает статистику маршрутов, которые были добавлены или затронуты изменениями расстояний
+void TransportCatalogue::UpdateBusesInfo() {
+    for (domain::BusId bus_id : outdated_buses_) {
+        buses_.GetMutable(bus_id).info = ComputeBusInfo(buses_.Get(bus_id));
+    }
+    outdated_buses_.clear();
+}
+
+/* Возвращает номер остановки по ее имени, создавая при отсутствии неописанную остановку.
+   Позволяет добавлять расстояния и маршруты раньше описания самих остановок */
+domain::StopId TransportCatalogue::GetOrAddStop(string_view stop_name) {
+    if (const domain::StopId* stop_id = stop_by_name_.Find(stop_name)) {
+        return *stop_id;
+    }
+
+    const domain::StopId stop_id = static_cast<domain::StopId>(stops_.Size());
+    stops_.Add({stop_id, string(stop_name), {0, 0}, false}); // Создает новую остановку без координат
+    stop_by_name_.Set(string(stop_name), stop_id);
+    stop_coords_.Add(geo::Prepare({0, 0}));
+    return stop_id;
+}
+
+// Возвращает номера маршрутов, проходящих через остановку, с учетом изменений после построения таблицы
+span<const domain::BusId> TransportCatalogue::GetStopBuses(domain::StopId stop_id) const {
+    if (const vector<domain::BusId>* stop_buses = pending_stop_buses_.Find(stop_id)) {
+        return *stop_buses;
+    }
+    return stop_buses_.Find(stop_id);
+}
+
+// Вставляет номер маршрута в упорядоченный по именам маршрутов набор
+void TransportCatalogue::InsertBusByName(vector<domain::BusId>& bus_ids, domain::BusId bus_id) const {
+    const auto it = upper_bound(bus_ids.begin(), bus_ids.end(), bus_id, [this](domain::BusId lhs, domain::BusId rhs) {
+        return buses_.Get(lhs).name < buses_.Get(rhs).name;
+    });
+    bus_ids.insert(it, bus_id);
+}
+
+// Возвращает изменяемый набор маршрутов остановки, перенося его из таблицы в набор изменений
+vector<domain::BusId>& TransportCatalogue::GetMutableStopBuses(domain::StopId stop_id) {
+    auto [stop_buses, inserted] = pending_stop_buses_.TryEmplace(stop_id);
+    if (inserted) {
+        const span<const domain::BusId> table_buses = stop_buses_.Find(stop_id);
+        stop_buses->assign(table_buses.begin(), table_buses.end());
+    }
+    return *stop_buses;
+}
+
+// Возвращает изменяемый список маршрутов в порядке имен, копируя его, если он разделяется с другими копиями каталога
+vector<domain::BusId>& TransportCatalogue::GetMutableSortedBuses() {
+    return chunked_storage::MakeUnique(sorted_buses_);
+}
+
+// Рассчитывает статистику автобусного маршрута
+domain::BusInfo TransportCatalogue::ComputeBusInfo(const domain::Bus& bus) const {
+    double route_length = 0;
+    double geo_length = 0;
+    for (size_t i = 1; i < bus.stops.size(); ++i) {
+        geo_length += GetGeoDistance(bus.stops[i - 1], bus.stops[i]);
+        route_length += GetDistance(bus.stops[i - 1], bus.stops[i]);
+    }
+    const size_t unique_stops_count = GetUniqueStops(bus).size();
+
+    return {static_cast<int>(bus.stops.size()), static_cast<int>(unique_stops_count), route_length, route_length / geo_length};
+}
+
+// Помечает статистику маршрутов, проходящих через остановку, как требующую пересчета
+void TransportCatalogue::InvalidateBusesInfo(domain::StopId stop_id) {
+    for (domain::BusId bus_id : GetStopBuses(stop_id)) {
+        // Маршрут без предрасчитанной статистики уже находится в очереди на пересчет
+        if (buses_.Get(bus_id).info) {
+            buses_.GetMutable(bus_id).info.reset();
+            outdated_buses_.push_back(bus_id);
+        }
     }
-    sorted_buses_.insert(bus_ptr);
 }
 
-} // namespace transport_catalogue
\ No newline at end of file
+} // namespace transport_catalogue
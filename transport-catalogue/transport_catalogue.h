@@ -1,65 +1,265 @@
 #pragma once
 
-#include <deque>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
-#include <set>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
 
+#include "chunked_storage.h"
 #include "domain.h"
 
 namespace transport_catalogue {
 
-// Класс-хэшер pair<const Stop*, const Stop*>
-class StopsPairHasher {
+// Расстояние по дорогам от одной остановки до другой
+struct DistanceRecord {
+	domain::StopId from; // < номер остановки отправления
+	domain::StopId to; // < номер остановки прибытия
+	int distance; // < расстояние в метрах
+};
+
+/*
+ * Таблица расстояний по дорогам в формате CSR (compressed sparse row).
+ * Соседи всех остановок лежат в одном непрерывном массиве, внутри каждой остановки отсортированные по номеру.
+ * Для пар, у которых задано только одно направление, обратное направление подставляется при построении,
+ * поэтому поиск расстояния - это один двоичный поиск среди соседей остановки.
+ * Таблица неизменяема после построения, ее копии разделяют общую память
+ */
+class DistanceTable {
 public:
-	size_t operator() (const std::pair<const domain::Stop*, const domain::Stop*>& pair_of_stops) const {
-		return (p_hasher_(pair_of_stops.first) + p_hasher_(pair_of_stops.second) * 37);
-	}
+	// Массивы таблицы (указывают либо на собственную память таблицы, либо на внешнюю, например отображенный в память файл)
+	struct Arrays {
+		std::span<const uint32_t> offsets; // < начало списка соседей каждой остановки (размер - число остановок + 1)
+		std::span<const domain::StopId> neighbours; // < номера соседних остановок
+		std::span<const int> distances; // < расстояния до соседних остановок
+		std::span<const uint8_t> is_explicit; // < флаги явно заданных направлений
+	};
+
+	// Результат поиска расстояния
+	struct Entry {
+		int distance; // < расстояние в метрах
+		bool is_explicit; // < флаг явно заданного направления (false - подставлено обратное расстояние)
+	};
+
+	// Строит таблицу по явно заданным расстояниям (при повторах пары используется последнее значение)
+	void Build(size_t stop_count, const std::vector<DistanceRecord>& records);
+
+	// Возвращает расстояние от одной остановки до другой, если оно известно
+	std::optional<Entry> Find(domain::StopId from, domain::StopId to) const;
+
+	// Возвращает все явно заданные расстояния
+	std::vector<DistanceRecord> GetExplicitRecords() const;
+
+	// Возвращает массивы таблицы
+	const Arrays& GetArrays() const;
+
+	// Возвращает количество записей таблицы (вместе с подставленными обратными направлениями)
+	size_t GetSize() const;
+
+	/* Использует готовые массивы без копирования.
+	   owner продлевает время жизни памяти, на которую указывают массивы */
+	void Attach(const Arrays& arrays, std::shared_ptr<const void> owner);
 
 private:
-	std::hash<const void*> p_hasher_;
+	Arrays arrays_; // < массивы таблицы
+	std::shared_ptr<const void> storage_; // < владелец памяти массивов
 };
 
+/*
+ * Наборы автобусных маршрутов, проходящих через остановки, в формате CSR (compressed sparse row).
+ * Номера маршрутов всех остановок лежат в одном непрерывном массиве, внутри каждой остановки - в порядке имен маршрутов.
+ * Таблица неизменяема после построения, ее копии разделяют общую память
+ */
+class StopBusTable {
+public:
+	/* Строит таблицу по парам (номер остановки, номер маршрута), перечисленным в порядке имен маршрутов.
+	   Каждая пара должна встречаться один раз */
+	void Build(size_t stop_count, const std::vector<std::pair<domain::StopId, domain::BusId>>& entries);
+
+	// Возвращает номера маршрутов, проходящих через остановку (пусто для остановок, добавленных после построения)
+	std::span<const domain::BusId> Find(domain::StopId stop_id) const;
+
+	// Возвращает количество остановок, для которых построена таблица
+	size_t GetStopCount() const;
+
+private:
+	// Массивы таблицы
+	struct Storage {
+		std::vector<uint32_t> offsets; // < начало списка маршрутов каждой остановки (размер - число остановок + 1)
+		std::vector<domain::BusId> buses; // < номера маршрутов
+	};
+
+	std::shared_ptr<const Storage> storage_; // < массивы таблицы (пусто до построения)
+};
+
+/*
+ * Транспортный справочник.
+ * Остановкам и маршрутам при добавлении присваиваются плотные порядковые номера (id),
+ * имя переводится в номер один раз на границе интерфейса, а все внутренние таблицы
+ * (расстояния, маршруты через остановку) хранятся в векторах, индексируемых номерами.
+ * Остановки, маршруты, координаты и словари имен хранятся блоками с копированием при записи,
+ * поэтому копия каталога разделяет с исходным все данные, а изменение копии копирует только затронутые блоки
+ */
 class TransportCatalogue {
 public:
-	// Возвращает множество всех автобусных маршрутов, отсортированных в лексикографическом порядке
-	const std::set<const domain::Bus*, domain::BusPointerComparator>& GetAllBuses() const;
+	TransportCatalogue() = default;
+
+	/* Создает независимую копию каталога (например, для подготовки следующей версии, пока предыдущая читается).
+	   Копия разделяет с исходным каталогом блоки данных и неизменяемые таблицы и обходится в число блоков, а не элементов.
+	   Указатели на остановки и маршруты исходного каталога остаются действительными, пока он жив */
+	TransportCatalogue(const TransportCatalogue& other) = default;
+	TransportCatalogue& operator=(const TransportCatalogue&) = delete;
+
+	// Возвращает номера всех автобусных маршрутов в лексикографическом порядке их имен
+	const std::vector<domain::BusId>& GetAllBuses() const;
 
-	// Возвращает указатель на остановку по ее имени
+	// Возвращает указатель на описанную остановку по ее имени (nullptr, если остановка не описана)
 	const domain::Stop* GetStop(std::string_view stop_name) const;
 
+	/* Возвращает указатель на остановку по ее порядковому номеру.
+	   Номера есть и у остановок, которые пока только упоминаются в расстояниях или маршрутах (is_declared == false) */
+	const domain::Stop* GetStop(domain::StopId stop_id) const;
+
 	// Возвращает указатель на автобусный маршрут по его имени
 	const domain::Bus* GetBus(std::string_view bus_name) const;
 
+	// Возвращает указатель на автобусный маршрут по его порядковому номеру
+	const domain::Bus* GetBus(domain::BusId bus_id) const;
+
+	// Возвращает количество автобусных маршрутов в каталоге
+	size_t GetBusCount() const;
+
+	// Возвращает поколение каталога - счетчик, увеличивающийся при каждом изменении данных
+	uint64_t GetGeneration() const;
+
+	// Возвращает количество остановок в каталоге (номера остановок лежат в диапазоне [0, GetStopCount()))
+	size_t GetStopCount() const;
+
 	// Возвращает информацию об автобусном маршруте по его имени
 	const domain::BusInfo GetBusInfo(std::string_view bus_name) const;
 
-	/* Возвращает константную ссылку на множество автобусных маршрутов, 
-	   проходящих через остановку, по имени остановки */
-	const domain::StopInfo& GetStopInfo(std::string_view stop_name) const;
+	/* Возвращает номера автобусных маршрутов, проходящих через остановку, по имени остановки
+	   (пусто, если остановка неизвестна или не описана) */
+	std::optional<domain::StopInfo> GetStopInfo(std::string_view stop_name) const;
+
+	// Проверяет, проходят ли через остановку маршруты (в том числе через остановку, которая пока только упоминается)
+	bool IsStopServed(std::string_view stop_name) const;
 
-	// Добавляет новую остановку в транспортный справочник
+	/* Возвращает расстояние по дорогам от одной остановки до другой.
+	   Если расстояние в прямом направлении не задано, используется обратное */
+	int GetDistance(domain::StopId from, domain::StopId to) const;
+
+	/* Возвращает расстояние по прямой между остановками.
+	   Использует предрасчитанную тригонометрию координат остановок: один косинус и один арккосинус на пару */
+	double GetGeoDistance(domain::StopId from, domain::StopId to) const;
+
+	// Возвращает координаты остановки с предрасчитанной тригонометрией
+	const geo::PreparedCoordinates& GetPreparedCoordinates(domain::StopId stop_id) const;
+
+	// Возвращает таблицу расстояний (без учета расстояний, добавленных после последнего BuildDistanceTable)
+	const DistanceTable& GetDistanceTable() const;
+
+	/* Добавляет новую остановку в транспортный справочник.
+	   Если остановка уже упоминалась в расстояниях или маршрутах, задает ее координаты */
 	void AddStop(const std::string& name, geo::Coordinates coords);
 
+	/* Добавляет остановку, которая пока только упоминается (например, при загрузке снимка каталога).
+	   Такая остановка получает номер, но не описана, пока для нее не будет вызван AddStop */
+	void AddStopReference(std::string_view name);
+
 	// Добавляет расстояние между двумя остановками в справочник
 	void SetStopDistances(std::string_view from, std::string_view to, int distance);
 
-	// Добавляет новый автобусный маршрут в транспортный справочник
+	/* Добавляет новый автобусный маршрут в транспортный справочник.
+	   Маршрут с уже известным именем заменяется на месте и сохраняет свой номер */
 	void AddBus(const std::string& name, const std::vector<std::string>& stops_names, bool is_roundtrip);
 
+	/* Добавляет автобусный маршрут по готовому списку номеров остановок (для некольцевого маршрута - вместе с обратным ходом).
+	   Если статистика маршрута известна заранее (например, при загрузке снимка каталога), повторно она не рассчитывается */
+	void AddBus(const std::string& name, const std::vector<domain::StopId>& route, bool is_roundtrip, std::optional<domain::BusInfo> info);
+
+	// Перестраивает таблицу расстояний с учетом расстояний, добавленных после предыдущего построения
+	void BuildDistanceTable();
+
+	// Заменяет таблицу расстояний готовой (например, загруженной из снимка каталога)
+	void SetDistanceTable(DistanceTable distances);
+
+	// Перестраивает таблицу маршрутов на остановках с учетом маршрутов, добавленных или замененных после предыдущего построения
+	void BuildStopBusTable();
+
+	/* Перестраивает таблицы расстояний и маршрутов на остановках, только если изменений после их построения накопилось
+	   больше 1/kCompactionRatio размера таблицы. Меньшие изменения остаются в наборах изменений, которые читаются
+	   раньше таблиц, поэтому небольшое обновление не перестраивает таблицы, а перестроение в среднем
+	   обходится в kCompactionRatio записей таблицы на одно изменение */
+	void CompactChanges();
+
+	static constexpr size_t kCompactionRatio = 8; // < во сколько раз таблица больше набора изменений, при котором она перестраивается
+
+	// Рассчитывает статистику маршрутов, которые были добавлены или затронуты изменениями расстояний
+	void UpdateBusesInfo();
+
 private:
-	std::deque<domain::Stop> stops_; // < набор остановок
-	std::deque<domain::Bus> buses_; // < набор автобусных маршрутов
+	/* Возвращает номер остановки по ее имени, создавая при отсутствии неописанную остановку.
+	   Позволяет добавлять расстояния и маршруты раньше описания самих остановок */
+	domain::StopId GetOrAddStop(std::string_view stop_name);
+
+	// Рассчитывает статистику автобусного маршрута
+	domain::BusInfo ComputeBusInfo(const domain::Bus& bus) const;
+
+	// Регистрирует добавленный маршрут во внутренних таблицах каталога
+	void IndexBus(domain::BusId bus_id);
+
+	// Заменяет остановки существующего маршрута, обновляя наборы маршрутов на затронутых остановках
+	void ReplaceBus(domain::BusId bus_id, std::vector<domain::StopId> stops, bool is_roundtrip);
+
+	// Возвращает номера маршрутов, проходящих через остановку, с учетом изменений после построения таблицы
+	std::span<const domain::BusId> GetStopBuses(domain::StopId stop_id) const;
+
+	// Вставляет номер маршрута в упорядоченный по именам маршрутов набор
+	void InsertBusByName(std::vector<domain::BusId>& bus_ids, domain::BusId bus_id) const;
+
+	// Возвращает изменяемый набор маршрутов остановки, перенося его из таблицы в набор изменений
+	std::vector<domain::BusId>& GetMutableStopBuses(domain::StopId stop_id);
+
+	// Помечает статистику маршрутов, проходящих через остановку, как требующую пересчета
+	void InvalidateBusesInfo(domain::StopId stop_id);
+
+	// Возвращает изменяемый список маршрутов в порядке имен, копируя его, если он разделяется с другими копиями каталога
+	std::vector<domain::BusId>& GetMutableSortedBuses();
+
+	// Хеш имени, позволяющий искать в словарях по std::string_view без создания строки
+	struct NameHash {
+		using is_transparent = void;
+
+		size_t operator()(std::string_view name) const {
+			return std::hash<std::string_view>{}(name);
+		}
+	};
+
+	template <typename Id>
+	using NameMap = chunked_storage::ShardedMap<std::string, Id, NameHash, std::equal_to<>>;
+
+	uint64_t generation_ = 0; // < поколение каталога
+
+	chunked_storage::ChunkedVector<domain::Stop> stops_; // < набор остановок, индексируемый номером остановки
+	chunked_storage::ChunkedVector<domain::Bus> buses_; // < набор автобусных маршрутов, индексируемый номером маршрута
 
-	std::set<const domain::Bus*, domain::BusPointerComparator> sorted_buses_; // < набор всех автобусных маршрутов, сортированных по имени в лексикографическом порядке
+	std::shared_ptr<std::vector<domain::BusId>> sorted_buses_ = std::make_shared<std::vector<domain::BusId>>(); // < номера всех автобусных маршрутов в лексикографическом порядке их имен
 
-	std::unordered_map<std::string_view, const domain::Stop*> stop_by_name_; // < набор указателей на остановки по их имени
-	std::unordered_map<std::string_view, const domain::Bus*> bus_by_name_; // < набор указателей на автобусные маршруты по их имени
+	NameMap<domain::StopId> stop_by_name_; // < номера остановок по их имени
+	NameMap<domain::BusId> bus_by_name_; // < номера автобусных маршрутов по их имени
+	std::vector<domain::BusId> outdated_buses_; // < номера маршрутов, статистику которых необходимо пересчитать
 
-	std::unordered_map<std::string_view, domain::StopInfo> buses_on_stop_; // < набор автобусных маршрутов, проходящих через определенную остановку, по имени остановки
+	chunked_storage::ChunkedVector<geo::PreparedCoordinates> stop_coords_; // < координаты остановок с синусами и косинусами широт по номеру остановки
+	StopBusTable stop_buses_; // < построенная таблица маршрутов, проходящих через остановки
+	chunked_storage::ShardedMap<domain::StopId, std::vector<domain::BusId>> pending_stop_buses_; // < наборы маршрутов остановок, измененные после построения таблицы
 
-	std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, StopsPairHasher> stop_to_stop_; // < набор расстояний от одной остановки к другой
+	DistanceTable distances_; // < построенная таблица расстояний
+	chunked_storage::ShardedMap<uint64_t, int> pending_distances_; // < расстояния, добавленные после построения таблицы, по паре номеров остановок
 };
 
-} // namespace transport_catalogue
\ No newline at end of file
+} // namespace transport_catalogue
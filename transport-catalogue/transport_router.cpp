@@ -0,0 +1,388 @@
+#include "transport_router.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+namespace transport_router {
+
+namespace {
+
+// Количество метров в минуту при скорости 1 км/ч
+constexpr double kMetersPerMinutePerKmh = 1000.0 / 60.0;
+
+// Передает обработчику участки маршрутов, проходимые в одном направлении: маршрут и полуинтервал номеров его остановок
+template <typename Visitor>
+void ForEachBusSegment(const transport_catalogue::TransportCatalogue& catalogue, Visitor visitor) {
+    for (domain::BusId bus_id : catalogue.GetAllBuses()) {
+        const domain::Bus* bus = catalogue.GetBus(bus_id);
+        const size_t stop_count = bus->stops.size();
+        if (stop_count < 2) {
+            continue;
+        }
+        if (bus->is_roundtrip) {
+            visitor(*bus, 0, stop_count);
+        } else {
+            // Маршрут хранится вместе с обратным ходом: прямой и обратный ход проходятся раздельно
+            const size_t middle = stop_count / 2;
+            visitor(*bus, 0, middle + 1);
+            visitor(*bus, middle, stop_count);
+        }
+    }
+}
+
+// Возвращает количество вершин поездки графа маршрутов
+size_t CountRideVertices(const transport_catalogue::TransportCatalogue& catalogue) {
+    size_t count = 0;
+    ForEachBusSegment(catalogue, [&count](const domain::Bus&, size_t begin, size_t end) {
+        count += end - begin;
+    });
+    return count;
+}
+
+} // namespace
+
+// Реализация таблицы маршрутов
+
+// Возвращает номер строки таблицы для остановки-источника
+optional<size_t> RouteTable::FindRow(domain::StopId source) const {
+    if (source >= row_by_stop_.size() || row_by_stop_[source] == kNoRow) {
+        return nullopt;
+    }
+    return row_by_stop_[source];
+}
+
+// Возвращает время в пути от источника строки до остановки
+double RouteTable::GetTime(size_t row, domain::StopId stop_id) const {
+    return arrays_.times[row * header_.stop_count + stop_id];
+}
+
+// Возвращает ребро посадки последней поездки пути от источника строки до остановки
+graph::EdgeId RouteTable::GetBoardingEdge(size_t row, domain::StopId stop_id) const {
+    return arrays_.boarding_edges[row * header_.stop_count + stop_id];
+}
+
+// Возвращает ребро высадки последней поездки пути от источника строки до остановки
+graph::EdgeId RouteTable::GetAlightingEdge(size_t row, domain::StopId stop_id) const {
+    return arrays_.alighting_edges[row * header_.stop_count + stop_id];
+}
+
+// Возвращает параметры графа, по которому построена таблица
+const GraphHeader& RouteTable::GetHeader() const {
+    return header_;
+}
+
+// Возвращает массивы таблицы
+const RouteTable::Arrays& RouteTable::GetArrays() const {
+    return arrays_;
+}
+
+/* Использует готовые массивы без копирования.
+   owner продлевает время жизни памяти, на которую указывают массивы */
+void RouteTable::Attach(const GraphHeader& header, const Arrays& arrays, shared_ptr<const void> owner) {
+    header_ = header;
+    arrays_ = arrays;
+    storage_ = move(owner);
+
+    row_by_stop_.assign(header_.stop_count, kNoRow);
+    for (uint32_t row = 0; row < arrays_.sources.size(); ++row) {
+        row_by_stop_.at(arrays_.sources[row]) = row;
+    }
+}
+
+// Конец реализации таблицы маршрутов
+
+TransportRouter::TransportRouter(const transport_catalogue::TransportCatalogue& catalogue, const RoutingSettings& settings)
+    : catalogue_(catalogue)
+    , settings_(settings)
+    , stop_count_(catalogue.GetStopCount())
+    , graph_(stop_count_ + CountRideVertices(catalogue)) {
+    AddBusEdges();
+    BuildComponents();
+    graph_.Build();
+    router_ = make_unique<graph::Router<double>>(graph_);
+}
+
+// Находит самый быстрый путь между остановками по их именам (пусто, если остановки нет или путь не существует)
+optional<RouteInfo> TransportRouter::FindRoute(string_view from, string_view to) const {
+    const domain::Stop* stop_from = catalogue_.GetStop(from);
+    const domain::Stop* stop_to = catalogue_.GetStop(to);
+    if (!stop_from || !stop_to) {
+        return nullopt;
+    }
+    return FindRoute(stop_from->id, stop_to->id);
+}
+
+/* Находит самый быстрый путь между остановками по их номерам.
+   Остановки могут быть добавлены в каталог после построения графа: номера остановок при изменениях каталога не меняются */
+optional<RouteInfo> TransportRouter::FindRoute(domain::StopId from, domain::StopId to) const {
+    if (from >= components_.size() || to >= components_.size()) {
+        // Остановка добавлена после построения графа и маршрутами не обслуживается
+        return from == to ? optional<RouteInfo>(RouteInfo{0, {}}) : nullopt;
+    }
+    if (components_[from] != components_[to]) {
+        // Между остановками нет ни одного маршрута - поиск обошел бы всю компоненту начальной остановки впустую
+        return nullopt;
+    }
+
+    if (route_table_) {
+        if (const optional<size_t> row = route_table_->FindRow(from)) {
+            if (isinf(route_table_->GetTime(*row, to))) {
+                return nullopt;
+            }
+            return RestoreRoute(*row, to);
+        }
+    }
+
+    // Поиск суммирует веса перегонов и коротких связей иерархии, поэтому время пути пересчитывается по участкам поездки
+    const auto route = hierarchy_ ? hierarchy_->hierarchy.BuildRoute(from, to) : router_->BuildRoute(from, to);
+    if (!route) {
+        return nullopt;
+    }
+    return MakeRouteInfo(route->edges);
+}
+
+// Возвращает настройки, по которым построен граф
+const RoutingSettings& TransportRouter::GetSettings() const {
+    return settings_;
+}
+
+/* Предрассчитывает таблицу маршрутов из остановок настроек route_table_stops (пусто - из всех остановок),
+   выполняя поиски из разных источников параллельно в thread_count потоках */
+void TransportRouter::BuildRouteTable(size_t thread_count) {
+    // Собственная память таблицы
+    struct Storage {
+        vector<domain::StopId> sources;
+        vector<double> times;
+        vector<graph::EdgeId> boarding_edges;
+        vector<graph::EdgeId> alighting_edges;
+    };
+    auto storage = make_shared<Storage>();
+
+    const size_t stop_count = stop_count_;
+    if (settings_.route_table_stops.empty()) {
+        storage->sources.resize(stop_count);
+        iota(storage->sources.begin(), storage->sources.end(), 0);
+    } else {
+        // Неизвестные остановки пропускаются
+        for (const string& stop_name : settings_.route_table_stops) {
+            if (const domain::Stop* stop = catalogue_.GetStop(stop_name)) {
+                storage->sources.push_back(stop->id);
+            }
+        }
+        sort(storage->sources.begin(), storage->sources.end());
+        storage->sources.erase(unique(storage->sources.begin(), storage->sources.end()), storage->sources.end());
+    }
+    storage->times.resize(storage->sources.size() * stop_count);
+    storage->boarding_edges.resize(storage->sources.size() * stop_count);
+    storage->alighting_edges.resize(storage->sources.size() * stop_count);
+
+    // Поиски из разных источников независимы: потоки разбирают строки по одной через общий счетчик
+    atomic<size_t> next_row = 0;
+    exception_ptr error;
+    mutex error_mutex;
+    auto worker = [&]() {
+        try {
+            vector<double> weights(graph_.GetVertexCount());
+            vector<graph::EdgeId> prev_edges(graph_.GetVertexCount());
+            vector<graph::EdgeId> ride_boardings(ride_vertices_.size());
+            for (size_t row = next_row++; row < storage->sources.size(); row = next_row++) {
+                router_->BuildRouteTree(storage->sources[row], weights, prev_edges);
+
+                // Вершины поездки одного участка маршрута идут подряд, поэтому посадка поездки, в которую вершина
+                // попала по перегону, уже найдена для предыдущей вершины
+                for (size_t i = 0; i < ride_vertices_.size(); ++i) {
+                    const graph::EdgeId prev_edge = prev_edges[stop_count + i];
+                    const bool is_boarding = prev_edge == graph::Router<double>::kNoEdge || IsStopVertex(graph_.GetEdge(prev_edge).from);
+                    ride_boardings[i] = is_boarding ? prev_edge : ride_boardings[i - 1];
+                }
+
+                // В вершину остановки ведут только ребра высадки
+                for (domain::StopId stop_id = 0; stop_id < stop_count; ++stop_id) {
+                    const graph::EdgeId alighting_edge = prev_edges[stop_id];
+                    storage->times[row * stop_count + stop_id] = weights[stop_id];
+                    storage->alighting_edges[row * stop_count + stop_id] = alighting_edge;
+                    storage->boarding_edges[row * stop_count + stop_id] = alighting_edge == graph::Router<double>::kNoEdge
+                        ? graph::Router<double>::kNoEdge
+                        : ride_boardings[graph_.GetEdge(alighting_edge).from - stop_count];
+                }
+            }
+        } catch (...) {
+            lock_guard guard(error_mutex);
+            error = current_exception();
+            next_row = storage->sources.size();
+        }
+    };
+
+    thread_count = min(max<size_t>(thread_count, 1), max<size_t>(storage->sources.size(), 1));
+    vector<thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : threads) {
+        t.join();
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    RouteTable route_table;
+    route_table.Attach(GetGraphHeader(), {storage->sources, storage->times, storage->boarding_edges, storage->alighting_edges}, storage);
+    route_table_ = move(route_table);
+}
+
+/* Использует готовую таблицу маршрутов (например, загруженную из снимка каталога).
+   Возвращает false, если таблица построена для другого графа или других настроек */
+bool TransportRouter::SetRouteTable(const RouteTable& route_table) {
+    if (route_table.GetHeader() != GetGraphHeader()) {
+        return false;
+    }
+    route_table_ = route_table;
+    return true;
+}
+
+// Возвращает таблицу маршрутов, если она построена
+const RouteTable* TransportRouter::GetRouteTable() const {
+    return route_table_ ? &*route_table_ : nullptr;
+}
+
+// Восстанавливает путь по строке таблицы маршрутов
+RouteInfo TransportRouter::RestoreRoute(size_t row, domain::StopId to) const {
+    // Путь восстанавливается с конца по поездкам: посадка каждой поездки ведет на остановку, где закончилась предыдущая
+    vector<graph::EdgeId> edges;
+    for (domain::StopId stop_id = to; route_table_->GetAlightingEdge(row, stop_id) != graph::Router<double>::kNoEdge;) {
+        const graph::EdgeId boarding_edge = route_table_->GetBoardingEdge(row, stop_id);
+        edges.push_back(route_table_->GetAlightingEdge(row, stop_id));
+        edges.push_back(boarding_edge);
+        stop_id = graph_.GetEdge(boarding_edge).from;
+    }
+    reverse(edges.begin(), edges.end());
+    return MakeRouteInfo(edges);
+}
+
+// Строит иерархию сжатия графа
+void TransportRouter::BuildContractionHierarchy() {
+    hierarchy_ = RoutingHierarchy{GetGraphHeader(), graph::ContractionHierarchy<double>(graph_)};
+}
+
+/* Использует готовую иерархию сжатия (например, загруженную из снимка каталога).
+   Возвращает false, если иерархия построена для другого графа или других настроек */
+bool TransportRouter::SetContractionHierarchy(const RoutingHierarchy& hierarchy) {
+    if (hierarchy.header != GetGraphHeader() || hierarchy.hierarchy.GetVertexCount() != graph_.GetVertexCount()) {
+        return false;
+    }
+    hierarchy_ = hierarchy;
+    return true;
+}
+
+// Возвращает иерархию сжатия, если она построена
+const RoutingHierarchy* TransportRouter::GetContractionHierarchy() const {
+    return hierarchy_ ? &*hierarchy_ : nullptr;
+}
+
+/* Собирает участки маршрута по ребрам пути, суммируя время в порядке следования.
+   Время поездки считается по расстоянию от посадки до высадки, а не суммой весов перегонов */
+RouteInfo TransportRouter::MakeRouteInfo(const vector<graph::EdgeId>& edges) const {
+    const double meters_per_minute = settings_.bus_velocity * kMetersPerMinutePerKmh;
+    RouteInfo route_info{0, {}};
+    const RideVertex* boarding = nullptr;
+    for (graph::EdgeId edge_id : edges) {
+        const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
+        if (IsStopVertex(edge.from)) {
+            // Посадка: ожидание автобуса на остановке
+            boarding = &GetRideVertex(edge.to);
+            route_info.total_time += edge.weight;
+            route_info.items.push_back(WaitItem{catalogue_.GetStop(edge.from), edge.weight});
+        } else if (IsStopVertex(edge.to)) {
+            // Высадка: поездка от остановки посадки целиком
+            const RideVertex& alighting = GetRideVertex(edge.from);
+            const double time = (alighting.distance - boarding->distance) / meters_per_minute;
+            route_info.total_time += time;
+            route_info.items.push_back(BusItem{alighting.bus, static_cast<int>(alighting.position - boarding->position), time});
+        }
+    }
+    return route_info;
+}
+
+// Возвращает параметры графа для сверки с предрассчитанными данными
+GraphHeader TransportRouter::GetGraphHeader() const {
+    return {static_cast<uint32_t>(stop_count_), static_cast<uint32_t>(graph_.GetVertexCount()), static_cast<uint32_t>(graph_.GetEdgeCount()),
+            settings_.bus_wait_time, settings_.bus_velocity};
+}
+
+// Добавляет вершины и ребра поездки по всем маршрутам
+void TransportRouter::AddBusEdges() {
+    ride_vertices_.reserve(graph_.GetVertexCount() - stop_count_);
+    ForEachBusSegment(catalogue_, [this](const domain::Bus& bus, size_t begin, size_t end) {
+        AddBusSegmentEdges(bus, begin, end);
+    });
+}
+
+// Добавляет вершины поездки и ребра перегонов, посадки и высадки участка маршрута, проходимого в одном направлении
+void TransportRouter::AddBusSegmentEdges(const domain::Bus& bus, size_t begin, size_t end) {
+    const double meters_per_minute = settings_.bus_velocity * kMetersPerMinutePerKmh;
+    const graph::VertexId first_vertex = static_cast<graph::VertexId>(stop_count_ + ride_vertices_.size());
+    int distance = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const graph::VertexId vertex = first_vertex + static_cast<graph::VertexId>(i - begin);
+        const domain::StopId stop_id = bus.stops[i];
+        // На первой остановке участка не выходят, а на последней не садятся
+        if (i > begin) {
+            const int segment_distance = catalogue_.GetDistance(bus.stops[i - 1], stop_id);
+            distance += segment_distance;
+            graph_.AddEdge({vertex - 1, vertex, segment_distance / meters_per_minute});
+            graph_.AddEdge({vertex, stop_id, 0.0});
+        }
+        if (i + 1 < end) {
+            graph_.AddEdge({stop_id, vertex, static_cast<double>(settings_.bus_wait_time)});
+        }
+        ride_vertices_.push_back({&bus, static_cast<uint32_t>(i), distance});
+    }
+}
+
+// Разбивает остановки на компоненты связности по маршрутам, чтобы заведомо недостижимые пути отсекались без поиска
+void TransportRouter::BuildComponents() {
+    components_.resize(catalogue_.GetStopCount());
+    iota(components_.begin(), components_.end(), 0);
+
+    auto find_root = [this](domain::StopId stop_id) {
+        while (components_[stop_id] != stop_id) {
+            stop_id = components_[stop_id] = components_[components_[stop_id]];
+        }
+        return stop_id;
+    };
+
+    // Все остановки одного маршрута взаимно достижимы (некольцевой маршрут проходится в обе стороны, кольцевой замкнут)
+    for (domain::BusId bus_id : catalogue_.GetAllBuses()) {
+        const vector<domain::StopId>& stops = catalogue_.GetBus(bus_id)->stops;
+        for (size_t i = 1; i < stops.size(); ++i) {
+            const domain::StopId lhs = find_root(stops[0]);
+            const domain::StopId rhs = find_root(stops[i]);
+            components_[max(lhs, rhs)] = min(lhs, rhs);
+        }
+    }
+    for (domain::StopId stop_id = 0; stop_id < components_.size(); ++stop_id) {
+        components_[stop_id] = find_root(stop_id);
+    }
+}
+
+// Проверяет, что вершина графа - вершина остановки (ее номер совпадает с номером остановки)
+bool TransportRouter::IsStopVertex(graph::VertexId vertex) const {
+    return vertex < stop_count_;
+}
+
+// Возвращает проход маршрута, которому соответствует вершина поездки
+const TransportRouter::RideVertex& TransportRouter::GetRideVertex(graph::VertexId vertex) const {
+    return ride_vertices_[vertex - stop_count_];
+}
+
+} // namespace transport_router
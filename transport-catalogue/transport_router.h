@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "contraction_hierarchy.h"
+#include "graph.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+namespace transport_router {
+
+struct RoutingSettings {
+    int bus_wait_time = 0; // < время ожидания автобуса на остановке (в минутах)
+    double bus_velocity = 0; // < скорость автобуса (в км/ч)
+    bool use_route_table = false; // < флаг предрасчета таблицы маршрутов
+    bool use_contraction_hierarchy = false; // < флаг построения иерархии сжатия графа
+    std::vector<std::string> route_table_stops; // < остановки-источники таблицы маршрутов (пусто - все остановки)
+};
+
+struct WaitItem {
+    const domain::Stop* stop; // < остановка, на которой ожидается автобус
+    double time; // < время ожидания (в минутах)
+};
+
+struct BusItem {
+    const domain::Bus* bus; // < маршрут, по которому совершается поездка
+    int span_count; // < количество проезжаемых перегонов между остановками
+    double time; // < время поездки (в минутах)
+};
+
+using RouteItem = std::variant<WaitItem, BusItem>;
+
+struct RouteInfo {
+    double total_time; // < суммарное время в пути (в минутах)
+    std::vector<RouteItem> items; // < участки маршрута в порядке следования
+};
+
+// Параметры графа маршрутов, по которому построены предрассчитанные данные (применимы только к такому же графу)
+struct GraphHeader {
+    uint32_t stop_count = 0; // < количество остановок
+    uint32_t vertex_count = 0; // < количество вершин графа
+    uint32_t edge_count = 0; // < количество ребер графа
+    int bus_wait_time = 0; // < время ожидания автобуса
+    double bus_velocity = 0; // < скорость автобуса
+
+    bool operator==(const GraphHeader& other) const = default;
+};
+
+/*
+ * Таблица самых быстрых путей из выбранных остановок-источников до всех остановок.
+ * Строка таблицы - дерево кратчайших путей одного источника: для каждой остановки назначения хранятся
+ * время в пути и ребра посадки и высадки последней поездки, по которым путь восстанавливается без поиска по графу.
+ * Строки лежат подряд в плоских массивах, таблица неизменяема после построения, ее копии разделяют общую память
+ */
+class RouteTable {
+public:
+    // Массивы таблицы (указывают либо на собственную память таблицы, либо на внешнюю, например отображенный в память файл)
+    struct Arrays {
+        std::span<const domain::StopId> sources; // < номера остановок-источников по номеру строки
+        std::span<const double> times; // < время в пути (бесконечность - путь не существует)
+        std::span<const graph::EdgeId> boarding_edges; // < ребро посадки последней поездки пути (для источника - отсутствие ребра)
+        std::span<const graph::EdgeId> alighting_edges; // < ребро высадки последней поездки пути (для источника - отсутствие ребра)
+    };
+
+    // Возвращает номер строки таблицы для остановки-источника
+    std::optional<size_t> FindRow(domain::StopId source) const;
+
+    // Возвращает время в пути от источника строки до остановки
+    double GetTime(size_t row, domain::StopId stop_id) const;
+
+    // Возвращает ребро посадки последней поездки пути от источника строки до остановки
+    graph::EdgeId GetBoardingEdge(size_t row, domain::StopId stop_id) const;
+
+    // Возвращает ребро высадки последней поездки пути от источника строки до остановки
+    graph::EdgeId GetAlightingEdge(size_t row, domain::StopId stop_id) const;
+
+    // Возвращает параметры графа, по которому построена таблица
+    const GraphHeader& GetHeader() const;
+
+    // Возвращает массивы таблицы
+    const Arrays& GetArrays() const;
+
+    /* Использует готовые массивы без копирования.
+       owner продлевает время жизни памяти, на которую указывают массивы */
+    void Attach(const GraphHeader& header, const Arrays& arrays, std::shared_ptr<const void> owner);
+
+private:
+    static constexpr uint32_t kNoRow = UINT32_MAX;
+
+    GraphHeader header_; // < параметры графа таблицы
+    Arrays arrays_; // < массивы таблицы
+    std::vector<uint32_t> row_by_stop_; // < номер строки по номеру остановки (kNoRow - остановка не является источником)
+    std::shared_ptr<const void> storage_; // < владелец памяти массивов
+};
+
+// Иерархия сжатия графа маршрутов вместе с параметрами графа, для которого она построена
+struct RoutingHierarchy {
+    GraphHeader header; // < параметры графа
+    graph::ContractionHierarchy<double> hierarchy; // < иерархия сжатия
+};
+
+/*
+ * Маршрутизатор, находящий самый быстрый путь между остановками.
+ * Каждой остановке соответствует вершина графа, а каждому проходу маршрута через остановку - вершина поездки.
+ * Вершины поездки соседних остановок маршрута соединены ребром перегона, из вершины остановки в вершину поездки
+ * ведет ребро посадки с весом ожидания автобуса, а обратно - ребро высадки без веса. Число ребер растет линейно
+ * с длиной маршрутов, а пересадка всегда стоит одно ожидание.
+ * Граф строится один раз по построенному каталогу, после чего поиск можно выполнять из нескольких потоков.
+ * Для путей из остановок, вошедших в таблицу маршрутов, поиск по графу заменяется чтением таблицы,
+ * а при построенной иерархии сжатия остальные пути ищутся двунаправленным поиском по иерархии
+ */
+class TransportRouter {
+public:
+    TransportRouter(const transport_catalogue::TransportCatalogue& catalogue, const RoutingSettings& settings);
+
+    // Находит самый быстрый путь между остановками по их именам (пусто, если остановки нет или путь не существует)
+    std::optional<RouteInfo> FindRoute(std::string_view from, std::string_view to) const;
+
+    /* Находит самый быстрый путь между остановками по их номерам.
+       Остановки могут быть добавлены в каталог после построения графа: номера остановок при изменениях каталога не меняются */
+    std::optional<RouteInfo> FindRoute(domain::StopId from, domain::StopId to) const;
+
+    // Возвращает настройки, по которым построен граф
+    const RoutingSettings& GetSettings() const;
+
+    /* Предрассчитывает таблицу маршрутов из остановок настроек route_table_stops (пусто - из всех остановок),
+       выполняя поиски из разных источников параллельно в thread_count потоках */
+    void BuildRouteTable(size_t thread_count);
+
+    /* Использует готовую таблицу маршрутов (например, загруженную из снимка каталога).
+       Возвращает false, если таблица построена для другого графа или других настроек */
+    bool SetRouteTable(const RouteTable& route_table);
+
+    // Возвращает таблицу маршрутов, если она построена
+    const RouteTable* GetRouteTable() const;
+
+    // Строит иерархию сжатия графа
+    void BuildContractionHierarchy();
+
+    /* Использует готовую иерархию сжатия (например, загруженную из снимка каталога).
+       Возвращает false, если иерархия построена для другого графа или других настроек */
+    bool SetContractionHierarchy(const RoutingHierarchy& hierarchy);
+
+    // Возвращает иерархию сжатия, если она построена
+    const RoutingHierarchy* GetContractionHierarchy() const;
+
+    // Возвращает параметры графа для сверки с предрассчитанными данными
+    GraphHeader GetGraphHeader() const;
+
+private:
+    // Проход маршрута через остановку, по которому восстанавливаются участки поездки
+    struct RideVertex {
+        const domain::Bus* bus; // < маршрут
+        uint32_t position; // < номер остановки в маршруте
+        int distance; // < расстояние от начала участка маршрута, проходимого в одном направлении
+    };
+
+    // Добавляет вершины и ребра поездки по всем маршрутам
+    void AddBusEdges();
+
+    // Добавляет вершины поездки и ребра перегонов, посадки и высадки участка маршрута, проходимого в одном направлении
+    void AddBusSegmentEdges(const domain::Bus& bus, size_t begin, size_t end);
+
+    // Восстанавливает путь по строке таблицы маршрутов
+    RouteInfo RestoreRoute(size_t row, domain::StopId to) const;
+
+    /* Собирает участки маршрута по ребрам пути, суммируя время в порядке следования.
+       Время поездки считается по расстоянию от посадки до высадки, а не суммой весов перегонов */
+    RouteInfo MakeRouteInfo(const std::vector<graph::EdgeId>& edges) const;
+
+    // Разбивает остановки на компоненты связности по маршрутам, чтобы заведомо недостижимые пути отсекались без поиска
+    void BuildComponents();
+
+    // Проверяет, что вершина графа - вершина остановки (ее номер совпадает с номером остановки)
+    bool IsStopVertex(graph::VertexId vertex) const;
+
+    // Возвращает проход маршрута, которому соответствует вершина поездки
+    const RideVertex& GetRideVertex(graph::VertexId vertex) const;
+
+    const transport_catalogue::TransportCatalogue& catalogue_; // < каталог, по которому построен граф
+    RoutingSettings settings_; // < настройки маршрутизации
+    size_t stop_count_; // < количество остановок при построении графа (вершины остановок идут первыми)
+
+    std::vector<RideVertex> ride_vertices_; // < вершины поездки по порядку (их номера в графе начинаются с stop_count_)
+    graph::DirectedWeightedGraph<double> graph_; // < граф с весами во времени (в минутах)
+    std::vector<domain::StopId> components_; // < номер компоненты связности (представитель) по номеру остановки
+    std::unique_ptr<graph::Router<double>> router_; // < поиск кратчайшего пути по графу
+    std::optional<RouteTable> route_table_; // < предрассчитанная таблица маршрутов
+    std::optional<RoutingHierarchy> hierarchy_; // < иерархия сжатия графа
+};
+
+} // namespace transport_router
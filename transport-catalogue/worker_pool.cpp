@@ -0,0 +1,146 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+
+using namespace std;
+
+namespace worker_pool {
+
+WorkerPool::WorkerPool(size_t thread_count, size_t capacity)
+    : capacity_(max<size_t>(capacity, 1)) {
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < max<size_t>(thread_count, 1); ++i) {
+        threads_.emplace_back([this] {
+            Run();
+        });
+    }
+}
+
+// Дожидается выполнения поставленных задач и останавливает потоки
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    has_tasks_.notify_all();
+    for (thread& t : threads_) {
+        t.join();
+    }
+}
+
+// Ставит задачу в очередь, ожидая свободного места
+void WorkerPool::Submit(function<void()> task) {
+    {
+        unique_lock lock(mutex_);
+        has_space_.wait(lock, [this] {
+            return tasks_.size() < capacity_;
+        });
+        tasks_.push_back(move(task));
+    }
+    has_tasks_.notify_one();
+}
+
+// Ставит задачу в очередь, если в ней есть место, иначе возвращает false
+bool WorkerPool::TrySubmit(function<void()> task) {
+    {
+        lock_guard guard(mutex_);
+        if (tasks_.size() >= capacity_) {
+            return false;
+        }
+        tasks_.push_back(move(task));
+    }
+    has_tasks_.notify_one();
+    return true;
+}
+
+/* Выполняет body для каждого индекса от 0 до count и возвращает управление после выполнения всех.
+   Вызывающий поток разбирает индексы вместе с потоками пула (всего не больше GetThreadCount() потоков),
+   поэтому вызов не зависает, даже если пул занят или вызывается из задачи самого пула.
+   Первое исключение из body пробрасывается после завершения уже начатых индексов, остальные индексы пропускаются */
+void WorkerPool::ParallelFor(size_t count, const function<void(size_t)>& body) {
+    // Состояние разделяется с задачами пула: задача, начавшаяся после завершения вызова, лишь убеждается, что индексов не осталось
+    struct State {
+        const function<void(size_t)>* body; // < тело цикла (действительно, пока не выполнены все индексы)
+        size_t count; // < число индексов
+        atomic<size_t> next_index = 0; // < следующий неразобранный индекс
+        atomic<size_t> finished_count = 0; // < число выполненных или пропущенных индексов
+        atomic<bool> is_failed = false; // < флаг исключения в одном из индексов
+        exception_ptr error; // < первое исключение
+        std::mutex mutex; // < мьютекс, защищающий исключение и ожидание завершения
+        condition_variable is_finished; // < сигнал о завершении всех индексов
+    };
+    auto state = make_shared<State>();
+    state->body = &body;
+    state->count = count;
+
+    // Индексы разбираются по одному через общий счетчик, поэтому долгий индекс не задерживает остальные
+    auto work = [](State& state) {
+        for (size_t i = state.next_index++; i < state.count; i = state.next_index++) {
+            if (!state.is_failed) {
+                try {
+                    (*state.body)(i);
+                } catch (...) {
+                    lock_guard guard(state.mutex);
+                    if (!state.error) {
+                        state.error = current_exception();
+                    }
+                    state.is_failed = true;
+                }
+            }
+            if (++state.finished_count == state.count) {
+                lock_guard guard(state.mutex);
+                state.is_finished.notify_all();
+            }
+        }
+    };
+
+    // Помощники не ждут места в очереди: занятый пул просто оставляет больше работы вызывающему потоку
+    const size_t helper_count = min(threads_.size(), max<size_t>(count, 1)) - 1;
+    for (size_t i = 0; i < helper_count; ++i) {
+        if (!TrySubmit([state, work] {
+                work(*state);
+            })) {
+            break;
+        }
+    }
+    work(*state);
+
+    unique_lock lock(state->mutex);
+    state->is_finished.wait(lock, [&state] {
+        return state->finished_count == state->count;
+    });
+    if (state->error) {
+        rethrow_exception(state->error);
+    }
+}
+
+// Возвращает число потоков пула
+size_t WorkerPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+// Выполняет задачи из очереди до остановки пула
+void WorkerPool::Run() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            has_tasks_.wait(lock, [this] {
+                return !tasks_.empty() || is_stopping_;
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        has_space_.notify_one();
+        task();
+    }
+}
+
+} // namespace worker_pool
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace worker_pool {
+
+/*
+ * Пул потоков с ограниченной очередью задач.
+ * Если очередь заполнена, добавление задачи ждет ее освобождения, ограничивая память под невыполненные запросы.
+ * Потоки создаются один раз и переиспользуются всеми пакетами запросов и отрисовками карты
+ */
+class WorkerPool {
+public:
+    WorkerPool(size_t thread_count, size_t capacity);
+
+    // Дожидается выполнения поставленных задач и останавливает потоки
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Ставит задачу в очередь, ожидая свободного места
+    void Submit(std::function<void()> task);
+
+    // Ставит задачу в очередь, если в ней есть место, иначе возвращает false
+    bool TrySubmit(std::function<void()> task);
+
+    /* Выполняет body для каждого индекса от 0 до count и возвращает управление после выполнения всех.
+       Вызывающий поток разбирает индексы вместе с потоками пула (всего не больше GetThreadCount() потоков),
+       поэтому вызов не зависает, даже если пул занят или вызывается из задачи самого пула.
+       Первое исключение из body пробрасывается после завершения уже начатых индексов, остальные индексы пропускаются */
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // Возвращает число потоков пула
+    size_t GetThreadCount() const;
+
+private:
+    // Выполняет задачи из очереди до остановки пула
+    void Run();
+
+    std::mutex mutex_; // < мьютекс, защищающий очередь
+    std::condition_variable has_tasks_; // < сигнал о появлении задачи или остановке пула
+    std::condition_variable has_space_; // < сигнал об освобождении места в очереди
+    std::deque<std::function<void()>> tasks_; // < очередь задач
+    size_t capacity_; // < наибольшая длина очереди
+    bool is_stopping_ = false; // < флаг остановки пула
+    std::vector<std::thread> threads_; // < потоки пула
+};
+
+} // namespace worker_pool